@@ -8,15 +8,19 @@
     Profile: core
     Extensions:
         GL_OES_EGL_image,
-        GL_OES_EGL_image_external
+        GL_OES_EGL_image_external,
+        GL_ARB_buffer_storage,
+        GL_OVR_multiview,
+        GL_ARB_shader_viewport_layer_array,
+        GL_AMD_vertex_shader_layer
     Loader: False
     Local files: False
     Omit khrplatform: False
 
     Commandline:
-        --profile="core" --api="gl=4.3,gles2=3.2" --generator="c" --spec="gl" --no-loader --extensions="GL_OES_EGL_image,GL_OES_EGL_image_external"
+        --profile="core" --api="gl=4.3,gles2=3.2" --generator="c" --spec="gl" --no-loader --extensions="GL_OES_EGL_image,GL_OES_EGL_image_external,GL_ARB_buffer_storage,GL_OVR_multiview,GL_ARB_shader_viewport_layer_array,GL_AMD_vertex_shader_layer"
     Online:
-        http://glad.dav1d.de/#profile=core&language=c&specification=gl&api=gl%3D4.3&api=gles2%3D3.2&extensions=GL_OES_EGL_image&extensions=GL_OES_EGL_image_external
+        http://glad.dav1d.de/#profile=core&language=c&specification=gl&api=gl%3D4.3&api=gles2%3D3.2&extensions=GL_OES_EGL_image&extensions=GL_OES_EGL_image_external&extensions=GL_ARB_buffer_storage&extensions=GL_OVR_multiview&extensions=GL_ARB_shader_viewport_layer_array&extensions=GL_AMD_vertex_shader_layer
 */
 
 
@@ -3377,6 +3381,39 @@ GLAPI PFNGLEGLIMAGETARGETRENDERBUFFERSTORAGEOESPROC glad_glEGLImageTargetRenderb
 #define GL_OES_EGL_image_external 1
 GLAPI int GLAD_GL_OES_EGL_image_external;
 #endif
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#define GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT 0x00004000
+#define GL_BUFFER_IMMUTABLE_STORAGE 0x821F
+#define GL_BUFFER_STORAGE_FLAGS 0x8220
+#ifndef GL_ARB_buffer_storage
+#define GL_ARB_buffer_storage 1
+GLAPI int GLAD_GL_ARB_buffer_storage;
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+GLAPI PFNGLBUFFERSTORAGEPROC glad_glBufferStorage;
+#define glBufferStorage glad_glBufferStorage
+#endif
+#define GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_NUM_VIEWS_OVR 0x9630
+#define GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_BASE_VIEW_INDEX_OVR 0x9632
+#define GL_MAX_VIEWS_OVR 0x9631
+#define GL_FRAMEBUFFER_INCOMPLETE_VIEW_TARGETS_OVR 0x9633
+#ifndef GL_OVR_multiview
+#define GL_OVR_multiview 1
+GLAPI int GLAD_GL_OVR_multiview;
+typedef void (APIENTRYP PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC)(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint baseViewIndex, GLsizei numViews);
+GLAPI PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC glad_glFramebufferTextureMultiviewOVR;
+#define glFramebufferTextureMultiviewOVR glad_glFramebufferTextureMultiviewOVR
+#endif
+#ifndef GL_ARB_shader_viewport_layer_array
+#define GL_ARB_shader_viewport_layer_array 1
+GLAPI int GLAD_GL_ARB_shader_viewport_layer_array;
+#endif
+#ifndef GL_AMD_vertex_shader_layer
+#define GL_AMD_vertex_shader_layer 1
+GLAPI int GLAD_GL_AMD_vertex_shader_layer;
+#endif
 
 #ifdef __cplusplus
 }
@@ -8,15 +8,19 @@
     Profile: core
     Extensions:
         GL_OES_EGL_image,
-        GL_OES_EGL_image_external
+        GL_OES_EGL_image_external,
+        GL_ARB_buffer_storage,
+        GL_OVR_multiview,
+        GL_ARB_shader_viewport_layer_array,
+        GL_AMD_vertex_shader_layer
     Loader: False
     Local files: False
     Omit khrplatform: False
 
     Commandline:
-        --profile="core" --api="gl=4.3,gles2=3.2" --generator="c" --spec="gl" --no-loader --extensions="GL_OES_EGL_image,GL_OES_EGL_image_external"
+        --profile="core" --api="gl=4.3,gles2=3.2" --generator="c" --spec="gl" --no-loader --extensions="GL_OES_EGL_image,GL_OES_EGL_image_external,GL_ARB_buffer_storage,GL_OVR_multiview,GL_ARB_shader_viewport_layer_array,GL_AMD_vertex_shader_layer"
     Online:
-        http://glad.dav1d.de/#profile=core&language=c&specification=gl&api=gl%3D4.3&api=gles2%3D3.2&extensions=GL_OES_EGL_image&extensions=GL_OES_EGL_image_external
+        http://glad.dav1d.de/#profile=core&language=c&specification=gl&api=gl%3D4.3&api=gles2%3D3.2&extensions=GL_OES_EGL_image&extensions=GL_OES_EGL_image_external&extensions=GL_ARB_buffer_storage&extensions=GL_OVR_multiview&extensions=GL_ARB_shader_viewport_layer_array&extensions=GL_AMD_vertex_shader_layer
 */
 
 #include <stdio.h>
@@ -723,6 +727,12 @@ int GLAD_GL_OES_EGL_image_external;
 int GLAD_GL_OES_EGL_image;
 PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glad_glEGLImageTargetTexture2DOES;
 PFNGLEGLIMAGETARGETRENDERBUFFERSTORAGEOESPROC glad_glEGLImageTargetRenderbufferStorageOES;
+int GLAD_GL_ARB_buffer_storage;
+PFNGLBUFFERSTORAGEPROC glad_glBufferStorage;
+int GLAD_GL_OVR_multiview;
+PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC glad_glFramebufferTextureMultiviewOVR;
+int GLAD_GL_ARB_shader_viewport_layer_array;
+int GLAD_GL_AMD_vertex_shader_layer;
 static void load_GL_VERSION_1_0(GLADloadproc load) {
 	if(!GLAD_GL_VERSION_1_0) return;
 	glad_glCullFace = (PFNGLCULLFACEPROC)load("glCullFace");
@@ -1339,8 +1349,20 @@ static void load_GL_VERSION_4_3(GLADloadproc load) {
 	glad_glGetObjectPtrLabel = (PFNGLGETOBJECTPTRLABELPROC)load("glGetObjectPtrLabel");
 	glad_glGetPointerv = (PFNGLGETPOINTERVPROC)load("glGetPointerv");
 }
+static void load_GL_ARB_buffer_storage(GLADloadproc load) {
+	if(!GLAD_GL_ARB_buffer_storage) return;
+	glad_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+}
+static void load_GL_OVR_multiview(GLADloadproc load) {
+	if(!GLAD_GL_OVR_multiview) return;
+	glad_glFramebufferTextureMultiviewOVR = (PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC)load("glFramebufferTextureMultiviewOVR");
+}
 static int find_extensionsGL(void) {
 	if (!get_exts()) return 0;
+	GLAD_GL_AMD_vertex_shader_layer = has_ext("GL_AMD_vertex_shader_layer");
+	GLAD_GL_ARB_shader_viewport_layer_array = has_ext("GL_ARB_shader_viewport_layer_array");
+	GLAD_GL_OVR_multiview = has_ext("GL_OVR_multiview");
+	GLAD_GL_ARB_buffer_storage = has_ext("GL_ARB_buffer_storage");
 	(void)&has_ext;
 	free_exts();
 	return 1;
@@ -1428,6 +1450,8 @@ int gladLoadGLLoader(GLADloadproc load) {
 	load_GL_VERSION_4_3(load);
 
 	if (!find_extensionsGL()) return 0;
+	load_GL_OVR_multiview(load);
+	load_GL_ARB_buffer_storage(load);
 	return GLVersion.major != 0 || GLVersion.minor != 0;
 }
 
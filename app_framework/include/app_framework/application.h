@@ -25,6 +25,7 @@
 
 #include <app_framework/components/camera_component.h>
 #include <app_framework/components/renderable_component.h>
+#include <app_framework/render/render_list.h>
 #include <app_framework/render/renderer.h>
 #include <app_framework/resource_pool.h>
 #include <app_framework/render/texture.h>
@@ -173,8 +174,7 @@ private:
   // Node
   std::shared_ptr<Node> light_node_;
   std::shared_ptr<Node> root_;
-  std::queue<std::shared_ptr<Node>> queue_;
-  void VisitNode(std::shared_ptr<Node> node);
+  std::shared_ptr<RenderList> render_list_;
 
   // Default ml camera
   std::array<std::shared_ptr<Node>, 2> camera_nodes_;
@@ -182,6 +182,18 @@ private:
 
   ApplicationClock::time_point fps_delta_time_;
   uint32_t num_frames_ = 0;
+  size_t num_reindexed_nodes_ = 0;
+  size_t num_updated_transforms_ = 0;
+  size_t num_instanced_batches_ = 0;
+  size_t num_instanced_draws_ = 0;
+  uint64_t num_triangles_ = 0;
+  uint64_t num_full_detail_triangles_ = 0;
+  uint64_t num_gl_calls_issued_ = 0;
+  uint64_t num_gl_calls_elided_ = 0;
+  uint64_t last_buffer_reallocations_ = 0;
+  uint64_t last_buffer_uploaded_bytes_ = 0;
+  uint64_t last_pipeline_misses_ = 0;
+  uint64_t last_texture_committed_bytes_ = 0;
 };
 
 }  // namespace app_framework
@@ -0,0 +1,107 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <app_framework/common.h>
+
+namespace ml {
+namespace app_framework {
+
+// Read only view of a whole file, mapped in memory where the platform allows it
+class MappedFile final {
+public:
+  ~MappedFile();
+
+  // Null when the file cannot be opened
+  static std::shared_ptr<MappedFile> Open(const std::string &path);
+
+  const unsigned char *GetData() const {
+    return data_;
+  }
+
+  uint64_t GetSize() const {
+    return size_;
+  }
+
+private:
+  MappedFile();
+
+  const unsigned char *data_;
+  uint64_t size_;
+  // Whole file read in memory when it could not be mapped
+  std::vector<unsigned char> buffer_;
+};
+
+// Imported assets kept on disk across launches, one file per asset. The layout
+// of the payload belongs to the resource pool, the cache checks the file still
+// matches the size and modification time of the asset it was written from.
+class AssetCache final {
+public:
+  struct Entry {
+    std::shared_ptr<MappedFile> file;
+    // Starts 16 byte aligned in the file
+    const unsigned char *payload;
+    uint64_t payload_size;
+    // Time the import took when the file was written
+    double import_seconds;
+  };
+
+  AssetCache();
+  ~AssetCache() = default;
+
+  static const std::unique_ptr<AssetCache> &GetInstance();
+
+  // Directory the files are kept in, the cache is disabled while it is empty
+  void SetDirectory(const std::string &directory);
+
+  bool IsEnabled() const {
+    return !directory_.empty();
+  }
+
+  // Any thread, false when there is no file for the asset, the asset changed since or the file was written
+  // with other import options. The options are flags of the resource pool, the cache only compares them.
+  bool Load(const std::string &asset_path, uint32_t options, Entry &entry) const;
+  void Store(const std::string &asset_path, uint32_t options, double import_seconds,
+             const std::vector<unsigned char> &payload) const;
+
+  // Time spent loading assets since startup, split by where they came from
+  void AddAsset(bool loaded, double seconds);
+
+  uint32_t GetLoadedCount() const {
+    return num_loaded_;
+  }
+
+  uint32_t GetImportedCount() const {
+    return num_imported_;
+  }
+
+  double GetLoadTime() const {
+    return load_microseconds_ / 1e6;
+  }
+
+  double GetImportTime() const {
+    return import_microseconds_ / 1e6;
+  }
+
+private:
+  std::string GetPath(const std::string &asset_path) const;
+
+  std::string directory_;
+  // Updated by the loader threads
+  std::atomic<uint32_t> num_loaded_;
+  std::atomic<uint32_t> num_imported_;
+  std::atomic<uint64_t> load_microseconds_;
+  std::atomic<uint64_t> import_microseconds_;
+};
+}
+}
@@ -16,20 +16,39 @@
 namespace ml {
 namespace app_framework {
 
+// Simplified version of a mesh, drawn instead of it from far enough away
+struct LodLevel {
+  std::shared_ptr<Mesh> mesh;
+  // Largest distance from the full resolution surface, relative to the bounding radius
+  float error;
+};
+
+// Levels of detail of a mesh, shared by the renderables drawing it
+struct LodChain {
+  // Bounding sphere of the mesh in its local space
+  glm::vec3 center;
+  float radius;
+  // Coarser and coarser after the mesh itself
+  std::vector<LodLevel> levels;
+};
+
 // Renderable component
 class RenderableComponent final : public Component {
   RUNTIME_TYPE_REGISTER(RenderableComponent)
 public:
   RenderableComponent(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material)
-      : mesh_(mesh), material_(material), visible_(true) {}
+      : mesh_(mesh), material_(material), visible_(true), lod_level_(0) {}
   ~RenderableComponent() = default;
 
   void SetVisible(bool visible) {
     visible_ = visible;
   }
 
+  // The levels of detail of the previous mesh are dropped
   void SetMesh(std::shared_ptr<Mesh> mesh) {
     mesh_ = mesh;
+    lod_chain_.reset();
+    lod_level_ = 0;
   }
 
   void SetMaterial(std::shared_ptr<Material> material) {
@@ -40,10 +59,34 @@ public:
     return visible_;
   }
 
+  // Mesh of the selected level of detail
   std::shared_ptr<Mesh> GetMesh() const {
+    return lod_level_ == 0 ? mesh_ : lod_chain_->levels[lod_level_ - 1].mesh;
+  }
+
+  // Mesh at full resolution, whatever the level of detail
+  std::shared_ptr<Mesh> GetFullMesh() const {
     return mesh_;
   }
 
+  void SetLodChain(std::shared_ptr<const LodChain> lod_chain) {
+    lod_chain_ = lod_chain;
+    lod_level_ = 0;
+  }
+
+  const std::shared_ptr<const LodChain> &GetLodChain() const {
+    return lod_chain_;
+  }
+
+  // 0 for the mesh itself, picked by the renderer every frame
+  void SetLodLevel(uint32_t level) {
+    lod_level_ = lod_chain_ ? std::min<uint32_t>(level, lod_chain_->levels.size()) : 0;
+  }
+
+  uint32_t GetLodLevel() const {
+    return lod_level_;
+  }
+
   std::shared_ptr<Material> GetMaterial() const {
     return material_;
   }
@@ -54,6 +97,8 @@ private:
   bool visible_;
   std::shared_ptr<Mesh> mesh_;
   std::shared_ptr<Material> material_;
+  std::shared_ptr<const LodChain> lod_chain_;
+  uint32_t lod_level_;
 };
 
 }
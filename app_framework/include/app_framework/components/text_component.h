@@ -24,7 +24,8 @@ class TextComponent final : public Component {
   RUNTIME_TYPE_REGISTER(TextComponent)
 public:
   TextComponent() {
-    mesh_ = std::make_shared<Mesh>(Buffer::Category::Dynamic, GL_UNSIGNED_SHORT);
+    // The text is typically rewritten every frame
+    mesh_ = std::make_shared<Mesh>(Buffer::Category::Stream, GL_UNSIGNED_SHORT);
   }
   ~TextComponent() = default;
 
@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <app_framework/asset_cache.h>
+#include <app_framework/common.h>
+
+namespace ml {
+namespace app_framework {
+
+// glTF 2.0 asset read without Assimp, a .gltf file with its buffers or a .glb.
+// The buffer files are mapped and the accessors point straight into them, the
+// asset has to outlive whatever reads them. No GL calls, any thread.
+class GLTFAsset final {
+public:
+  struct Accessor {
+    // First element
+    const unsigned char *data;
+    uint32_t count;
+    // Bytes from one element to the next, the element size when tightly packed
+    uint32_t stride;
+    GLenum component_type;
+    // 1 for SCALAR up to 4 for VEC4
+    uint32_t component_count;
+    bool normalized;
+  };
+
+  // Indices of the accessors and the material, -1 when missing
+  struct Primitive {
+    int32_t position;
+    int32_t normal;
+    int32_t tex_coord;
+    int32_t tangent;
+    int32_t indices;
+    int32_t material;
+    GLenum mode;
+  };
+
+  // Indices of the images of the texture slots, -1 when missing
+  struct Material {
+    int32_t base_color;
+    int32_t metallic_roughness;
+    int32_t normal;
+    int32_t occlusion;
+    int32_t emissive;
+  };
+
+  struct Image {
+    // File next to the asset, empty when the image is held by a buffer or a data URI
+    std::string path;
+    const unsigned char *data;
+    uint64_t size;
+  };
+
+  struct Node {
+    glm::vec3 translation;
+    glm::quat rotation;
+    glm::vec3 scale;
+    int32_t mesh;
+    std::vector<int32_t> children;
+  };
+
+  GLTFAsset() = default;
+  ~GLTFAsset() = default;
+
+  // True for the file extensions it reads
+  static bool IsGLTF(const std::string &path);
+
+  // False when the file is malformed or needs an extension it does not support
+  bool Load(const std::string &path);
+
+  // False for sparse accessors and accessors out of the bounds of their buffer
+  bool GetAccessor(int32_t index, Accessor &accessor) const;
+
+  // Primitives of each mesh
+  const std::vector<std::vector<Primitive>> &GetMeshes() const {
+    return meshes_;
+  }
+
+  const std::vector<Material> &GetMaterials() const {
+    return materials_;
+  }
+
+  const std::vector<Image> &GetImages() const {
+    return images_;
+  }
+
+  const std::vector<Node> &GetNodes() const {
+    return nodes_;
+  }
+
+  // Root nodes of the default scene
+  const std::vector<int32_t> &GetSceneNodes() const {
+    return scene_nodes_;
+  }
+
+private:
+  struct BufferData {
+    const unsigned char *data;
+    uint64_t size;
+  };
+
+  struct BufferView {
+    int32_t buffer;
+    uint64_t offset;
+    uint64_t length;
+    uint32_t stride;
+  };
+
+  struct AccessorView {
+    int32_t buffer_view;
+    uint64_t offset;
+    uint32_t count;
+    GLenum component_type;
+    uint32_t component_count;
+    bool normalized;
+    bool sparse;
+  };
+
+  bool LoadBuffer(const std::string &uri, const std::string &directory, BufferData &buffer);
+
+  std::vector<std::shared_ptr<MappedFile>> files_;
+  // Buffers and images decoded from data URIs
+  std::vector<std::vector<unsigned char>> decoded_;
+  std::vector<BufferData> buffers_;
+  std::vector<BufferView> buffer_views_;
+  std::vector<AccessorView> accessors_;
+  std::vector<std::vector<Primitive>> meshes_;
+  std::vector<Material> materials_;
+  std::vector<Image> images_;
+  std::vector<Node> nodes_;
+  std::vector<int32_t> scene_nodes_;
+};
+}
+}
@@ -16,7 +16,19 @@
 namespace ml {
 namespace app_framework {
 
-class FlatMaterial final : public Material {
+// Material block of kSolidColorFragmentShader
+struct FlatMaterialParams {
+  glm::vec4 Color;
+  Std140Bool OverrideVertexColor;
+
+  static std::vector<MaterialParamField> GetFields() {
+    return {MATERIAL_PARAM_FIELD(FlatMaterialParams, Color),
+            MATERIAL_PARAM_FIELD(FlatMaterialParams, OverrideVertexColor)};
+  }
+};
+static_assert(offsetof(FlatMaterialParams, OverrideVertexColor) == 16, "std140 layout of the Material block");
+
+class FlatMaterial final : public TypedMaterial<FlatMaterialParams> {
 public:
   FlatMaterial(const glm::vec4 &color) {
     SetVertexProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<VertexProgram>(kSolidColorVertexShader));
@@ -25,8 +37,16 @@ public:
   }
   ~FlatMaterial() = default;
 
-  MATERIAL_VARIABLE_DECLARE(bool, OverrideVertexColor);
-  MATERIAL_VARIABLE_DECLARE(glm::vec4, Color);
+  bool IsInstanceable() const override {
+    return true;
+  }
+  void GetInstanceColor(glm::vec4 &color, float &color_weight) const override {
+    color = GetColor();
+    color_weight = GetOverrideVertexColor() ? 1.0f : 0.0f;
+  }
+
+  MATERIAL_PARAM_DECLARE(bool, OverrideVertexColor);
+  MATERIAL_PARAM_DECLARE(glm::vec4, Color);
 };
 }
 }
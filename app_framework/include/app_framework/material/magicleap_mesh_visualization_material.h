@@ -9,6 +9,7 @@
 #pragma once
 #include <app_framework/common.h>
 #include <app_framework/registry.h>
+#include <app_framework/material/flat_material.h>
 #include <app_framework/shader/magicleap_mesh_gs_program.h>
 #include <app_framework/shader/magicleap_mesh_vs_program.h>
 #include <app_framework/shader/solid_color_fs_program.h>
@@ -18,9 +19,9 @@ namespace ml {
 namespace app_framework {
 
 // Magic Leap Mesh component for mesh visualization
-class MagicLeapMeshVisualizationMaterial final : public Material {
+class MagicLeapMeshVisualizationMaterial final : public TypedMaterial<FlatMaterialParams> {
 public:
-  MagicLeapMeshVisualizationMaterial() : Material() {
+  MagicLeapMeshVisualizationMaterial() {
     SetVertexProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<VertexProgram>(kMagicLeapMeshVertexShader));
     SetFragmentProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<FragmentProgram>(kSolidColorFragmentShader));
     SetGeometryProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<GeometryProgram>(kMagicLeapMeshGeometryShader));
@@ -29,7 +30,7 @@ public:
   ~MagicLeapMeshVisualizationMaterial() = default;
 
 private:
-  MATERIAL_VARIABLE_DECLARE(bool, OverrideVertexColor);
+  MATERIAL_PARAM_DECLARE(bool, OverrideVertexColor);
 };
 }
 }
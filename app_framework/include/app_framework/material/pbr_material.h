@@ -7,6 +7,8 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #pragma once
+#include <string>
+
 #include <app_framework/common.h>
 #include <app_framework/registry.h>
 #include <app_framework/shader/pbr_fs_program.h>
@@ -16,43 +18,157 @@
 namespace ml {
 namespace app_framework {
 
-class PBRMaterial final : public Material {
+// Material block of kPBRFragmentShader
+struct PBRMaterialParams {
+  int32_t MetallicChannel;
+  int32_t RoughnessChannel;
+
+  static std::vector<MaterialParamField> GetFields() {
+    return {MATERIAL_PARAM_FIELD(PBRMaterialParams, MetallicChannel),
+            MATERIAL_PARAM_FIELD(PBRMaterialParams, RoughnessChannel)};
+  }
+};
+
+// Declares the flag of a feature of the PBR material, toggling it selects another permutation
+#define PBR_FEATURE_DECLARE(name)               \
+  inline void Set##name(bool value) {           \
+    SetFeature(PBRFeature::name, value);        \
+  }                                             \
+  inline bool Get##name() const {               \
+    return (features_ & PBRFeature::name) != 0; \
+  }
+
+// Declares a texture of the PBR material, kept while the permutation does not sample it
+#define PBR_TEXTURE_DECLARE(name, index)                         \
+  inline void Set##name(const std::shared_ptr<Texture> &value) { \
+    textures_[index] = value;                                    \
+    auto variable = GetVariable(#name);                          \
+    if (variable) variable->SetValue(value);                     \
+  }                                                              \
+  inline std::shared_ptr<Texture> Get##name() const {            \
+    return textures_[index];                                     \
+  }
+
+// Features of a PBR material, each one compiles the matching HAS_ define into the fragment program
+struct PBRFeature final {
+  PBRFeature() = delete;
+  static const uint32_t HasNormals = 1 << 0;
+  static const uint32_t HasAlbedo = 1 << 1;
+  static const uint32_t HasNormalMap = 1 << 2;
+  static const uint32_t HasMetallic = 1 << 3;
+  static const uint32_t HasRoughness = 1 << 4;
+  static const uint32_t HasAmbientOcclusion = 1 << 5;
+  static const uint32_t HasEmissive = 1 << 6;
+  // The mesh has a tangent attribute, only used with a normal map
+  static const uint32_t HasTangents = 1 << 7;
+  static const uint32_t kCount = 8;
+};
+
+// PBR material drawn with the permutation of kPBRFragmentShader compiled for exactly
+// its features. Permutations are shared through the program cache of the resource
+// pool, the one of a material is switched before its next frame when a flag changes.
+class PBRMaterial final : public TypedMaterial<PBRMaterialParams> {
 public:
-  PBRMaterial() {
-    SetVertexProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<VertexProgram>(kPBRVertexShader));
-    SetFragmentProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<FragmentProgram>(kPBRFragmentShader));
+  PBRMaterial() : features_(0), program_features_(0) {
+    SetVertexProgram(LoadVertexPermutation(features_));
+    SetFragmentProgram(LoadPermutation(features_));
   }
   ~PBRMaterial() = default;
 
-  MATERIAL_VARIABLE_DECLARE(std::shared_ptr<Texture>, Albedo);
+  bool UpdatePrograms() override {
+    const uint32_t features = GetProgramFeatures(features_);
+    if (features == program_features_) {
+      return false;
+    }
+    SetVertexProgram(LoadVertexPermutation(features));
+    SetFragmentProgram(LoadPermutation(features));
+    program_features_ = features;
+    // The variables of the textures were rebuilt for the samplers of the permutation
+    static const char *kTextureNames[kTextureCount] = {"Albedo",           "Metallic", "Roughness",
+                                                       "AmbientOcclusion", "Emissive", "Normals"};
+    for (uint32_t index = 0; index < kTextureCount; ++index) {
+      auto variable = GetVariable(kTextureNames[index]);
+      if (variable) variable->SetValue(textures_[index]);
+    }
+    return true;
+  }
+
+  uint32_t GetFeatures() const {
+    return features_;
+  }
+
+  PBR_TEXTURE_DECLARE(Albedo, 0);
+
+  PBR_TEXTURE_DECLARE(Metallic, 1);
+
+  PBR_TEXTURE_DECLARE(Roughness, 2);
 
-  MATERIAL_VARIABLE_DECLARE(std::shared_ptr<Texture>, Metallic);
+  PBR_TEXTURE_DECLARE(AmbientOcclusion, 3);
 
-  MATERIAL_VARIABLE_DECLARE(std::shared_ptr<Texture>, Roughness);
+  PBR_TEXTURE_DECLARE(Emissive, 4);
 
-  MATERIAL_VARIABLE_DECLARE(std::shared_ptr<Texture>, AmbientOcclusion);
+  PBR_TEXTURE_DECLARE(Normals, 5);
 
-  MATERIAL_VARIABLE_DECLARE(std::shared_ptr<Texture>, Emissive);
+  MATERIAL_PARAM_DECLARE(int32_t, MetallicChannel);
 
-  MATERIAL_VARIABLE_DECLARE(std::shared_ptr<Texture>, Normals);
+  MATERIAL_PARAM_DECLARE(int32_t, RoughnessChannel);
 
-  MATERIAL_VARIABLE_DECLARE(int32_t, MetallicChannel);
+  PBR_FEATURE_DECLARE(HasNormals);
 
-  MATERIAL_VARIABLE_DECLARE(int32_t, RoughnessChannel);
+  PBR_FEATURE_DECLARE(HasAlbedo);
 
-  MATERIAL_VARIABLE_DECLARE(bool, HasNormals);
+  PBR_FEATURE_DECLARE(HasNormalMap);
 
-  MATERIAL_VARIABLE_DECLARE(bool, HasAlbedo);
+  PBR_FEATURE_DECLARE(HasMetallic);
 
-  MATERIAL_VARIABLE_DECLARE(bool, HasNormalMap);
+  PBR_FEATURE_DECLARE(HasRoughness);
 
-  MATERIAL_VARIABLE_DECLARE(bool, HasMetallic);
+  PBR_FEATURE_DECLARE(HasAmbientOcclusion);
 
-  MATERIAL_VARIABLE_DECLARE(bool, HasRoughness);
+  PBR_FEATURE_DECLARE(HasEmissive);
 
-  MATERIAL_VARIABLE_DECLARE(bool, HasAmbientOcclusion);
+  PBR_FEATURE_DECLARE(HasTangents);
+
+private:
+  static const uint32_t kTextureCount = 6;
+
+  void SetFeature(uint32_t feature, bool value) {
+    features_ = value ? (features_ | feature) : (features_ & ~feature);
+  }
+
+  // Features that change the programs, tangents are left out when nothing reads them
+  static uint32_t GetProgramFeatures(uint32_t features) {
+    return (features & PBRFeature::HasNormalMap) ? features : (features & ~PBRFeature::HasTangents);
+  }
+
+  // The vertex program only varies with the tangents
+  static std::shared_ptr<VertexProgram> LoadVertexPermutation(uint32_t features) {
+    if (!(features & PBRFeature::HasTangents)) {
+      return Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<VertexProgram>(kPBRVertexShader);
+    }
+    return Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<VertexProgram>(
+        Program::InjectPreamble(kPBRVertexShader, "  #define HAS_TANGENTS 1\n"), "pbr_vs:tangents");
+  }
+
+  // Fragment program with the defines of the features, cached by the resource pool under the bitmask
+  static std::shared_ptr<FragmentProgram> LoadPermutation(uint32_t features) {
+    static const char *kDefines[PBRFeature::kCount] = {"HAS_NORMALS",   "HAS_ALBEDO",    "HAS_NORMAL_MAP",
+                                                       "HAS_METALLIC",  "HAS_ROUGHNESS", "HAS_AMBIENT_OCCLUSION",
+                                                       "HAS_EMISSIVE",  "HAS_TANGENTS"};
+    std::string preamble;
+    for (uint32_t bit = 0; bit < PBRFeature::kCount; ++bit) {
+      if (features & (1 << bit)) {
+        preamble += std::string("  #define ") + kDefines[bit] + " 1\n";
+      }
+    }
+    return Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<FragmentProgram>(
+        Program::InjectPreamble(kPBRFragmentShader, preamble), "pbr_fs:" + std::to_string(features));
+  }
 
-  MATERIAL_VARIABLE_DECLARE(bool, HasEmissive);
+  uint32_t features_;
+  // Features the current programs were compiled for
+  uint32_t program_features_;
+  std::shared_ptr<Texture> textures_[kTextureCount];
 };
 }
 }
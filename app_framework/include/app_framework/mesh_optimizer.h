@@ -0,0 +1,59 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <vector>
+
+#include <app_framework/common.h>
+
+namespace ml {
+namespace app_framework {
+
+// Triangle list reordering done at import, no GL calls, any thread. The triangles
+// are ordered for the post-transform vertex cache with Tipsify (Sander et al. 2007),
+// the clusters it leaves between cache flushes are then ordered to draw the outer
+// surfaces first, and the vertices are last renumbered in the order they are fetched.
+
+// Post-transform cache size the triangles are ordered for and measured against
+static const uint32_t kVertexCacheSize = 16;
+
+// Vertex shader invocations of a triangle list, simulated with a FIFO cache
+struct VertexCacheStats {
+  uint32_t transformed;
+  uint32_t num_triangles;
+  uint32_t num_vertices;
+
+  // Average cache miss ratio, vertices transformed per triangle. 3 at worst, about 0.5 at best.
+  float GetACMR() const {
+    return num_triangles ? static_cast<float>(transformed) / num_triangles : 0.0f;
+  }
+
+  // Average transform to vertex ratio, 1 when every vertex is transformed once
+  float GetATVR() const {
+    return num_vertices ? static_cast<float>(transformed) / num_vertices : 0.0f;
+  }
+};
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t> &indices, uint32_t num_vertices,
+                                    uint32_t cache_size = kVertexCacheSize);
+
+// Triangles of indices reordered into result. clusters receives the index of the first triangle of each run
+// between cache flushes, starting with 0. The indices must be below num_vertices.
+void OptimizeVertexCache(const std::vector<uint32_t> &indices, uint32_t num_vertices, uint32_t cache_size,
+                         std::vector<uint32_t> &result, std::vector<uint32_t> &clusters);
+
+// Clusters of OptimizeVertexCache reordered in place so the ones facing away from the center of the mesh,
+// which tend to hide the others, are drawn first. The order of the triangles within a cluster is kept.
+void OptimizeOverdraw(const glm::vec3 *positions, const std::vector<uint32_t> &clusters,
+                      std::vector<uint32_t> &indices);
+
+// Vertices renumbered in the order the indices first use them, the indices are rewritten. remap maps the
+// old vertices to the new ones, ~0u for the ones no triangle uses. Returns the number of vertices left.
+uint32_t OptimizeVertexFetch(std::vector<uint32_t> &indices, uint32_t num_vertices, std::vector<uint32_t> &remap);
+}
+}
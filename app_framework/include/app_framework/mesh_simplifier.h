@@ -0,0 +1,25 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <vector>
+
+#include <app_framework/common.h>
+
+namespace ml {
+namespace app_framework {
+
+// Triangle list simplified by edge collapses, cheapest first by quadric error (Garland and Heckbert 1997),
+// until about target_index_count indices are left or the next collapse would move the surface further than
+// target_error. Each collapse moves a vertex onto a neighbour, so the result indexes the same vertex streams.
+// Vertices on borders and attribute seams stay in place. No GL calls, any thread.
+// Returns the largest error of the collapses done, in the units of the positions.
+float SimplifyMesh(const glm::vec3 *positions, uint32_t num_vertices, const std::vector<uint32_t> &indices,
+                   uint32_t target_index_count, float target_error, std::vector<uint32_t> &result);
+}
+}
@@ -12,6 +12,7 @@
 // %BANNER_END%
 
 #include "component.h"
+#include "transform_store.h"
 
 #include <glm/glm.hpp>
 
@@ -25,11 +26,13 @@ namespace app_framework {
 
 enum Space { Local, World };
 
+class RenderList;
+
 class Node : public std::enable_shared_from_this<Node> {
 public:
   Node();
   Node(const glm::vec3 &);
-  ~Node(){};
+  ~Node();
   Node(Node &&other);
   Node(const Node &) = delete;
   Node &operator=(const Node &other) = delete;
@@ -45,13 +48,17 @@ public:
   void SetWorldRotation(const glm::quat &rotation);
   void SetLocalScale(const glm::vec3 &scale);
 
-  const glm::mat4 &GetLocalTransform() const;
-  const glm::mat4 &GetWorldTransform() const;
-  const glm::vec3 &GetLocalTranslation() const;
+  // The transforms live in the TransformStore, they are returned by value since
+  // the store may reorder its slots.
+  const glm::mat4 GetLocalTransform() const;
+  const glm::mat4 GetWorldTransform() const;
+  const glm::mat4 GetInverseWorldTransform() const;
+  const glm::vec3 GetLocalTranslation() const;
   const glm::vec3 GetWorldTranslation() const;
-  const glm::quat &GetLocalRotation() const;
+  const glm::quat GetLocalRotation() const;
   const glm::quat GetWorldRotation() const;
-  const glm::vec3 &GetLocalScale() const;
+  const glm::vec3 GetLocalScale() const;
+  const glm::vec3 GetWorldScale() const;
 
   void UpdateWorldPosition();
   void SetName(std::string);
@@ -77,20 +84,21 @@ public:
     return parent_;
   }
 
-private:
-  glm::vec3 local_translation_;
-  glm::quat local_rotation_;
-  glm::vec3 local_scale_;
-  mutable glm::mat4 local_transform_;
-  mutable glm::mat4 world_transform_;
+  // Attach this node and its subtree to a render list, nullptr to detach.
+  // Children added later inherit the render list of their parent.
+  void SetRenderList(std::shared_ptr<RenderList> render_list);
 
-  const glm::mat4 GetParentWorldTransform() const;
+  std::shared_ptr<RenderList> GetRenderList() const {
+    return render_list_.lock();
+  }
+
+private:
+  TransformStore::Handle transform_;
 
   std::vector<std::shared_ptr<ml::app_framework::Node>> child_list_;
   std::string name_;
   std::weak_ptr<Node> parent_;
-  mutable bool world_dirty_;
-  mutable bool local_dirty_;
+  std::weak_ptr<RenderList> render_list_;
 
   std::vector<std::shared_ptr<app_framework::Component>> components_;
   std::unordered_map<uint64_t, std::shared_ptr<app_framework::Component>> components_by_type_;
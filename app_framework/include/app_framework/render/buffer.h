@@ -17,24 +17,65 @@ public:
   enum class Category {
     Static,
     Dynamic,
+    // Rewritten about every frame, persistently mapped and triple buffered when
+    // GL_ARB_buffer_storage is available, handled like Dynamic otherwise
+    Stream,
   };
 
+  // Number of regions a streamed buffer cycles through
+  static const uint32_t kStreamRegionCount = 3;
+
   Buffer(Buffer::Category category, GLint gl_buffer_type);
   virtual ~Buffer();
 
   Category GetCategory() const {
     return category_;
   }
+
+  // Size of the data of the last update
   uint64_t GetSize() const {
     return size_;
   }
 
+  // Size of the storage, the data is replaced in place as long as it fits
+  uint64_t GetCapacity() const {
+    return capacity_;
+  }
+
+  // Start of the data in the GL buffer, the current region of a streamed buffer
+  uint64_t GetOffset() const {
+    return offset_;
+  }
+
   GLuint GetGLBuffer() const {
     return buffer_;
   }
 
+  // Increases when the GL buffer is replaced or its storage reallocated,
+  // the vertex arrays referencing the buffer have to be rebuilt then
+  uint32_t GetAllocationVersion() const {
+    return allocation_version_;
+  }
+
+  // Storage reallocations and bytes uploaded by this buffer
+  uint32_t GetReallocationCount() const {
+    return reallocation_count_;
+  }
+
+  uint64_t GetUploadedBytes() const {
+    return uploaded_bytes_;
+  }
+
+  // Totals over every buffer since the start of the application
+  static uint64_t GetTotalReallocationCount();
+  static uint64_t GetTotalUploadedBytes();
+
   virtual void UpdateBuffer(const char *data, uint64_t size);
 
+  // Replace part of the data in place, the range has to be within the capacity.
+  // Not for streamed buffers, whose regions move with every update.
+  void UpdateBufferRange(const char *data, uint64_t offset, uint64_t size);
+
   GLint GetGLBufferType() const {
     return gl_buffer_type_;
   }
@@ -47,16 +88,38 @@ public:
     switch (category) {
       case Category::Static: return GL_STATIC_DRAW;
       case Category::Dynamic: return GL_DYNAMIC_DRAW;
+      case Category::Stream: return GL_STREAM_DRAW;
     }
     return 0;
   }
 
+protected:
+  // Replace the GL buffer by a new name, for buffers with immutable storage of the given size
+  void RecreateGLBuffer(uint64_t size);
+
 private:
+  // Capacity for the given size, growing geometrically
+  uint64_t GetGrownCapacity(uint64_t size) const;
+  // false when the storage could not be mapped, the buffer is then handled as Dynamic
+  bool UpdateStreamBuffer(const char *data, uint64_t size);
+  void ReleaseStreamStorage();
+  void OnReallocated();
+
   Category category_;
   GLuint buffer_;
   GLint gl_buffer_type_;
   GLint gl_buffer_category_;
   uint64_t size_;
+  uint64_t capacity_;
+  uint64_t offset_;
+  uint32_t allocation_version_;
+  uint32_t reallocation_count_;
+  uint64_t uploaded_bytes_;
+
+  // Persistently mapped regions of a streamed buffer
+  char *stream_data_;
+  GLsync stream_fences_[kStreamRegionCount];
+  uint32_t stream_region_;
 };
 }
 }
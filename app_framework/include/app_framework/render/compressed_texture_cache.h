@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <app_framework/common.h>
+#include "texture.h"
+
+namespace ml {
+namespace app_framework {
+
+// Mip chains of the loaded textures compressed to a format of the driver, kept
+// on disk as KTX files across launches. The first launch has the driver
+// compress each level and reads the result back, later ones load the files.
+class CompressedTextureCache final {
+public:
+  struct Entry {
+    GLenum format;
+    std::vector<TextureLevel> levels;
+    std::vector<unsigned char> data;
+  };
+
+  CompressedTextureCache();
+  ~CompressedTextureCache() = default;
+
+  static const std::unique_ptr<CompressedTextureCache> &GetInstance();
+
+  // Directory the files are kept in, picks the formats the driver supports. Needs a current context.
+  void SetDirectory(const std::string &directory);
+
+  bool IsEnabled() const {
+    return !directory_.empty();
+  }
+
+  // Compressed format used for textures of the internal format, 0 when they are left uncompressed
+  GLenum GetFormat(GLint gl_internal_format) const;
+
+  // Called when compressing to the format failed, the textures of the format stay uncompressed.
+  // Only the first call for a format warns.
+  void DisableFormat(GLenum format);
+
+  // Key of the texture decoded from the source bytes, any thread
+  uint64_t GetKey(const unsigned char *source, uint64_t size, GLenum format) const;
+
+  // Any thread, false when there is no usable file for the key
+  bool Load(uint64_t key, Entry &entry) const;
+  void Store(uint64_t key, const Entry &entry) const;
+
+  // Bytes of the textures created compressed and of their uncompressed RGBA8 mip chains
+  void AddTexture(bool loaded, uint64_t compressed_bytes, uint64_t uncompressed_bytes);
+
+  uint32_t GetLoadedCount() const {
+    return num_loaded_;
+  }
+
+  uint32_t GetBakedCount() const {
+    return num_baked_;
+  }
+
+  uint64_t GetSavedBytes() const {
+    return uncompressed_bytes_ - compressed_bytes_;
+  }
+
+  uint64_t GetCompressedBytes() const {
+    return compressed_bytes_;
+  }
+
+private:
+  std::string GetPath(uint64_t key) const;
+
+  std::string directory_;
+  // Read by the loader threads
+  std::atomic<GLenum> linear_format_;
+  std::atomic<GLenum> srgb_format_;
+  std::atomic<uint32_t> num_loaded_;
+  std::atomic<uint32_t> num_baked_;
+  std::atomic<uint64_t> compressed_bytes_;
+  std::atomic<uint64_t> uncompressed_bytes_;
+};
+}
+}
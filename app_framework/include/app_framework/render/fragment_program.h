@@ -19,6 +19,12 @@ public:
   // Initialize the program with null-terminated code string
   FragmentProgram(const char *code) : Program(code, GL_FRAGMENT_SHADER) {}
   virtual ~FragmentProgram() = default;
+
+  // Variant compiled with the INSTANCED define, taking the per instance
+  // values from the vertex stage. nullptr when not handled.
+  std::shared_ptr<FragmentProgram> GetInstancedVariant() const {
+    return GetVariant<FragmentProgram>("INSTANCED", "  #define INSTANCED 1\n");
+  }
 };
 }
 }
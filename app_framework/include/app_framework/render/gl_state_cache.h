@@ -0,0 +1,103 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <app_framework/common.h>
+
+namespace ml {
+namespace app_framework {
+
+// Shadow of the GL state set by the renderer, calls that would not change
+// anything are skipped. The bound objects are forgotten at the beginning of
+// each frame and after the render callbacks. Code changing the other state
+// directly without restoring it has to call Invalidate afterwards.
+class GLStateCache final {
+public:
+  GLStateCache();
+  ~GLStateCache() = default;
+
+  void Enable(GLenum capability);
+  void Disable(GLenum capability);
+  void BlendFunc(GLenum src, GLenum dst);
+  void PolygonMode(GLenum mode);
+  void PointSize(float size);
+
+  void BindProgramPipeline(GLuint pipeline);
+  void BindVertexArray(GLuint vertex_array);
+  void BindUniformBufferRange(GLuint binding, GLuint buffer, uint64_t offset, uint64_t size);
+  void BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+  // Forget everything, after GL calls made outside of the cache
+  void Invalidate();
+
+  // Forget the bound objects only, their names can be reused once they are deleted
+  void InvalidateBindings();
+
+  // Calls issued and skipped since the last reset
+  void ResetCounters();
+
+  uint64_t GetIssuedCount() const {
+    return num_issued_;
+  }
+
+  uint64_t GetElidedCount() const {
+    return num_elided_;
+  }
+
+private:
+  struct BufferRange {
+    GLuint buffer;
+    uint64_t offset;
+    uint64_t size;
+    bool operator==(const BufferRange &rhs) const {
+      return buffer == rhs.buffer && offset == rhs.offset && size == rhs.size;
+    }
+  };
+
+  struct TextureBinding {
+    GLenum target;
+    GLuint texture;
+    bool operator==(const TextureBinding &rhs) const {
+      return target == rhs.target && texture == rhs.texture;
+    }
+  };
+
+  // True when the call has to be issued, the cached value is updated
+  template <typename T>
+  bool Update(T &cached, const T &value) {
+    if (cached == value) {
+      ++num_elided_;
+      return false;
+    }
+    cached = value;
+    ++num_issued_;
+    return true;
+  }
+
+  void SetCapability(GLenum capability, bool enabled);
+
+  std::unordered_map<GLenum, bool> capabilities_;
+  std::pair<GLenum, GLenum> blend_func_;
+  GLenum polygon_mode_;
+  float point_size_;
+
+  GLuint program_pipeline_;
+  GLuint vertex_array_;
+  std::vector<BufferRange> uniform_buffers_;
+  GLuint active_texture_unit_;
+  std::vector<TextureBinding> textures_;
+
+  uint64_t num_issued_;
+  uint64_t num_elided_;
+};
+}
+}
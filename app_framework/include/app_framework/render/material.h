@@ -7,13 +7,16 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #pragma once
+#include <cstddef>
+#include <cstring>
 #include <unordered_map>
 #include <vector>
 
 #include <app_framework/common.h>
 #include "fragment_program.h"
 #include "geometry_program.h"
-#include "uniform_buffer.h"
+#include "gl_state_cache.h"
+#include "material_param_arena.h"
 #include "variable.h"
 #include "vertex_program.h"
 
@@ -32,12 +35,40 @@ namespace app_framework {
     return variable->GetValue<type>();        \
   }
 
+// Typed parameters, for materials that mirror their std140 Material block with
+// a plain struct. The setters write straight into the shadow copy of the block.
+#define MATERIAL_PARAM_DECLARE(type, name)  \
+  inline void Set##name(const type &value) { \
+    params_.name = value;                    \
+    dirty_ = true;                           \
+  }                                          \
+  inline type Get##name() const {            \
+    return static_cast<type>(params_.name);  \
+  }
+
+// Member of a parameter struct, checked against the reflected Material block
+struct MaterialParamField {
+  const char *name;
+  uint64_t offset;
+  uint64_t size;
+};
+
+#define MATERIAL_PARAM_FIELD(params_type, name) MaterialParamField{#name, offsetof(params_type, name), sizeof(params_type::name)}
+
+// A std140 bool takes 4 bytes
+typedef uint32_t Std140Bool;
+
 // The shading information that is required for rendering
 class Material {
 public:
-  Material() : dirty_(true) {}
+  Material();
   Material(const Material& rhs);
-  virtual ~Material() = default;
+  virtual ~Material();
+
+  // Unique for the lifetime of the application, used to group draws by material
+  uint32_t GetId() const {
+    return id_;
+  }
 
   std::shared_ptr<VertexProgram> GetVertexProgram() const {
     return vert_;
@@ -69,23 +100,95 @@ public:
     BuildVariable();
   }
 
-  std::shared_ptr<UniformBuffer> UpdateMaterialUniformBuffer();
-  void UpdateMaterialUniforms();
+  // Called by the renderer before the draw order of the frame is built, for
+  // materials whose programs depend on their parameters. True when the programs changed.
+  virtual bool UpdatePrograms() {
+    return false;
+  }
+
+  // Write the Material block to the slot of the material in its arena when a parameter changed
+  void UpdateMaterialParams();
+  void UpdateMaterialUniforms(GLStateCache &state);
+
+  // Arena of the Material block, nullptr when the fragment program has none
+  const std::shared_ptr<MaterialParamArena> &GetParamArena() const {
+    return param_arena_;
+  }
+
+  uint32_t GetParamSlot() const {
+    return param_slot_;
+  }
+
+  // Materials whose programs have an INSTANCED variant can be drawn in instanced
+  // batches with the other renderables of the same mesh, programs and options.
+  // The per instance color is mixed over the vertex color by the weight.
+  virtual bool IsInstanceable() const {
+    return false;
+  }
+  virtual void GetInstanceColor(glm::vec4 &color, float &color_weight) const {}
 
 protected:
+  // Shadow copy of the Material block of materials with typed parameters, nullptr otherwise
+  virtual const char *GetParamsData() const {
+    return nullptr;
+  }
+  virtual uint64_t GetParamsSize() const {
+    return 0;
+  }
+  virtual std::vector<MaterialParamField> GetParamFields() const {
+    return {};
+  }
+
+  // For the copies of typed materials, the base copy constructor reflects the Material block as
+  // variables before the parameter struct exists. Drops them and checks the struct instead.
+  void UseTypedParams();
+
   bool dirty_;
 private:
   void BuildVariable();
+  void ValidateParams() const;
 
+  uint32_t id_;
   std::shared_ptr<FragmentProgram> frag_;
   std::shared_ptr<GeometryProgram> geom_;
   std::shared_ptr<VertexProgram> vert_;
 
   std::unordered_map<std::string, std::shared_ptr<Variable>> variables_by_name_;
-  std::shared_ptr<UniformBuffer> buffer_;
+  std::shared_ptr<MaterialParamArena> param_arena_;
+  uint32_t param_slot_;
+  // Packing space of the materials without typed parameters
   std::vector<char> ubo_cache_;
   UniformBlockDescription blk_desc_;
   std::vector<UniformDescription> textures_des_;
+  std::vector<std::shared_ptr<Variable>> texture_variables_;
+};
+
+// Material whose Material block is laid out by the std140 struct Params. The
+// struct lists its members in a static GetFields(), the offsets and sizes are
+// checked against the shader reflection when the fragment program is set.
+template <typename Params>
+class TypedMaterial : public Material {
+public:
+  TypedMaterial() {
+    memset(&params_, 0, sizeof(Params));
+  }
+  TypedMaterial(const TypedMaterial &rhs) : Material(rhs), params_(rhs.params_) {
+    UseTypedParams();
+  }
+  virtual ~TypedMaterial() = default;
+
+protected:
+  const char *GetParamsData() const override {
+    return reinterpret_cast<const char *>(&params_);
+  }
+  uint64_t GetParamsSize() const override {
+    return sizeof(Params);
+  }
+  std::vector<MaterialParamField> GetParamFields() const override {
+    return Params::GetFields();
+  }
+
+  Params params_;
 };
 }
 }
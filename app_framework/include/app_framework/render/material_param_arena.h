@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <memory>
+#include <vector>
+
+#include <app_framework/common.h>
+#include "buffer.h"
+
+namespace ml {
+namespace app_framework {
+
+// Material blocks of every material sharing a fragment program, kept in one
+// uniform buffer. Each material owns a slot, written to the CPU copy when its
+// parameters change. The dirty range is uploaded once per frame and draws
+// select their slot with glBindBufferRange.
+class MaterialParamArena final {
+public:
+  MaterialParamArena(uint64_t block_size);
+  ~MaterialParamArena() = default;
+
+  // Shared arena of the materials using the fragment program, alive as long as one of them is
+  static std::shared_ptr<MaterialParamArena> Get(GLuint fragment_program, uint64_t block_size);
+
+  // Upload the dirty range of every arena, before the frame is drawn
+  static void FlushAll();
+
+  uint32_t Allocate();
+  void Release(uint32_t slot);
+
+  // Write the block of the slot, uploaded with the next flush
+  void Write(uint32_t slot, const char *data, uint64_t size);
+
+  uint64_t GetOffset(uint32_t slot) const {
+    return slot * slot_size_;
+  }
+
+  uint64_t GetBlockSize() const {
+    return block_size_;
+  }
+
+  GLuint GetGLBuffer() const {
+    return buffer_->GetGLBuffer();
+  }
+
+  void Flush();
+
+private:
+  uint64_t block_size_;
+  // Block size padded to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+  uint64_t slot_size_;
+  std::vector<char> data_;
+  std::vector<uint32_t> free_slots_;
+  uint64_t dirty_begin_;
+  uint64_t dirty_end_;
+  std::shared_ptr<Buffer> buffer_;
+};
+}
+}
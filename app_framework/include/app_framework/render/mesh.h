@@ -10,11 +10,12 @@
 #include <unordered_map>
 
 #include <app_framework/common.h>
+#include "gl_state_cache.h"
 #include "index_buffer.h"
 #include "texture.h"
 #include "uniform_buffer.h"
 #include "vertex_buffer.h"
-#include "program.h"
+#include "vertex_program.h"
 
 namespace ml {
 namespace app_framework {
@@ -26,7 +27,12 @@ class Mesh : public RuntimeType {
   RUNTIME_TYPE_REGISTER(Mesh)
 public:
   Mesh(Buffer::Category buffer_category, GLint index_buffer_element_type = GL_UNSIGNED_INT);
-  virtual ~Mesh() = default;
+  virtual ~Mesh();
+
+  // Unique for the lifetime of the application, used to group draws by mesh
+  uint32_t GetId() const {
+    return id_;
+  }
 
   std::shared_ptr<VertexBuffer> GetVertexBuffer() const {
     return vert_buffer_;
@@ -73,7 +79,33 @@ public:
     }
   }
 
+  // Mesh drawing the vertices of this one with other indices of the same type, the vertex buffers are shared
+  std::shared_ptr<Mesh> CreateLod(void const *indices, size_t num_indices) const;
+
+  // Vertex array with the buffers of the mesh bound to the attributes of the program, left bound.
+  // Created once per attribute layout and rebuilt only when a buffer of the mesh is reallocated.
+  GLuint GetVertexArray(const VertexProgram &program, GLStateCache &state);
+
+  // Storage allocated by the buffers of the mesh
+  uint64_t GetGPUByteSize() const;
+
 private:
+  struct VertexArray {
+    GLuint gl_vertex_array;
+    uint64_t layout_version;
+    // Streamed buffers move to another region with every update, rebound on each use
+    std::vector<std::pair<GLuint, std::shared_ptr<VertexBuffer>>> streamed_attributes;
+  };
+
+  // Sum of the allocation versions, they only increase so any reallocation changes it
+  uint64_t GetLayoutVersion() const;
+  void BindAttribute(const std::shared_ptr<VertexBuffer> &buffer, const std::string &name,
+                     const std::unordered_map<std::string, VertexAttributeDescription> &vertex_attr_list,
+                     VertexArray &vertex_array);
+  static void BindAttributeBuffer(GLuint location, const VertexBuffer &buffer);
+
+  std::unordered_map<uint32_t, VertexArray> vertex_arrays_;
+  uint32_t id_;
   std::shared_ptr<VertexBuffer> normal_buffer_;
   std::shared_ptr<IndexBuffer> index_buffer_;
   std::shared_ptr<VertexBuffer> vert_buffer_;
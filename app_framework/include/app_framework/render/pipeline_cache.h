@@ -0,0 +1,83 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <functional>
+#include <tuple>
+#include <unordered_map>
+
+#include <app_framework/common.h>
+
+namespace ml {
+namespace app_framework {
+// Vertex, geometry and fragment programs of a draw, 0 for an unused stage
+typedef std::tuple<GLuint, GLuint, GLuint> ShaderKey;
+}
+}
+namespace std {
+template <>
+struct hash<ml::app_framework::ShaderKey> {
+  std::size_t operator()(const ml::app_framework::ShaderKey &key) const {
+    std::size_t seed = 0;
+    for (GLuint program : {std::get<0>(key), std::get<1>(key), std::get<2>(key)}) {
+      seed ^= std::hash<GLuint>()(program) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+  }
+};
+}
+
+namespace ml {
+namespace app_framework {
+
+// Program pipelines of the program combinations, created once. Combinations known
+// in advance are warmed up front so no pipeline is created while drawing a frame.
+class PipelineCache final {
+public:
+  PipelineCache();
+  ~PipelineCache();
+
+  // Pipeline of the combination, created on the first miss
+  GLuint GetPipeline(const ShaderKey &key);
+
+  // Create the pipeline of the combination if it does not exist yet
+  void Warm(const ShaderKey &key);
+
+  size_t GetPipelineCount() const {
+    return pipelines_.size();
+  }
+
+  // Lookups since startup and the pipelines they had to create
+  uint64_t GetHitCount() const {
+    return num_hits_;
+  }
+
+  uint64_t GetMissCount() const {
+    return num_misses_;
+  }
+
+  uint64_t GetWarmedCount() const {
+    return num_warmed_;
+  }
+
+  // Time spent creating pipelines, warmed ones included
+  double GetCreationTime() const {
+    return creation_time_;
+  }
+
+private:
+  GLuint CreatePipeline(const ShaderKey &key);
+
+  std::unordered_map<ShaderKey, GLuint> pipelines_;
+  uint64_t num_hits_;
+  uint64_t num_misses_;
+  uint64_t num_warmed_;
+  double creation_time_;
+};
+}
+}
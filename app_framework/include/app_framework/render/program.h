@@ -7,6 +7,7 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #pragma once
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -22,6 +23,10 @@ public:
   static const std::string kPosition;
   static const std::string kNormal;
   static const std::string kTextureCoordinates;
+  static const std::string kTangent;
+  static const std::string kInstanceModel;
+  static const std::string kInstanceColor;
+  static const std::string kInstanceColorWeight;
 };
 
 class UniformName final {
@@ -30,6 +35,7 @@ public:
   static const std::string kMaterial;
   static const std::string kTransforms;
   static const std::string kLight;
+  static const std::string kStereoTransforms;
 };
 
 struct VertexAttributeDescription {
@@ -85,7 +91,38 @@ public:
     return type_;
   };
 
+  // Insert the preamble (defines, extensions) right after the #version directive of the code
+  static std::string InjectPreamble(const char *code, const std::string &preamble);
+
+protected:
+  // Program compiled from the same code with the preamble, cached per preamble.
+  // nullptr when the code does not use the define.
+  template <typename T>
+  std::shared_ptr<T> GetVariant(const char *define, const std::string &preamble) const {
+    if (code_.find(define) == std::string::npos) {
+      return nullptr;
+    }
+    auto it = variants_.find(preamble);
+    if (it != variants_.end()) {
+      return std::static_pointer_cast<T>(it->second);
+    }
+    auto variant = std::make_shared<T>(InjectPreamble(code_.c_str(), preamble).c_str());
+    variants_[preamble] = variant;
+    return variant;
+  }
+
 private:
+  // Link a separable program from the code, the binary can be retrieved afterwards
+  void Compile();
+  // Query the uniform blocks and uniforms, assigning the block bindings of the stage
+  void Reflect();
+  // Program and reflection from the program cache, false when the driver rejects the binary
+  bool LoadBinary(GLenum binary_format, const std::vector<char> &binary);
+  void SetReflection(const std::vector<UniformBlockDescription> &uniform_blocks,
+                     const std::vector<UniformDescription> &uniforms);
+
+  std::string code_;
+  mutable std::unordered_map<std::string, std::shared_ptr<Program>> variants_;
   GLuint program_;
   GLenum type_;
   GLint uniform_cnt_;
@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <app_framework/common.h>
+#include "program.h"
+
+namespace ml {
+namespace app_framework {
+
+// Linked programs kept on disk across launches, one file per program holding
+// the output of glGetProgramBinary with the reflected uniform tables. Files are
+// keyed by the code and the driver, a driver update recompiles everything.
+class ProgramCache final {
+public:
+  struct Entry {
+    GLenum binary_format;
+    std::vector<char> binary;
+    std::vector<UniformBlockDescription> uniform_blocks;
+    std::vector<UniformDescription> uniforms;
+  };
+
+  ProgramCache();
+  ~ProgramCache() = default;
+
+  static const std::unique_ptr<ProgramCache> &GetInstance();
+
+  // Directory the files are kept in, the cache is disabled while it is empty
+  void SetDirectory(const std::string &directory);
+
+  bool IsEnabled() const {
+    return !directory_.empty();
+  }
+
+  // Key of the program for the current driver, needs a current context
+  uint64_t GetKey(const std::string &code, GLenum type);
+
+  // False when there is no usable file for the key
+  bool Load(uint64_t key, Entry &entry) const;
+  void Store(uint64_t key, const Entry &entry) const;
+
+  // Time spent creating programs since startup, split by where they came from
+  void AddProgram(bool loaded, double seconds);
+
+  uint32_t GetLoadedCount() const {
+    return num_loaded_;
+  }
+
+  uint32_t GetCompiledCount() const {
+    return num_compiled_;
+  }
+
+  double GetBuildTime() const {
+    return build_time_;
+  }
+
+private:
+  std::string GetPath(uint64_t key) const;
+
+  std::string directory_;
+  // Vendor, renderer and version strings, read with the first key
+  std::string driver_;
+  uint32_t num_loaded_;
+  uint32_t num_compiled_;
+  double build_time_;
+};
+}
+}
@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <unordered_set>
+#include <vector>
+
+#include <app_framework/common.h>
+#include <app_framework/components/camera_component.h>
+#include <app_framework/components/light_component.h>
+#include <app_framework/components/renderable_component.h>
+
+namespace ml {
+namespace app_framework {
+
+class Node;
+
+// Flat list of the render related components of a scene graph. Nodes report
+// hierarchy and component changes through MarkDirty, and the list is patched
+// in Update instead of walking the whole graph every frame.
+class RenderList final {
+public:
+  RenderList() : reindexed_node_count_(0) {}
+  ~RenderList() = default;
+
+  // Queue the node to be re-indexed on the next Update
+  void MarkDirty(std::shared_ptr<Node> node);
+
+  // Apply the pending changes to the flat component arrays
+  void Update();
+
+  const std::vector<std::shared_ptr<RenderableComponent>> &GetRenderables() const {
+    return renderables_;
+  }
+
+  const std::vector<std::shared_ptr<CameraComponent>> &GetCameras() const {
+    return cameras_;
+  }
+
+  const std::vector<std::shared_ptr<LightComponent>> &GetLights() const {
+    return lights_;
+  }
+
+  // Number of nodes that were re-indexed by the last Update
+  size_t GetReindexedNodeCount() const {
+    return reindexed_node_count_;
+  }
+
+private:
+  void RemoveNodes(const std::unordered_set<const Node *> &nodes);
+
+  std::vector<std::shared_ptr<Node>> pending_nodes_;
+  std::unordered_set<const Node *> indexed_nodes_;
+
+  std::vector<std::shared_ptr<RenderableComponent>> renderables_;
+  std::vector<std::shared_ptr<CameraComponent>> cameras_;
+  std::vector<std::shared_ptr<LightComponent>> lights_;
+  size_t reindexed_node_count_;
+};
+
+}  // namespace app_framework
+}  // namespace ml
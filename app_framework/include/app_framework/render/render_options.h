@@ -15,11 +15,15 @@ namespace app_framework {
 
 // Render options and states
 struct RenderOptions final {
-  RenderOptions() : primitives(GL_TRIANGLES), fillmode(GL_FILL) {}
+  RenderOptions() : primitives(GL_TRIANGLES), fillmode(GL_FILL), layer(0), transparent(false) {}
 
   GLint primitives;
   GLint fillmode;
   GLfloat point_size;
+  // Layers are drawn in increasing order, only the lowest 4 bits are used
+  uint8_t layer;
+  // Transparent renderables are drawn back to front after the opaque ones of their layer
+  bool transparent;
 };
 
 }
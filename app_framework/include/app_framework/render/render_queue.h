@@ -0,0 +1,60 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <unordered_map>
+#include <vector>
+
+#include <app_framework/common.h>
+#include <app_framework/components/renderable_component.h>
+#include "pipeline_cache.h"
+
+namespace ml {
+namespace app_framework {
+
+// Draw order of the queued renderables. Every visible renderable gets one
+// 64 bit key per frame, from the most to the least significant bits:
+//   opaque:      layer(4) | 0 | pipeline(12) | material(14) | mesh(12) | depth(21)
+//   transparent: layer(4) | 1 | inverted depth(21) | pipeline(12) | material(14) | mesh(12)
+// Opaque draws are grouped by state and then drawn front to back, transparent
+// draws are drawn back to front. Instanceable materials use 0 as material so
+// the draws sharing their mesh end up next to each other. The keys are radix
+// sorted once per frame from the center of the cameras and the order is shared
+// by all of them.
+class RenderQueue final {
+public:
+  RenderQueue() = default;
+  ~RenderQueue() = default;
+
+  // The program stages used to draw the renderable
+  static ShaderKey GetShaderKey(const RenderableComponent &renderable);
+
+  void Build(const std::vector<std::shared_ptr<RenderableComponent>> &renderables, const glm::vec3 &view_position);
+
+  // Indices into the renderables passed to Build, in draw order
+  const std::vector<uint32_t> &GetOrder() const {
+    return order_;
+  }
+
+private:
+  struct Entry {
+    uint64_t key;
+    uint32_t index;
+  };
+
+  uint32_t GetPipelineId(const ShaderKey &shader_key);
+  void Sort();
+
+  std::unordered_map<ShaderKey, uint32_t> pipeline_ids_;
+  std::vector<Entry> entries_;
+  std::vector<Entry> scratch_entries_;
+  std::vector<uint32_t> order_;
+};
+
+}  // namespace app_framework
+}  // namespace ml
@@ -8,6 +8,7 @@
 // %BANNER_END%
 #pragma once
 #include <app_framework/common.h>
+#include "stereo_mode.h"
 #include "texture.h"
 
 namespace ml {
@@ -15,11 +16,17 @@ namespace app_framework {
 
 class RenderTarget final {
 public:
-  RenderTarget(int32_t width, int32_t height) : gl_framebuffer_(0), color_layer_index_(0), depth_layer_index_(0), width_(width), height_(height) {}
+  RenderTarget(int32_t width, int32_t height) : gl_framebuffer_(0), color_layer_index_(0), depth_layer_index_(0), width_(width), height_(height), stereo_mode_(StereoMode::None) {}
   RenderTarget(std::shared_ptr<Texture> color, std::shared_ptr<Texture> depth,
                uint32_t color_layer_index, uint32_t depth_layer_index)
     : color_layer_index_(color_layer_index), depth_layer_index_(depth_layer_index),
-      color_(color), depth_(depth) {
+      color_(color), depth_(depth), stereo_mode_(StereoMode::None) {
+      InitializeFramebuffer();
+    }
+  // Layered target covering both eyes of texture arrays, for single pass stereo
+  RenderTarget(std::shared_ptr<Texture> color, std::shared_ptr<Texture> depth, StereoMode stereo_mode)
+    : color_layer_index_(0), depth_layer_index_(0),
+      color_(color), depth_(depth), stereo_mode_(stereo_mode) {
       InitializeFramebuffer();
     }
   ~RenderTarget();
@@ -66,8 +73,22 @@ public:
     return depth_layer_index_;
   }
 
+  StereoMode GetStereoMode() const {
+    return stereo_mode_;
+  }
+
+  // Layered target sharing the textures of this one, set on the per eye targets
+  void SetStereoRenderTarget(std::shared_ptr<RenderTarget> stereo_render_target) {
+    stereo_render_target_ = stereo_render_target;
+  }
+
+  std::shared_ptr<RenderTarget> GetStereoRenderTarget() const {
+    return stereo_render_target_;
+  }
+
 private:
   void InitializeFramebuffer();
+  void AttachTexture(GLenum attachment, const Texture &texture, uint32_t layer_index);
   std::shared_ptr<Texture> color_;
   std::shared_ptr<Texture> depth_;
   uint32_t color_layer_index_;
@@ -75,6 +96,8 @@ private:
   int32_t width_;
   int32_t height_;
   GLuint gl_framebuffer_;
+  StereoMode stereo_mode_;
+  std::shared_ptr<RenderTarget> stereo_render_target_;
 };
 
 }  // namespace app_framework
@@ -7,7 +7,6 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #pragma once
-#include <tuple>
 #include <unordered_map>
 #include <functional>
 
@@ -18,22 +17,13 @@
 #include <app_framework/components/light_component.h>
 #include "fragment_program.h"
 #include "geometry_program.h"
+#include "gl_state_cache.h"
+#include "pipeline_cache.h"
+#include "render_list.h"
+#include "render_queue.h"
+#include "stereo_mode.h"
 #include "vertex_program.h"
 
-namespace ml {
-namespace app_framework {
-typedef std::tuple<GLuint, GLuint, GLuint> ShaderKey;
-}
-}
-namespace std {
-template <>
-struct hash<ml::app_framework::ShaderKey> {
-  std::size_t operator()(const ml::app_framework::ShaderKey &key) const {
-    return (int)std::get<0>(key) << 16 & (int)std::get<1>(key) << 16 << (int)std::get<2>(key);
-  }
-};
-}
-
 namespace ml {
 namespace app_framework {
 
@@ -56,6 +46,19 @@ struct TransformsUBO {
   float pad0;
 };
 
+// View projection of both eyes, indexed by STEREO_EYE in the stereo variants
+struct StereoTransformsUBO {
+  glm::mat4 view_proj[2];
+};
+
+// Per instance attributes of the instanced batches, see INSTANCED in the programs
+struct InstanceData {
+  glm::mat4 model;
+  glm::vec4 color;
+  float color_weight;
+  float pad[3];
+};
+
 struct Light {
   Light() {}
   Light(
@@ -96,8 +99,13 @@ public:
   Renderer();
   ~Renderer();
 
+  // Creates the pipelines of the framework materials, call SetSinglePassStereo first
   void Initialize();
 
+  // Create the pipelines of every combination the material can be drawn with,
+  // ahead of the first frame it is visible in
+  void WarmPipelines(const Material &material);
+
   void Visit(std::shared_ptr<Node> node) {
     auto renderable = node->GetComponent<RenderableComponent>();
     if (renderable) {
@@ -113,9 +121,60 @@ public:
     }
   }
 
+  // Queue every component of an up to date render list
+  void Visit(const RenderList &render_list) {
+    const auto &renderables = render_list.GetRenderables();
+    queued_renderables_.insert(queued_renderables_.end(), renderables.begin(), renderables.end());
+    const auto &cameras = render_list.GetCameras();
+    queued_cameras_.insert(queued_cameras_.end(), cameras.begin(), cameras.end());
+    const auto &lights = render_list.GetLights();
+    queued_lights_.insert(queued_lights_.end(), lights.begin(), lights.end());
+  }
+
   // Render the queued renderables
   void Render();
 
+  // Draw both eyes in one pass when the cameras share a layered render target,
+  // using GL_OVR_multiview when available and instanced gl_Layer routing otherwise
+  void SetSinglePassStereo(bool enable);
+
+  StereoMode GetStereoMode() const {
+    return stereo_mode_;
+  }
+
+  // Instanced batches of the last frame and the draws they replaced
+  size_t GetInstancedBatchCount() const {
+    return num_instanced_batches_;
+  }
+
+  size_t GetInstancedDrawCount() const {
+    return num_instanced_draws_;
+  }
+
+  // Largest error in pixels a level of detail may show before a finer one is drawn
+  void SetLodPixelError(float pixels) {
+    lod_pixel_error_ = pixels;
+  }
+
+  // Triangles drawn by the last frame, every view counted, and the ones the meshes would take at full detail
+  uint64_t GetTriangleCount() const {
+    return num_triangles_;
+  }
+
+  uint64_t GetFullDetailTriangleCount() const {
+    return num_full_detail_triangles_;
+  }
+
+  const PipelineCache &GetPipelineCache() const {
+    return pipeline_cache_;
+  }
+
+  // Counts the GL calls issued and skipped by the last frame, see GLStateCache for
+  // the state code outside of the renderer has to report with Invalidate
+  GLStateCache &GetGLStateCache() {
+    return gl_state_;
+  }
+
   void ClearQueues();
 
   void SetPreRenderCameraCallback(const std::function<void(std::shared_ptr<CameraComponent>)>& callback) { pre_cam_callback_ = callback;}
@@ -148,13 +207,30 @@ public:
   }
 
 private:
-  void Render(std::shared_ptr<RenderableComponent> renderable);
+  void Render(std::shared_ptr<RenderableComponent> renderable, bool stereo, uint32_t instance_count,
+              uint64_t instance_offset);
+
+  // Number of draws from order[start] on that can be drawn as one instanced batch
+  size_t GetBatchSize(const std::vector<uint32_t> &order, size_t start) const;
+
+  // Draw order[start] together with the draws batched with it, returns the number of draws consumed.
+  // In the stereo pass 0 is returned when the draw has to be rendered once per eye.
+  size_t RenderBatch(const std::vector<uint32_t> &order, size_t start, bool stereo);
+
+  inline void BindInstanceAttribute(const std::string &attribute_name, GLint element_count, uint64_t offset,
+                                    GLuint divisor,
+                                    const std::unordered_map<std::string, VertexAttributeDescription> &vertex_attr_list);
 
-  inline void BindBuffer(const std::shared_ptr<VertexBuffer>& buffer,
-                         const std::string& buffer_name,
-                         const std::unordered_map<std::string, VertexAttributeDescription>& vertex_attr_list);
+  // Render the given draws of one camera, the pre camera callback is left to the caller
+  void RenderCamera(std::shared_ptr<CameraComponent> cam, const std::vector<uint32_t> &order, bool clear);
 
-  inline void BindTransformUniform(std::shared_ptr<Program> program, const TransformsUBO& transforms_ubo);
+  // Render a pair of eye cameras in a single pass, false when they can not share one
+  bool RenderStereo(std::shared_ptr<CameraComponent> left_cam, std::shared_ptr<CameraComponent> right_cam);
+
+  inline void BindTransformUniform(std::shared_ptr<Program> program, uint64_t transforms_offset);
+
+  // Level of detail of each queued renderable from its size on screen under the queued cameras
+  void SelectLods();
 
   // Queue a camera as a render target
   void QueueCamera(std::shared_ptr<CameraComponent> camera);
@@ -174,19 +250,36 @@ private:
   std::vector<std::shared_ptr<RenderableComponent>> queued_renderables_;
   std::vector<std::shared_ptr<CameraComponent>> queued_cameras_;
   std::vector<std::shared_ptr<LightComponent>> queued_lights_;
+  RenderQueue render_queue_;
   std::shared_ptr<CameraComponent> current_cam_;
   std::shared_ptr<VertexProgram> current_vertex_program_;
   std::shared_ptr<FragmentProgram> current_frag_program_;
   std::shared_ptr<GeometryProgram> current_geom_program_;
 
+  GLStateCache gl_state_;
   GLuint program_pipeline_;
-  std::unordered_map<ShaderKey, GLuint> shader_program_cache_;
+  PipelineCache pipeline_cache_;
 
-  std::shared_ptr<UniformBuffer> transform_uniform_buffer_;
-  std::shared_ptr<UniformBuffer> light_uniform_buffer_;
+  // Per frame ring holding the lights block and one transforms block per draw
+  std::shared_ptr<UniformBuffer> frame_uniform_buffer_;
+  uint64_t lights_offset_;
+  uint64_t stereo_transforms_offset_;
   std::vector<Light> lights_;
-  bool transform_uniform_buffer_dirty_;
-  GLuint vertex_array_;
+
+  StereoMode stereo_mode_;
+  // Center of the eyes of the current stereo pass
+  glm::vec3 stereo_camera_position_;
+  // Draws of the stereo pass without a stereo variant, rendered once per eye
+  std::vector<uint32_t> fallback_order_;
+
+  std::vector<InstanceData> instance_data_;
+  std::vector<GLint> instance_attribute_locations_;
+  size_t num_instanced_batches_;
+  size_t num_instanced_draws_;
+
+  float lod_pixel_error_;
+  uint64_t num_triangles_;
+  uint64_t num_full_detail_triangles_;
 };
 
 }
@@ -0,0 +1,25 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+
+namespace ml {
+namespace app_framework {
+
+// How both eyes are rendered in a single pass
+enum class StereoMode {
+  // One pass per eye
+  None,
+  // Two instances per draw, the vertex shader routes each one to a layer with gl_Layer
+  InstancedLayer,
+  // GL_OVR_multiview, the driver broadcasts each draw to both layers
+  Multiview,
+};
+
+}
+}
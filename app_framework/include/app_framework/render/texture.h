@@ -12,6 +12,14 @@
 namespace ml {
 namespace app_framework {
 
+// Level of a mip chain within the data of a texture
+struct TextureLevel {
+  int32_t width;
+  int32_t height;
+  uint64_t offset;
+  uint64_t size;
+};
+
 class Texture final {
 public:
   Texture(GLint texture_type, GLuint tex, int32_t width, int32_t height, bool owned = false)
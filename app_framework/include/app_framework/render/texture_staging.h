@@ -0,0 +1,137 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <app_framework/common.h>
+#include "texture.h"
+
+namespace ml {
+namespace app_framework {
+
+// Texture uploads through a ring of pixel unpack buffer memory. Pixels are
+// staged from any thread, straight into the ring when it is persistently mapped
+// and has room, otherwise they are kept in client memory and copied in later.
+// The render thread commits them level by level with glTexSubImage2D, or its
+// compressed variant, a few rows at a time. The ring space is reused once the
+// fence of the copy is signaled.
+class TextureStaging final {
+public:
+  // Mip chain waiting for its upload, RGBA8 pixels or blocks of a compressed format
+  class Image final {
+  public:
+    ~Image();
+
+    GLenum GetCompressedFormat() const {
+      return compressed_format_;
+    }
+
+    const std::vector<TextureLevel> &GetLevels() const {
+      return levels_;
+    }
+
+    // Bytes of all the levels
+    uint64_t GetSize() const;
+
+  private:
+    friend class TextureStaging;
+    Image(TextureStaging *staging, const std::vector<TextureLevel> &levels, GLenum compressed_format);
+
+    TextureStaging *staging_;
+    std::vector<TextureLevel> levels_;
+    GLenum compressed_format_;
+    // Region of the ring holding the data, 0 when it is in data_
+    uint64_t region_;
+    uint64_t offset_;
+    std::vector<unsigned char> data_;
+  };
+
+  // Needs a current context, the ring is created right away
+  TextureStaging(uint64_t ring_size);
+  ~TextureStaging();
+
+  // Any thread, the data is moved out of the vector. Compressed formats have 4x4 blocks.
+  std::shared_ptr<Image> Stage(std::vector<unsigned char> &&data, const std::vector<TextureLevel> &levels,
+                               GLenum compressed_format = 0);
+
+  // Render thread, queues the levels of the image for the texture which must already have their storage.
+  // Returns the ticket of the upload.
+  uint64_t Upload(const std::shared_ptr<Texture> &texture, const std::shared_ptr<Image> &image);
+
+  // Render thread, issues the queued uploads in order until about budget_bytes are copied, at least one slice
+  void Commit(uint64_t budget_bytes);
+
+  // True once the upload of the ticket and all the ones before it are issued
+  bool IsComplete(uint64_t ticket) const {
+    return ticket <= completed_ticket_;
+  }
+
+  // Ticket of the upload still queued for the texture, 0 when there is none
+  uint64_t GetPendingTicket(const std::shared_ptr<Texture> &texture) const;
+
+  size_t GetQueueDepth() const {
+    return uploads_.size();
+  }
+
+  uint64_t GetQueuedBytes() const;
+
+  // Bytes committed to textures since startup
+  uint64_t GetCommittedBytes() const {
+    return committed_bytes_;
+  }
+
+private:
+  struct Region {
+    uint64_t id;
+    uint64_t begin;
+    uint64_t end;
+    // Set with the last copy out of the region
+    GLsync fence;
+    // Nothing will copy out of the region any more
+    bool released;
+  };
+
+  struct PendingUpload {
+    std::shared_ptr<Texture> texture;
+    std::shared_ptr<Image> image;
+    size_t level;
+    // In rows of blocks for compressed formats
+    int32_t next_row;
+    uint64_t committed;
+    uint64_t ticket;
+  };
+
+  // Reserves size bytes of contiguous ring space, false when there is not enough free now
+  bool Allocate(uint64_t size, uint64_t &region, uint64_t &offset);
+  void SetFence(uint64_t region, GLsync fence);
+  void Release(uint64_t region);
+  // Frees the regions at the tail whose copies are done
+  void Retire();
+
+  GLuint buffer_;
+  uint64_t ring_size_;
+  // Persistent mapping of the ring, null when the driver lacks buffer storage
+  unsigned char *data_;
+
+  // Ring state, shared with the staging threads
+  std::mutex mutex_;
+  std::deque<Region> regions_;
+  uint64_t head_;
+  uint64_t next_region_;
+
+  std::deque<PendingUpload> uploads_;
+  uint64_t next_ticket_;
+  uint64_t completed_ticket_;
+  uint64_t committed_bytes_;
+};
+}
+}
@@ -15,8 +15,43 @@ namespace app_framework {
 
 class UniformBuffer final : public Buffer {
 public:
-  UniformBuffer(Buffer::Category category) : Buffer(category, GL_UNIFORM_BUFFER) {}
-  ~UniformBuffer() = default;
+  // Number of frames the ring can have in flight
+  static const uint32_t kRingFrameCount = 3;
+
+  UniformBuffer(Buffer::Category category);
+  ~UniformBuffer();
+
+  // Ring allocation of per frame data. Blocks written between BeginFrame and
+  // EndFrame stay valid until the GPU is done with the frame, each one is
+  // bound with glBindBufferRange at the returned offset. The buffer is mapped
+  // persistently when GL_ARB_buffer_storage is available and falls back to
+  // glBufferSubData otherwise. A write that does not fit in the frame fails
+  // and the ring grows on the next BeginFrame, the draw using it has to be skipped.
+  void BeginFrame(uint64_t frame_size);
+  bool WriteBlock(const void *data, uint64_t size, uint64_t &offset);
+  void EndFrame();
+
+  // Size taken by a block in the ring, padded to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+  uint64_t GetAlignedSize(uint64_t size) const {
+    return (size + offset_alignment_ - 1) / offset_alignment_ * offset_alignment_;
+  }
+
+  bool IsPersistentlyMapped() const {
+    return mapped_data_ != nullptr;
+  }
+
+private:
+  void ResizeRing(uint64_t frame_capacity);
+
+  char *mapped_data_;
+  GLsync fences_[kRingFrameCount];
+  uint64_t offset_alignment_;
+  uint64_t frame_capacity_;
+  uint64_t frame_offset_;
+  uint64_t frame_end_;
+  uint32_t frame_index_;
+  // Bytes the writes of the frame asked for beyond its capacity
+  uint64_t overflow_size_;
 };
 }
 }
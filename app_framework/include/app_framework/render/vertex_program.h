@@ -9,6 +9,7 @@
 #pragma once
 #include <app_framework/common.h>
 #include "program.h"
+#include "stereo_mode.h"
 
 namespace ml {
 namespace app_framework {
@@ -24,8 +25,24 @@ public:
     return vertex_attrs_by_name_;
   }
 
+  // Identifies the set of attribute names and locations, equal for programs with the same layout
+  inline uint32_t GetAttributeLayoutId() const {
+    return attribute_layout_id_;
+  }
+
+  // Variant compiled with the STEREO define, drawing both eyes in one pass.
+  // nullptr when the shader does not handle the define (no StereoTransforms block).
+  std::shared_ptr<VertexProgram> GetStereoVariant(StereoMode mode) const;
+
+  // Variant compiled with the INSTANCED define, reading the model matrix and
+  // the color from the per instance attributes. nullptr when not handled.
+  std::shared_ptr<VertexProgram> GetInstancedVariant() const {
+    return GetVariant<VertexProgram>("INSTANCED", "  #define INSTANCED 1\n");
+  }
+
 private:
   GLint att_cnt_;
+  uint32_t attribute_layout_id_;
   std::unordered_map<std::string, VertexAttributeDescription> vertex_attrs_by_name_;
 };
 }
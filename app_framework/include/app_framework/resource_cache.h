@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace ml {
+namespace app_framework {
+
+struct ResourceUsage {
+  size_t entry_count = 0;
+  uint64_t cpu_bytes = 0;
+  uint64_t gpu_bytes = 0;
+};
+
+// Type independent part of a cache, lets the pool evict across all of them
+class ResourceCacheBase {
+public:
+  virtual ~ResourceCacheBase() = default;
+
+  // Marks the entries still referenced outside of the cache as used at tick
+  virtual void Touch(uint64_t tick) = 0;
+
+  // Least recently used entry nobody else references, nullptr when there is none
+  virtual const std::string *GetOldestUnreferenced(uint64_t &last_used) const = 0;
+
+  virtual void Erase(const std::string &key) = 0;
+
+  const ResourceUsage &GetUsage() const {
+    return usage_;
+  }
+
+protected:
+  ResourceUsage usage_;
+};
+
+// Resources by key with the memory they hold. Entries are only released
+// through eviction and only while the cache holds the last reference.
+template <typename T>
+class ResourceCache final : public ResourceCacheBase {
+public:
+  std::shared_ptr<T> Get(const std::string &key, uint64_t tick) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      return nullptr;
+    }
+    it->second.last_used = tick;
+    return it->second.element;
+  }
+
+  // Pinned entries are never evicted. An element replaced while still referenced stays accounted for
+  // under another key until it is evicted.
+  void Insert(const std::string &key, const std::shared_ptr<T> &element, uint64_t cpu_bytes, uint64_t gpu_bytes,
+              uint64_t tick, bool pinned = false) {
+    auto it = entries_.find(key);
+    if (it != entries_.end() && it->second.element != element && IsReferenced(it->second)) {
+      entries_[key + "#replaced" + std::to_string(++num_replaced_)] = it->second;
+      entries_.erase(it);
+    } else {
+      Erase(key);
+    }
+    entries_[key] = Entry{element, cpu_bytes, gpu_bytes, tick, pinned};
+    ++usage_.entry_count;
+    usage_.cpu_bytes += cpu_bytes;
+    usage_.gpu_bytes += gpu_bytes;
+  }
+
+  // Entries are also kept while the function reports them in use, for elements that only hold other
+  // resources and are never referenced themselves
+  void SetInUse(const std::function<bool(const T &)> &in_use) {
+    in_use_ = in_use;
+  }
+
+  void Touch(uint64_t tick) override {
+    for (auto &pair : entries_) {
+      if (IsReferenced(pair.second)) {
+        pair.second.last_used = tick;
+      }
+    }
+  }
+
+  const std::string *GetOldestUnreferenced(uint64_t &last_used) const override {
+    const std::string *oldest = nullptr;
+    for (const auto &pair : entries_) {
+      const Entry &entry = pair.second;
+      if (entry.pinned || IsReferenced(entry)) {
+        continue;
+      }
+      if (!oldest || entry.last_used < last_used) {
+        oldest = &pair.first;
+        last_used = entry.last_used;
+      }
+    }
+    return oldest;
+  }
+
+  void Erase(const std::string &key) override {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      return;
+    }
+    --usage_.entry_count;
+    usage_.cpu_bytes -= it->second.cpu_bytes;
+    usage_.gpu_bytes -= it->second.gpu_bytes;
+    entries_.erase(it);
+  }
+
+private:
+  struct Entry {
+    std::shared_ptr<T> element;
+    uint64_t cpu_bytes;
+    uint64_t gpu_bytes;
+    uint64_t last_used;
+    bool pinned;
+  };
+
+  bool IsReferenced(const Entry &entry) const {
+    return entry.element.use_count() > 1 || (in_use_ && in_use_(*entry.element));
+  }
+
+  std::unordered_map<std::string, Entry> entries_;
+  std::function<bool(const T &)> in_use_;
+  uint64_t num_replaced_ = 0;
+};
+}
+}
@@ -9,15 +9,18 @@
 #pragma once
 
 #include "app_framework/common.h"
+#include "app_framework/resource_cache.h"
+#include "app_framework/render/texture_staging.h"
+#include "app_framework/thread_pool.h"
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <unordered_map>
 #include <string>
 
-struct aiNode;
-struct aiScene;
-struct aiTexture;
-
 namespace ml {
 namespace app_framework {
 
@@ -26,18 +29,64 @@ class Mesh;
 class Material;
 class Program;
 class Texture;
+struct LodChain;
 
 struct Model {
   std::shared_ptr<Mesh> mesh;
   std::shared_ptr<Material> material;
+  // Simplified versions of the mesh, null when none were generated
+  std::shared_ptr<const LodChain> lods;
 };
 
 class PBRMaterial;
+struct ImportedImage;
+struct ImportedNode;
+
+// Asset loaded in the background by ResourcePool::LoadAssetAsync
+class AssetLoad final {
+public:
+  enum class State { Importing, Uploading, Ready, Failed };
+
+  AssetLoad(const std::string &path);
+  ~AssetLoad() = default;
+
+  const std::string &GetPath() const {
+    return path_;
+  }
+
+  // Placeholder available right away, the loaded hierarchy is added as its child once ready
+  const std::shared_ptr<Node> &GetNode() const {
+    return node_;
+  }
+
+  State GetState() const {
+    return state_;
+  }
+
+  bool IsDone() const {
+    return state_ == State::Ready || state_ == State::Failed;
+  }
+
+private:
+  friend class ResourcePool;
+
+  std::string path_;
+  std::shared_ptr<Node> node_;
+  std::atomic<State> state_;
+};
+
+struct ResourcePoolUsage {
+  ResourceUsage programs;
+  ResourceUsage textures;
+  ResourceUsage meshes;
+  ResourceUsage materials;
+  ResourceUsage prototypes;
+};
 
 // Load and cache the resource instance
 class ResourcePool final {
 public:
-  ResourcePool() = default;
+  ResourcePool();
   ~ResourcePool() = default;
 
   void InitializePresetResources();
@@ -47,10 +96,23 @@ public:
   template <typename MeshType>
   std::shared_ptr<MeshType> GetMesh() const;
 
-  // Load a model from a 3D file and cache it, the returned material instance will always be a new one
+  // Load a model from a 3D file and cache it, the returned material instance will always be a new one.
+  // The imported file is kept by the asset cache, later launches map it instead of importing again.
+  // glTF files are read directly by GLTFAsset, Assimp handles the other formats.
+  // Each path is imported once, later calls return clones with nodes and material instances of their
+  // own sharing the meshes and textures.
   std::shared_ptr<Node> LoadAsset(const std::string &path);
 
-  // Load a image as Texture and cache it
+  // Same as LoadAsset with the file parsed and its images decoded on worker threads,
+  // the GL resources are created by ProcessUploads. Loads of a path already being
+  // imported wait for that import.
+  std::shared_ptr<AssetLoad> LoadAssetAsync(const std::string &path);
+
+  // Creates the GL resources of the assets imported in the background, on the render
+  // thread. Stops once the budget is spent, after at least one upload.
+  void ProcessUploads(double budget_seconds);
+
+  // Load a image as Texture and cache it, the pixels are uploaded by the texture staging over the next frames
   std::shared_ptr<Texture> LoadTexture(const std::string &path, GLint gl_internal_format = GL_SRGB8_ALPHA8);
 
   // Load a GLSL as Program and cache it
@@ -63,27 +125,100 @@ public:
   template <typename ProgramType>
   std::shared_ptr<ProgramType> LoadShaderFromCode(const char* code, const std::string& identifier = std::string());
 
+  // Bytes the cached resources may hold, 0 for no limit. Resources nothing else
+  // references any more are released least recently used first beyond it.
+  void SetMemoryBudget(uint64_t bytes);
+
+  uint64_t GetMemoryBudget() const {
+    return memory_budget_;
+  }
+
+  // Evict down to the budget, done after each load and worth calling periodically
+  // since resources become unreferenced when nodes are removed
+  void Trim();
+
+  ResourcePoolUsage GetUsage() const;
+
+  // Texture pixels go through it, committed by the application every frame
+  TextureStaging &GetTextureStaging() {
+    return *texture_staging_;
+  }
+
+  // Reorder the triangles and vertices of the imported meshes for the vertex cache, overdraw and vertex
+  // fetch. Set before loading, asset cache files written with the other setting are imported again.
+  void SetMeshOptimization(bool enabled) {
+    mesh_optimization_ = enabled;
+  }
+
+  // Generate simplified levels of detail of the imported meshes by quadric error simplification, drawn
+  // instead of them from far enough away. Set before loading, like the mesh optimization, asset cache files
+  // written with the other setting are imported again.
+  void SetLodGeneration(bool enabled) {
+    lod_generation_ = enabled;
+  }
+
+  // Called with the materials of the imported assets once their permutation is picked, so their pipelines
+  // are created while loading rather than in the first frame they are drawn in. Set by the application to
+  // Renderer::WarmPipelines.
+  void SetPipelineWarmer(const std::function<void(const Material &)> &warmer) {
+    pipeline_warmer_ = warmer;
+  }
+
+  // CPU and GPU bytes of all the caches
+  uint64_t GetTotalBytes() const;
+
+  // GPU bytes the clones of loaded assets shared instead of creating them again, since startup
+  uint64_t GetSharedBytes() const {
+    return shared_bytes_;
+  }
+
 private:
-  template <typename Type, typename ParentType, typename... Args>
-  std::shared_ptr<Type> GetOrCreateElement(std::unordered_map<std::string, std::shared_ptr<ParentType>> &cache,
-                                      const std::string &key, Args &&... args);
-  template <typename Type, typename ParentType, typename... Args>
-  std::shared_ptr<Type> CreateCacheElement(std::unordered_map<std::string, std::shared_ptr<ParentType>> &cache,
-                                           const std::string &key, Args &&... args);
-  template <typename ParentType>
-  std::shared_ptr<ParentType> GetCacheElement(const std::unordered_map<std::string, std::shared_ptr<ParentType>> &cache,
-                                              const std::string &key) const;
-
-  // Load a model from a 3D file and cache it, the returned material instance will always be a new one
-  Model LoadModel(const std::string &path, const aiScene *ai_scene, size_t mesh_index);
-  std::shared_ptr<Node> LoadNodeHierarchy(const std::string &path, const aiScene *ai_scene, const aiNode *ai_node);
-
-  std::shared_ptr<Texture> LoadAssimpEmbeddedTexture(const aiTexture *ai_tex, GLint gl_internal_format);
-
-  std::unordered_map<std::string, std::shared_ptr<Program>> program_cache_;
-  std::unordered_map<std::string, std::shared_ptr<Texture>> texture_cache_;
-  std::unordered_map<std::string, std::shared_ptr<Mesh>> mesh_cache_;
-  std::unordered_map<std::string, std::shared_ptr<PBRMaterial>> static_material_cache_;
+  void EvictResources();
+
+  // Loading is split in the import, without GL calls so it can run on any thread,
+  // and the uploads made one at a time on the render thread
+  struct AssetImport;
+  struct AssetPrototype;
+  std::shared_ptr<AssetImport> ImportAsset(const std::string &path);
+  // True once the node of the asset is created
+  bool UploadNext(AssetImport &import);
+  std::shared_ptr<Texture> CreateTexture(ImportedImage &image, uint64_t &gpu_bytes, uint64_t &ticket);
+  Model CreateModel(const AssetImport &import, size_t mesh_index);
+  // Moves the hierarchy and the models of the completed import into its prototype
+  std::shared_ptr<AssetPrototype> CreatePrototype(AssetImport &import);
+  std::shared_ptr<AssetPrototype> FindPrototype(const std::string &path);
+  std::shared_ptr<Node> ClonePrototype(const AssetPrototype &prototype, const ImportedNode &imported_node);
+  // Completes the async loads of the path, failed without a prototype
+  void FinishLoads(const std::string &path, const std::shared_ptr<AssetPrototype> &prototype);
+
+  // Programs are tracked but pinned, pipelines and material parameter arenas
+  // refer to them by GL name which could be reused once they are deleted
+  ResourceCache<Program> program_cache_;
+  ResourceCache<Texture> texture_cache_;
+  mutable ResourceCache<Mesh> mesh_cache_;
+  ResourceCache<PBRMaterial> static_material_cache_;
+  // Plain data rather than nodes, clones are built from it
+  ResourceCache<AssetPrototype> prototype_cache_;
+
+  // Increases with every access, orders the entries for eviction
+  mutable uint64_t tick_;
+  uint64_t memory_budget_;
+  bool over_budget_;
+  uint64_t shared_bytes_;
+  bool mesh_optimization_;
+  bool lod_generation_;
+  std::function<void(const Material &)> pipeline_warmer_;
+
+  // Before everything holding staged images
+  std::unique_ptr<TextureStaging> texture_staging_;
+  // Imported by the workers, waiting for the render thread
+  std::mutex imported_mutex_;
+  std::vector<std::shared_ptr<AssetImport>> imported_;
+  std::deque<std::shared_ptr<AssetImport>> uploading_;
+  // Async loads by path waiting for their import, render thread only
+  std::unordered_map<std::string, std::vector<std::shared_ptr<AssetLoad>>> pending_loads_;
+  // Last so the workers are joined before anything they touch is destroyed
+  std::unique_ptr<ThreadPool> thread_pool_;
 };
 }
 }
@@ -7,6 +7,7 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #pragma once
+#include <cstring>
 #include <istream>
 #include <fstream>
 #include <algorithm>
@@ -30,7 +31,7 @@ namespace app_framework {
 template <typename MeshType>
 std::shared_ptr<MeshType> ResourcePool::GetMesh() const {
   std::shared_ptr<MeshType> element = std::static_pointer_cast<MeshType>(
-    GetCacheElement<Mesh>(mesh_cache_, std::to_string(MeshType::GetClassRuntimeType()))
+    mesh_cache_.Get(std::to_string(MeshType::GetClassRuntimeType()), ++tick_)
   );
   return element;
 }
@@ -56,37 +57,17 @@ std::shared_ptr<ProgramType> ResourcePool::LoadShaderFromCode(const char* code,
   } else {
     key = identifier;
   }
-  return GetOrCreateElement<ProgramType, Program>(program_cache_, key, code);
-}
-
-template <typename Type, typename ParentType, typename... Args>
-std::shared_ptr<Type> ResourcePool::GetOrCreateElement(std::unordered_map<std::string, std::shared_ptr<ParentType>> &cache,
-                                                       const std::string &key, Args &&... args) {
-  std::shared_ptr<Type> element = std::static_pointer_cast<Type>(GetCacheElement<ParentType>(cache, key));
+  std::shared_ptr<ProgramType> element = std::static_pointer_cast<ProgramType>(program_cache_.Get(key, ++tick_));
   if (element) {
     return element;
   }
 
-  return CreateCacheElement<Type, ParentType, Args &&...>(cache, key, std::forward<Args>(args)...);
-}
-
-template <typename Type, typename ParentType, typename... Args>
-std::shared_ptr<Type> ResourcePool::CreateCacheElement(std::unordered_map<std::string, std::shared_ptr<ParentType>> &cache,
-                                                       const std::string &key, Args &&... args) {
-  std::shared_ptr<Type> element = std::make_shared<Type>(std::forward<Args>(args)...);
-  cache.insert(std::make_pair(key, element));
+  element = std::make_shared<ProgramType>(code);
+  GLint binary_size = 0;
+  glGetProgramiv(element->GetGLProgram(), GL_PROGRAM_BINARY_LENGTH, &binary_size);
+  program_cache_.Insert(key, element, strlen(code), binary_size, ++tick_, true);
   return element;
 }
 
-template <typename ParentType>
-std::shared_ptr<ParentType> ResourcePool::GetCacheElement(const std::unordered_map<std::string, std::shared_ptr<ParentType>> &cache,
-                                                          const std::string &key) const {
-  auto it = cache.find(key);
-  if (it != cache.end()) {
-    return it->second;
-  }
-  return nullptr;
-}
-
 }
 }
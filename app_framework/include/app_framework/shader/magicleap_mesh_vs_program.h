@@ -19,6 +19,12 @@ static const char *kMagicLeapMeshVertexShader = R"GLSL(
     mat4 model;
   } transforms;
 
+  #ifdef STEREO
+  layout(std140) uniform StereoTransforms {
+    mat4 view_proj[2];
+  } stereo_transforms;
+  #endif
+
   layout (location = 0) in vec3 position;
   layout (location = 1) in vec3 normal;
   layout (location = 2) in float confidence;
@@ -31,9 +37,15 @@ static const char *kMagicLeapMeshVertexShader = R"GLSL(
   };
 
   void main() {
-    gl_Position = transforms.view_proj * vec4(position, 1.0);
+    #ifdef STEREO
+    mat4 view_proj = stereo_transforms.view_proj[STEREO_EYE];
+    STEREO_SET_LAYER(STEREO_EYE);
+    #else
+    mat4 view_proj = transforms.view_proj;
+    #endif
+    gl_Position = view_proj * vec4(position, 1.0);
     out_color = mix(vec4(1, 0, 0, 1), vec4(0, 1, 0, 1), confidence);
-    out_normal = transforms.view_proj * vec4(normal, 0.0);
+    out_normal = view_proj * vec4(normal, 0.0);
   }
 )GLSL";
 }
@@ -11,6 +11,11 @@
 namespace ml {
 namespace app_framework {
 
+// Permutations are compiled with HAS_NORMALS, HAS_ALBEDO, HAS_NORMAL_MAP, HAS_METALLIC,
+// HAS_ROUGHNESS, HAS_AMBIENT_OCCLUSION, HAS_EMISSIVE and HAS_TANGENTS defined for the
+// features of the material, see PBRMaterial. Samplers of the missing features are
+// compiled out. HAS_TANGENTS reads the tangent frame from the vertex program instead of
+// rebuilding it from screen space derivatives.
 static const char *kPBRFragmentShader = R"GLSL(
   #version 410 core
   // BRDF functinos refers the same one used in https://github.com/KhronosGroup/glTF-WebGL-PBR/
@@ -28,19 +33,16 @@ static const char *kPBRFragmentShader = R"GLSL(
   layout (location = 0) in vec3 in_world_position;
   layout (location = 1) in vec3 in_normal;
   layout (location = 2) in vec2 in_tex_coords;
+  #ifdef HAS_TANGENTS
+  // Handedness of the bitangent in w
+  layout (location = 3) in vec4 in_tangent;
+  #endif
 
   layout (location = 0) out vec4 out_color;
 
   layout(std140) uniform Material {
     int MetallicChannel;
     int RoughnessChannel;
-    bool HasNormals;
-    bool HasAlbedo;
-    bool HasNormalMap;
-    bool HasMetallic;
-    bool HasRoughness;
-    bool HasAmbientOcclusion;
-    bool HasEmissive;
   } material;
 
   layout(std140) uniform Transforms {
@@ -87,34 +89,42 @@ static const char *kPBRFragmentShader = R"GLSL(
 
   // Convert the tangent space normal to world space
   vec3 GetWorldNormal() {
+  #if !defined(HAS_NORMALS) || (defined(HAS_NORMAL_MAP) && !defined(HAS_TANGENTS))
     vec3 dPx = dFdx(in_world_position);
     vec3 dPy = dFdy(in_world_position);
+  #endif
+  #ifdef HAS_NORMALS
+    vec3 N = normalize(in_normal);
+  #else
     vec3 N = normalize(cross(dPx, dPy));
-    vec2 dUVx = dFdx(in_tex_coords);
-    vec2 dUVy = dFdy(in_tex_coords);
-
-    if (material.HasNormals) {
-      N = normalize(in_normal);
-    }
-
-    if (!material.HasNormalMap) {
-      // Just return surface normal
-      return N;
-    }
+  #endif
 
+  #ifndef HAS_NORMAL_MAP
+    // Just return surface normal
+    return N;
+  #else
     vec3 tangent_normal = texture(Normals, in_tex_coords).xyz * 2.0 - 1.0;
+  #ifdef HAS_TANGENTS
+    vec3 T = normalize(in_tangent.xyz - N * dot(N, in_tangent.xyz));
+    vec3 B = cross(N, T) * in_tangent.w;
+  #else
+    vec2 dUVx = dFdx(in_tex_coords);
+    vec2 dUVy = dFdy(in_tex_coords);
     vec3 T = (dUVy.t * dPx - dUVx.t * dPy) / (dUVx.s * dUVy.t - dUVy.s * dUVx.t);
     T = normalize(T - N * dot(N, T));
     vec3 B = normalize(cross(N, T));
+  #endif
     mat3 TBN = mat3(T, B, N);
     return normalize(TBN * tangent_normal);
+  #endif
   }
 
   void main() {
     float roughness = 0.5f;
     float metallic = 0.0f;
 
-    if (material.HasRoughness) {
+  #ifdef HAS_ROUGHNESS
+    {
       vec4 metallic_sample = texture(Metallic, in_tex_coords);
       if (material.MetallicChannel == 0) {
         metallic = metallic_sample.r;
@@ -126,8 +136,10 @@ static const char *kPBRFragmentShader = R"GLSL(
         metallic = metallic_sample.a;
       }
     }
+  #endif
 
-    if (material.HasMetallic) {
+  #ifdef HAS_METALLIC
+    {
       vec4 roughness_sample = texture(Roughness, in_tex_coords);
       if (material.RoughnessChannel == 0) {
         roughness = roughness_sample.r;
@@ -139,11 +151,12 @@ static const char *kPBRFragmentShader = R"GLSL(
         roughness = roughness_sample.a;
       }
     }
+  #endif
 
     vec4 albedo = vec4(1.0f);
-    if (material.HasAlbedo) {
-      albedo = texture(Albedo, in_tex_coords);
-    }
+  #ifdef HAS_ALBEDO
+    albedo = texture(Albedo, in_tex_coords);
+  #endif
 
     vec3 F0 = mix(Fc, albedo.rgb, metallic);
     vec3 V = normalize(transforms.camera_position - in_world_position);
@@ -177,15 +190,15 @@ static const char *kPBRFragmentShader = R"GLSL(
       color += NdotL * lights.lights_array[i].light_color * lights.lights_array[i].light_strength * attenuation * (diffuse_part + spectacular_part);
     }
 
-    if (material.HasAmbientOcclusion) {
-      float ao = texture(AmbientOcclusion, in_tex_coords).r;
-      color = color * ao;
-    }
+  #ifdef HAS_AMBIENT_OCCLUSION
+    float ao = texture(AmbientOcclusion, in_tex_coords).r;
+    color = color * ao;
+  #endif
 
-    if (material.HasEmissive) {
-      vec3 emissive = texture(Emissive, in_tex_coords).rgb;
-      color += emissive;
-    }
+  #ifdef HAS_EMISSIVE
+    vec3 emissive = texture(Emissive, in_tex_coords).rgb;
+    color += emissive;
+  #endif
 
     color = color / (color + vec3(1.0));
     out_color = vec4(color, 1.0f);
@@ -11,6 +11,7 @@
 namespace ml {
 namespace app_framework {
 
+// HAS_TANGENTS passes the tangent attribute on to the PBR fragment program
 static const char *kPBRVertexShader = R"GLSL(
   #version 410 core
 
@@ -21,9 +22,18 @@ static const char *kPBRVertexShader = R"GLSL(
     vec3 camera_position;
   } transforms;
 
+  #ifdef STEREO
+  layout(std140) uniform StereoTransforms {
+    mat4 view_proj[2];
+  } stereo_transforms;
+  #endif
+
   layout (location = 0) in vec3 position;
   layout (location = 1) in vec3 normal;
   layout (location = 2) in vec2 tex_coords;
+  #ifdef HAS_TANGENTS
+  layout (location = 3) in vec4 tangent;
+  #endif
 
   out gl_PerVertex {
       vec4 gl_Position;
@@ -32,12 +42,25 @@ static const char *kPBRVertexShader = R"GLSL(
   layout (location = 0) out vec3 out_world_position;
   layout (location = 1) out vec3 out_normal;
   layout (location = 2) out vec2 out_tex_coords;
+  #ifdef HAS_TANGENTS
+  layout (location = 3) out vec4 out_tangent;
+  #endif
 
   void main() {
-    gl_Position = transforms.view_proj * transforms.model * vec4(position, 1.0);
+    #ifdef STEREO
+    mat4 view_proj = stereo_transforms.view_proj[STEREO_EYE];
+    STEREO_SET_LAYER(STEREO_EYE);
+    #else
+    mat4 view_proj = transforms.view_proj;
+    #endif
+    gl_Position = view_proj * transforms.model * vec4(position, 1.0);
     out_world_position = (transforms.model * vec4(position, 1.0)).rgb;
     out_normal = normalize(transpose(inverse(mat3(transforms.model))) * normal);
     out_tex_coords = tex_coords;
+    #ifdef HAS_TANGENTS
+    // Tangents follow the surface, transformed by the model matrix like positions
+    out_tangent = vec4(normalize(mat3(transforms.model) * tangent.xyz), tangent.w);
+    #endif
   }
 )GLSL";
 
@@ -19,6 +19,12 @@ static const char *kSimpleTexturedVertexShader = R"GLSL(
     mat4 model;
   } transforms;
 
+  #ifdef STEREO
+  layout(std140) uniform StereoTransforms {
+    mat4 view_proj[2];
+  } stereo_transforms;
+  #endif
+
   layout (location = 0) in vec3 position;
   layout (location = 1) in vec2 tex_coords;
 
@@ -29,7 +35,13 @@ static const char *kSimpleTexturedVertexShader = R"GLSL(
   layout (location = 0) out vec2 out_tex_coords;
 
   void main() {
-    gl_Position = transforms.view_proj * transforms.model * vec4(position, 1.0);
+    #ifdef STEREO
+    mat4 view_proj = stereo_transforms.view_proj[STEREO_EYE];
+    STEREO_SET_LAYER(STEREO_EYE);
+    #else
+    mat4 view_proj = transforms.view_proj;
+    #endif
+    gl_Position = view_proj * transforms.model * vec4(position, 1.0);
     out_tex_coords = tex_coords;
   }
 )GLSL";
@@ -24,11 +24,16 @@ static const char *kSolidColorFragmentShader = R"GLSL(
   layout (location = 0) out vec4 out_color;
 
   void main() {
+    #ifdef INSTANCED
+    // The per instance color is already mixed in by the vertex stage
+    out_color = in_color;
+    #else
     if (material.OverrideVertexColor) {
       out_color = material.Color;
     } else {
       out_color = in_color;
     }
+    #endif
   }
 )GLSL";
 }
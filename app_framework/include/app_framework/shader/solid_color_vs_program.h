@@ -19,9 +19,21 @@ static const char *kSolidColorVertexShader = R"GLSL(
     mat4 model;
   } transforms;
 
+  #ifdef STEREO
+  layout(std140) uniform StereoTransforms {
+    mat4 view_proj[2];
+  } stereo_transforms;
+  #endif
+
   layout (location = 0) in vec3 position;
   layout (location = 1) in vec4 color;
 
+  #ifdef INSTANCED
+  layout (location = 2) in vec4 instance_color;
+  layout (location = 3) in float instance_color_weight;
+  layout (location = 4) in mat4 instance_model;
+  #endif
+
   out gl_PerVertex {
       vec4 gl_Position;
   };
@@ -29,8 +41,19 @@ static const char *kSolidColorVertexShader = R"GLSL(
   layout (location = 0) out vec4 out_color;
 
   void main() {
-    gl_Position = transforms.view_proj * transforms.model * vec4(position, 1.0);
+    #ifdef STEREO
+    mat4 view_proj = stereo_transforms.view_proj[STEREO_EYE];
+    STEREO_SET_LAYER(STEREO_EYE);
+    #else
+    mat4 view_proj = transforms.view_proj;
+    #endif
+    #ifdef INSTANCED
+    gl_Position = view_proj * instance_model * vec4(position, 1.0);
+    out_color = mix(color, instance_color, instance_color_weight);
+    #else
+    gl_Position = view_proj * transforms.model * vec4(position, 1.0);
     out_color = color;
+    #endif
   }
 )GLSL";
 }
@@ -0,0 +1,59 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// Fixed set of worker threads running the submitted tasks in order. Tasks must
+// not make GL calls, there is no context current on the workers.
+class ThreadPool final {
+public:
+  // 0 picks one thread less than the number of cores, at least one
+  explicit ThreadPool(uint32_t thread_count = 0);
+  // Waits for the running tasks, the queued ones are dropped
+  ~ThreadPool();
+
+  template <typename Fn>
+  std::future<typename std::result_of<Fn()>::type> Submit(Fn &&fn) {
+    typedef typename std::result_of<Fn()>::type Result;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+    std::future<Result> result = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push([task]() { (*task)(); });
+    }
+    condition_.notify_one();
+    return result;
+  }
+
+  size_t GetThreadCount() const {
+    return threads_.size();
+  }
+
+private:
+  void Run();
+
+  std::vector<std::thread> threads_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stopping_;
+};
+}
+}
@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include "common.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// Structure of arrays holding the transforms of every node. Slots are kept in
+// parent before child order so that Update can refresh all the stale world
+// matrices in one linear pass. Setters only bump a tick on the modified slot,
+// the descendants are found stale by comparing their ticks with the parent's.
+class TransformStore final {
+public:
+  typedef uint32_t Handle;
+  static const Handle kInvalidHandle = UINT32_MAX;
+
+  TransformStore();
+  ~TransformStore() = default;
+
+  static const std::unique_ptr<TransformStore> &GetInstance();
+
+  Handle Allocate(const glm::vec3 &translation);
+  void Release(Handle handle);
+
+  // kInvalidHandle detaches the slot from its parent
+  void SetParent(Handle handle, Handle parent);
+
+  void SetLocalTranslation(Handle handle, const glm::vec3 &translation);
+  void SetLocalRotation(Handle handle, const glm::quat &rotation);
+  void SetLocalScale(Handle handle, const glm::vec3 &scale);
+  // Force the slot and its descendants to be recomputed
+  void Invalidate(Handle handle);
+
+  const glm::vec3 &GetLocalTranslation(Handle handle) const {
+    return translations_[handle_to_index_[handle]];
+  }
+
+  const glm::quat &GetLocalRotation(Handle handle) const {
+    return rotations_[handle_to_index_[handle]];
+  }
+
+  const glm::vec3 &GetLocalScale(Handle handle) const {
+    return scales_[handle_to_index_[handle]];
+  }
+
+  // Both evaluate the slot on demand when it is read between a setter and the next Update
+  const glm::mat4 &GetLocalTransform(Handle handle) const;
+  const glm::mat4 &GetWorldTransform(Handle handle) const;
+
+  // Derived from the world matrix on first use and cached until the world matrix changes
+  const glm::mat4 &GetInverseWorldTransform(Handle handle) const;
+  const glm::vec3 &GetWorldTranslation(Handle handle) const;
+  const glm::quat &GetWorldRotation(Handle handle) const;
+  const glm::vec3 &GetWorldScale(Handle handle) const;
+
+  bool IsWorldStale(Handle handle) const;
+
+  // Recompute every stale world matrix, once per frame
+  void Update();
+
+  // Number of world matrices recomputed by the last Update
+  size_t GetUpdatedCount() const {
+    return updated_count_;
+  }
+
+  size_t GetSize() const {
+    return index_to_handle_.size() - free_indices_.size();
+  }
+
+private:
+  static const uint32_t kInvalidIndex = UINT32_MAX;
+  static const uint64_t kInvalidTick = UINT64_MAX;
+
+  bool IsStale(uint32_t index) const;
+  void UpdateLocal(uint32_t index) const;
+  void UpdateWorld(uint32_t index) const;
+  uint32_t UpdateDecomposedWorld(Handle handle) const;
+  void Touch(uint32_t index);
+  void SortByDepth();
+
+  // Indexed by slot, kept in parent before child order
+  std::vector<glm::vec3> translations_;
+  std::vector<glm::quat> rotations_;
+  std::vector<glm::vec3> scales_;
+  mutable std::vector<glm::mat4> local_transforms_;
+  mutable std::vector<glm::mat4> world_transforms_;
+  std::vector<uint32_t> parents_;
+  // Tick of the last setter call and of the last world matrix evaluation
+  std::vector<uint64_t> local_ticks_;
+  mutable std::vector<uint64_t> world_ticks_;
+  mutable std::vector<uint8_t> local_dirty_;
+  // World tick the cached inverse and decomposition were computed from
+  mutable std::vector<glm::mat4> inverse_world_transforms_;
+  mutable std::vector<uint64_t> inverse_ticks_;
+  mutable std::vector<glm::vec3> world_translations_;
+  mutable std::vector<glm::quat> world_rotations_;
+  mutable std::vector<glm::vec3> world_scales_;
+  mutable std::vector<uint64_t> decomposed_ticks_;
+  std::vector<Handle> index_to_handle_;
+
+  // Indexed by handle, stable across reordering
+  std::vector<uint32_t> handle_to_index_;
+
+  std::vector<Handle> free_handles_;
+  std::vector<uint32_t> free_indices_;
+
+  uint64_t tick_;
+  uint64_t updated_tick_;
+  bool order_dirty_;
+  size_t updated_count_;
+
+  // Scratch storage for the on demand evaluation
+  mutable std::vector<uint32_t> path_;
+};
+
+}  // namespace app_framework
+}  // namespace ml
@@ -10,10 +10,14 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #include <app_framework/application.h>
+#include <app_framework/asset_cache.h>
 #include <app_framework/cli_args_parser.h>
 #include <app_framework/geometry/quad_mesh.h>
 #include <app_framework/material/textured_material.h>
 #include <app_framework/ml_macros.h>
+#include <app_framework/render/compressed_texture_cache.h>
+#include <app_framework/render/program_cache.h>
+#include <app_framework/transform_store.h>
 
 #if !ML_LUMIN
 #include <GLFW/glfw3.h>
@@ -50,6 +54,36 @@ DEFINE_int32(window_width, 800, "Width of the window on the host machine.");
 
 DEFINE_int32(window_height, 600, "Height of the window on the host machine.");
 
+DEFINE_bool(single_pass_stereo, true,
+            "Render both eyes in a single layered pass when the driver supports it.");
+
+DEFINE_bool(program_cache, true,
+            "Keep the compiled shader programs in the writable directory, later launches load them back.");
+
+DEFINE_int32(resource_budget_mb, 0,
+             "Memory the cached resources may hold in MB, unreferenced ones are released least recently used "
+             "first beyond it. 0 keeps everything.");
+
+DEFINE_double(upload_budget_ms, 2.0,
+              "Time per frame spent creating the GL resources of the assets loaded in the background.");
+
+DEFINE_bool(asset_cache, true,
+            "Keep imported assets in the writable directory, later launches map them instead of importing again.");
+
+DEFINE_bool(texture_compression, true,
+            "Compress the loaded textures with their mips, kept in the writable directory for later launches.");
+
+DEFINE_bool(mesh_optimization, true,
+            "Reorder the triangles and vertices of the loaded meshes for the vertex cache, overdraw and fetch.");
+
+DEFINE_bool(mesh_lods, true,
+            "Generate simplified levels of detail of the loaded meshes, drawn instead of them from far away.");
+
+DEFINE_double(lod_pixel_error, 1.0,
+              "Largest error on screen in pixels a level of detail may show before a finer one is drawn.");
+
+DEFINE_int32(texture_upload_budget_kb, 2048, "Texture data copied to the GPU per frame in KB.");
+
 // the type must be lock-free
 std::atomic<bool> Application::exit_signal_;
 
@@ -231,6 +265,32 @@ void Application::InitializeGraphics() {
   MLGraphicsGetRenderTargets(graphics_client_, &targets);
   frame_params_.near_clip = targets.min_clip;
 
+  if (FLAGS_program_cache && lifecycle_info_ && lifecycle_info_->writable_dir_path) {
+    ProgramCache::GetInstance()->SetDirectory(lifecycle_info_->writable_dir_path);
+  }
+  if (FLAGS_asset_cache && lifecycle_info_ && lifecycle_info_->writable_dir_path) {
+    AssetCache::GetInstance()->SetDirectory(lifecycle_info_->writable_dir_path);
+  }
+  if (FLAGS_texture_compression && lifecycle_info_ && lifecycle_info_->writable_dir_path) {
+    CompressedTextureCache::GetInstance()->SetDirectory(lifecycle_info_->writable_dir_path);
+  }
+
+  // The renderer warms the pipelines of the framework materials, the resource pool has to be ready
+  Registry::GetInstance()->Initialize();
+  Registry::GetInstance()->GetResourcePool()->SetMemoryBudget(
+      static_cast<uint64_t>(std::max(FLAGS_resource_budget_mb, 0)) * 1024 * 1024);
+  Registry::GetInstance()->GetResourcePool()->SetMeshOptimization(FLAGS_mesh_optimization);
+  Registry::GetInstance()->GetResourcePool()->SetLodGeneration(FLAGS_mesh_lods);
+
+  // Initialize the new renderer and setting the post render camera callback
+  renderer_.SetSinglePassStereo(FLAGS_single_pass_stereo);
+  renderer_.SetLodPixelError(static_cast<float>(FLAGS_lod_pixel_error));
+  renderer_.Initialize();
+  Registry::GetInstance()->GetResourcePool()->SetPipelineWarmer(
+      [this](const Material &material) { renderer_.WarmPipelines(material); });
+  auto cb = [this](std::shared_ptr<CameraComponent> camera) { Application::InternalRenderCamCallback(camera); };
+  renderer_.SetPostRenderCameraCallback(cb);
+
   for (int32_t i = 0; i < MLGraphics_BufferCount; ++i) {
     auto &buffer = targets.buffers[i];
     if (buffer.color.id == 0) {
@@ -243,20 +303,21 @@ void Application::InitializeGraphics() {
     // Implicit assumption, left eye is always index 0
     auto left_render_target = std::make_shared<RenderTarget>(color_tex, depth_tex, 0, 0);
     auto right_render_target = std::make_shared<RenderTarget>(color_tex, depth_tex, 1, 1);
+    if (renderer_.GetStereoMode() != StereoMode::None) {
+      auto stereo_render_target = std::make_shared<RenderTarget>(color_tex, depth_tex, renderer_.GetStereoMode());
+      left_render_target->SetStereoRenderTarget(stereo_render_target);
+      right_render_target->SetStereoRenderTarget(stereo_render_target);
+    }
 
     // Only use color buffer as the key
     ml_render_target_cache_.insert(std::make_pair(std::make_pair(buffer.color.id, 0), left_render_target));
     ml_render_target_cache_.insert(std::make_pair(std::make_pair(buffer.color.id, 1), right_render_target));
   }
 
-  // Initialize the new renderer and setting the post render camera callback
-  renderer_.Initialize();
-  auto cb = [this](std::shared_ptr<CameraComponent> camera) { Application::InternalRenderCamCallback(camera); };
-  renderer_.SetPostRenderCameraCallback(cb);
-  Registry::GetInstance()->Initialize();
-
   // Init nodes
+  render_list_ = std::make_shared<RenderList>();
   root_ = std::make_shared<Node>();
+  root_->SetRenderList(render_list_);
   for (int i = 0; i < camera_nodes_.size(); ++i) {
     camera_nodes_[i] = std::make_shared<Node>();
     auto camera = std::make_shared<CameraComponent>();
@@ -311,6 +372,9 @@ void Application::TerminatePerception() {
 }
 
 void Application::TerminateGraphics() {
+  if (Registry::GetInstance()->GetResourcePool()) {
+    Registry::GetInstance()->GetResourcePool()->SetPipelineWarmer(nullptr);
+  }
   graphics_context_->UnMakeCurrent();
   MLResult ml_result = MLGraphicsDestroyClient(&graphics_client_);
   if (ml_result != MLResult_Ok) {
@@ -330,28 +394,59 @@ void Application::Update() {
   num_frames_++;
   auto d = std::chrono::duration_cast<std::chrono::seconds>(update_time - fps_delta_time_);
   if (d.count() >= 1.0) {
-    ML_LOG(Verbose, "%f ms/frame (fps: %u)", 1000.0/double(num_frames_), num_frames_);
+    const uint64_t buffer_reallocations = Buffer::GetTotalReallocationCount();
+    const uint64_t buffer_uploaded_bytes = Buffer::GetTotalUploadedBytes();
+    const uint64_t pipeline_misses = renderer_.GetPipelineCache().GetMissCount();
+    const auto &resource_pool = Registry::GetInstance()->GetResourcePool();
+    const TextureStaging &texture_staging = resource_pool->GetTextureStaging();
+    const uint64_t texture_committed_bytes = texture_staging.GetCommittedBytes();
+    ML_LOG(Verbose, "%f ms/frame (fps: %u), render list nodes re-indexed: %zu, transforms updated: %zu",
+           1000.0/double(num_frames_), num_frames_, num_reindexed_nodes_, num_updated_transforms_);
+    ML_LOG(Verbose,
+           "Renderer: instanced batches: %zu (%zu draws), triangles: %" PRIu64 " per frame (%" PRIu64
+           " at full detail), gl state calls issued: %" PRIu64 " (%" PRIu64 " elided), "
+           "pipelines created while drawing: %" PRIu64,
+           num_instanced_batches_, num_instanced_draws_, num_triangles_ / std::max<uint64_t>(num_frames_, 1),
+           num_full_detail_triangles_ / std::max<uint64_t>(num_frames_, 1), num_gl_calls_issued_,
+           num_gl_calls_elided_, pipeline_misses - last_pipeline_misses_);
+    ML_LOG(Verbose, "Buffers: reallocations: %" PRIu64 ", uploads: %" PRIu64 " bytes",
+           buffer_reallocations - last_buffer_reallocations_, buffer_uploaded_bytes - last_buffer_uploaded_bytes_);
+    ML_LOG(Verbose, "Resources: %" PRIu64 " KB (%" PRIu64 " KB shared by asset clones)",
+           resource_pool->GetTotalBytes() / 1024, resource_pool->GetSharedBytes() / 1024);
+    ML_LOG(Verbose, "Texture uploads: %" PRIu64 " KB (%zu queued, %" PRIu64 " KB)",
+           (texture_committed_bytes - last_texture_committed_bytes_) / 1024, texture_staging.GetQueueDepth(),
+           texture_staging.GetQueuedBytes() / 1024);
+    last_buffer_reallocations_ = buffer_reallocations;
+    last_buffer_uploaded_bytes_ = buffer_uploaded_bytes;
+    last_pipeline_misses_ = pipeline_misses;
+    last_texture_committed_bytes_ = texture_committed_bytes;
     num_frames_ = 0;
+    num_reindexed_nodes_ = 0;
+    num_updated_transforms_ = 0;
+    num_instanced_batches_ = 0;
+    num_instanced_draws_ = 0;
+    num_triangles_ = 0;
+    num_full_detail_triangles_ = 0;
+    num_gl_calls_issued_ = 0;
+    num_gl_calls_elided_ = 0;
     fps_delta_time_ += d;
   }
 
+  // Assets finished by the loader threads get their GL resources before the app sees them
+  const auto &pool = Registry::GetInstance()->GetResourcePool();
+  pool->GetTextureStaging().Commit(static_cast<uint64_t>(std::max(FLAGS_texture_upload_budget_kb, 1)) * 1024);
+  pool->ProcessUploads(FLAGS_upload_budget_ms / 1000.0);
+  // Nodes removed last frame can leave resources unreferenced, no-op while under the memory budget
+  pool->Trim();
   OnUpdate(delta_time.count());
   prev_update_time_ = update_time;
 }
 
 void Application::Render() {
-  // Trivial BFS traversal, no partition
-  VisitNode(root_);
-  queue_.push(root_);
-  while (!queue_.empty()) {
-    auto current_node = queue_.front();
-    auto children = current_node->GetChildren();
-    for (auto child : children) {
-      VisitNode(child);
-      queue_.push(child);
-    }
-    queue_.pop();
-  }
+  // Only the nodes that changed since the last frame are re-indexed
+  render_list_->Update();
+  num_reindexed_nodes_ += render_list_->GetReindexedNodeCount();
+  renderer_.Visit(*render_list_);
 
   MLGraphicsFrameInfo frame_info = {};
   MLGraphicsFrameInfoInit(&frame_info);
@@ -361,7 +456,16 @@ void Application::Render() {
   } else if (MLResult_Ok == out_result) {
     frame_handle_ = frame_info.handle;
     UpdateMLCamera(frame_info.virtual_camera_info_array);
+    // Refresh the stale world matrices in one pass before the renderer reads them
+    TransformStore::GetInstance()->Update();
+    num_updated_transforms_ += TransformStore::GetInstance()->GetUpdatedCount();
     renderer_.Render();
+    num_instanced_batches_ += renderer_.GetInstancedBatchCount();
+    num_instanced_draws_ += renderer_.GetInstancedDrawCount();
+    num_triangles_ += renderer_.GetTriangleCount();
+    num_full_detail_triangles_ += renderer_.GetFullDetailTriangleCount();
+    num_gl_calls_issued_ += renderer_.GetGLStateCache().GetIssuedCount();
+    num_gl_calls_elided_ += renderer_.GetGLStateCache().GetElidedCount();
 
     for (int i = 0; i < camera_nodes_.size(); ++i) {
       MLGraphicsSignalSyncObjectGL(graphics_client_, ml_sync_objs_[i]);
@@ -440,10 +544,6 @@ void Application::ParseArgs(int argc, char **argv) {
 #endif  // #ifdef ML_LUMIN
 }
 
-void Application::VisitNode(std::shared_ptr<Node> node) {
-  renderer_.Visit(node);
-}
-
 int Application::RunApp() {
   using namespace ml::app_framework;
   // Set the app status to running.
@@ -454,6 +554,21 @@ int Application::RunApp() {
 
   Initialize();
   OnStart();
+  const auto &program_cache = ProgramCache::GetInstance();
+  ML_LOG(Info, "Shader programs at startup: %u compiled, %u loaded from the cache, %.1f ms",
+         program_cache->GetCompiledCount(), program_cache->GetLoadedCount(), program_cache->GetBuildTime() * 1000.0);
+  const auto &pipeline_cache = renderer_.GetPipelineCache();
+  ML_LOG(Info, "Pipelines at startup: %" PRIu64 " warmed, %zu in total, %.1f ms", pipeline_cache.GetWarmedCount(),
+         pipeline_cache.GetPipelineCount(), pipeline_cache.GetCreationTime() * 1000.0);
+  // Assets loaded in the background are counted as they complete
+  const auto &asset_cache = AssetCache::GetInstance();
+  ML_LOG(Info, "Assets at startup: %u imported in %.2f ms, %u loaded from the cache in %.2f ms",
+         asset_cache->GetImportedCount(), asset_cache->GetImportTime() * 1000.0, asset_cache->GetLoadedCount(),
+         asset_cache->GetLoadTime() * 1000.0);
+  const auto &compressed_texture_cache = CompressedTextureCache::GetInstance();
+  ML_LOG(Info, "Compressed textures at startup: %u baked, %u loaded from the cache, %" PRIu64 " KB saved",
+         compressed_texture_cache->GetBakedCount(), compressed_texture_cache->GetLoadedCount(),
+         compressed_texture_cache->GetSavedBytes() / 1024);
   ML_LOG(Verbose, "Start loop.");
   prev_update_time_ = ApplicationClock::now();
   while (true) {
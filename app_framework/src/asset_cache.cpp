@@ -0,0 +1,195 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include <app_framework/asset_cache.h>
+
+#include <sys/stat.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+namespace ml {
+namespace app_framework {
+
+// Bumped whenever the layout of the file or the import of the assets changes
+static const uint32_t kFileMagic = 0x43414c4d;  // "MLAC"
+static const uint32_t kFileVersion = 4;
+
+struct FileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t source_size;
+  int64_t source_mtime;
+  double import_seconds;
+  uint64_t payload_size;
+  // Import options the payload was produced with
+  uint32_t options;
+  // Keeps the payload 16 byte aligned
+  uint32_t reserved;
+};
+static_assert(sizeof(FileHeader) % 16 == 0, "The payload must stay aligned");
+
+static bool GetSourceStamp(const std::string &path, uint64_t &size, int64_t &mtime) {
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0) {
+    return false;
+  }
+  size = info.st_size;
+  mtime = info.st_mtime;
+  return true;
+}
+
+MappedFile::MappedFile() : data_(nullptr), size_(0) {}
+
+MappedFile::~MappedFile() {
+#if !defined(_WIN32)
+  if (data_ && buffer_.empty()) {
+    munmap(const_cast<unsigned char *>(data_), size_);
+  }
+#endif
+}
+
+std::shared_ptr<MappedFile> MappedFile::Open(const std::string &path) {
+  std::shared_ptr<MappedFile> file(new MappedFile());
+#if !defined(_WIN32)
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      file->data_ = static_cast<const unsigned char *>(data);
+      file->size_ = info.st_size;
+    }
+  }
+  close(fd);
+  if (file->data_) {
+    return file;
+  }
+#endif
+  FILE *stream = fopen(path.c_str(), "rb");
+  if (!stream) {
+    return nullptr;
+  }
+  unsigned char chunk[4096];
+  size_t read = 0;
+  while ((read = fread(chunk, 1, sizeof(chunk), stream)) > 0) {
+    file->buffer_.insert(file->buffer_.end(), chunk, chunk + read);
+  }
+  fclose(stream);
+  file->data_ = file->buffer_.data();
+  file->size_ = file->buffer_.size();
+  return file;
+}
+
+AssetCache::AssetCache() : num_loaded_(0), num_imported_(0), load_microseconds_(0), import_microseconds_(0) {}
+
+const std::unique_ptr<AssetCache> &AssetCache::GetInstance() {
+  static std::unique_ptr<AssetCache> instance(new AssetCache());
+  return instance;
+}
+
+void AssetCache::SetDirectory(const std::string &directory) {
+  directory_ = directory;
+  if (directory_.empty()) {
+    return;
+  }
+  if (directory_.back() != '/') {
+    directory_ += '/';
+  }
+  ML_LOG(Debug, "Caching imported assets in %s", directory_.c_str());
+}
+
+std::string AssetCache::GetPath(const std::string &asset_path) const {
+  // FNV-1a of the path, the file records which version of the asset it holds
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : asset_path) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "asset_%016" PRIx64 ".bin", hash);
+  return directory_ + name;
+}
+
+bool AssetCache::Load(const std::string &asset_path, uint32_t options, Entry &entry) const {
+  uint64_t source_size = 0;
+  int64_t source_mtime = 0;
+  if (!IsEnabled() || !GetSourceStamp(asset_path, source_size, source_mtime)) {
+    return false;
+  }
+  std::shared_ptr<MappedFile> file = MappedFile::Open(GetPath(asset_path));
+  if (!file || file->GetSize() < sizeof(FileHeader)) {
+    return false;
+  }
+  FileHeader header;
+  memcpy(&header, file->GetData(), sizeof(header));
+  if (header.magic != kFileMagic || header.version != kFileVersion || header.source_size != source_size ||
+      header.source_mtime != source_mtime || header.payload_size != file->GetSize() - sizeof(header) ||
+      header.options != options) {
+    ML_LOG(Debug, "The asset cache file of %s is out of date", asset_path.c_str());
+    return false;
+  }
+  entry.file = file;
+  entry.payload = file->GetData() + sizeof(header);
+  entry.payload_size = header.payload_size;
+  entry.import_seconds = header.import_seconds;
+  return true;
+}
+
+void AssetCache::Store(const std::string &asset_path, uint32_t options, double import_seconds,
+                       const std::vector<unsigned char> &payload) const {
+  FileHeader header{};
+  if (!IsEnabled() || !GetSourceStamp(asset_path, header.source_size, header.source_mtime)) {
+    return;
+  }
+  header.magic = kFileMagic;
+  header.version = kFileVersion;
+  header.import_seconds = import_seconds;
+  header.payload_size = payload.size();
+  header.options = options;
+
+  // Written next to the final file and renamed, a partial file is never read back. Named
+  // after the thread, the same asset can be imported by two loads at once.
+  const std::string path = GetPath(asset_path);
+  const std::string temp_path =
+      path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+  FILE *file = fopen(temp_path.c_str(), "wb");
+  if (!file) {
+    ML_LOG(Warning, "Failed to create the asset cache file %s", temp_path.c_str());
+    return;
+  }
+  const bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                       fwrite(payload.data(), 1, payload.size(), file) == payload.size();
+  if (fclose(file) != 0 || !written || rename(temp_path.c_str(), path.c_str()) != 0) {
+    ML_LOG(Warning, "Failed to write the asset cache file %s", path.c_str());
+    remove(temp_path.c_str());
+  }
+}
+
+void AssetCache::AddAsset(bool loaded, double seconds) {
+  if (loaded) {
+    ++num_loaded_;
+    load_microseconds_ += static_cast<uint64_t>(seconds * 1e6);
+  } else {
+    ++num_imported_;
+    import_microseconds_ += static_cast<uint64_t>(seconds * 1e6);
+  }
+}
+}
+}
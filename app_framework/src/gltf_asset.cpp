@@ -0,0 +1,652 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include <app_framework/gltf_asset.h>
+
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace ml {
+namespace app_framework {
+
+static const uint32_t kGLBMagic = 0x46546c67;  // "glTF"
+static const uint32_t kGLBChunkJSON = 0x4e4f534a;
+static const uint32_t kGLBChunkBIN = 0x004e4942;
+static const GLenum kModeTriangles = 4;
+
+// Just enough JSON for the glTF document, missing members read as null
+class JsonValue {
+public:
+  enum class Type { Null, Bool, Number, String, Array, Object };
+
+  JsonValue() : type_(Type::Null), number_(0.0) {}
+
+  bool IsNull() const {
+    return type_ == Type::Null;
+  }
+
+  const JsonValue &Get(const char *key) const {
+    for (const auto &member : members_) {
+      if (member.first == key) {
+        return member.second;
+      }
+    }
+    return GetNull();
+  }
+
+  const JsonValue &Get(size_t index) const {
+    return index < array_.size() ? array_[index] : GetNull();
+  }
+
+  // 0 for anything but an array
+  size_t GetSize() const {
+    return array_.size();
+  }
+
+  double GetNumber(double fallback) const {
+    return type_ == Type::Number ? number_ : fallback;
+  }
+
+  int32_t GetInt(int32_t fallback) const {
+    return type_ == Type::Number ? static_cast<int32_t>(number_) : fallback;
+  }
+
+  bool GetBool(bool fallback) const {
+    return type_ == Type::Bool ? number_ != 0.0 : fallback;
+  }
+
+  const std::string &GetString() const {
+    return string_;
+  }
+
+private:
+  friend class JsonParser;
+
+  static const JsonValue &GetNull() {
+    static const JsonValue null_value;
+    return null_value;
+  }
+
+  Type type_;
+  double number_;
+  std::string string_;
+  std::vector<JsonValue> array_;
+  std::vector<std::pair<std::string, JsonValue>> members_;
+};
+
+class JsonParser {
+public:
+  JsonParser(const char *begin, const char *end) : position_(begin), end_(end) {}
+
+  bool Parse(JsonValue &value) {
+    // Byte order mark
+    if (end_ - position_ >= 3 && memcmp(position_, "\xEF\xBB\xBF", 3) == 0) {
+      position_ += 3;
+    }
+    if (!ParseValue(value, 0)) {
+      return false;
+    }
+    SkipWhitespace();
+    // The JSON chunk of a binary file is padded with spaces or zeros
+    while (position_ != end_ && *position_ == '\0') {
+      ++position_;
+    }
+    return position_ == end_;
+  }
+
+private:
+  // Deeper documents are rejected rather than recursed into
+  static const int kMaxDepth = 64;
+
+  void SkipWhitespace() {
+    while (position_ != end_ && (*position_ == ' ' || *position_ == '\t' || *position_ == '\n' || *position_ == '\r')) {
+      ++position_;
+    }
+  }
+
+  bool Consume(char c) {
+    SkipWhitespace();
+    if (position_ == end_ || *position_ != c) {
+      return false;
+    }
+    ++position_;
+    return true;
+  }
+
+  bool ConsumeWord(const char *word) {
+    const size_t length = strlen(word);
+    if (static_cast<size_t>(end_ - position_) < length || memcmp(position_, word, length) != 0) {
+      return false;
+    }
+    position_ += length;
+    return true;
+  }
+
+  bool ParseValue(JsonValue &value, int depth) {
+    SkipWhitespace();
+    if (position_ == end_ || depth > kMaxDepth) {
+      return false;
+    }
+    switch (*position_) {
+      case '{': {
+        ++position_;
+        value.type_ = JsonValue::Type::Object;
+        if (Consume('}')) {
+          return true;
+        }
+        do {
+          std::string key;
+          if (!Consume('"') || !ParseString(key) || !Consume(':')) {
+            return false;
+          }
+          value.members_.emplace_back(key, JsonValue());
+          if (!ParseValue(value.members_.back().second, depth + 1)) {
+            return false;
+          }
+        } while (Consume(','));
+        return Consume('}');
+      }
+      case '[': {
+        ++position_;
+        value.type_ = JsonValue::Type::Array;
+        if (Consume(']')) {
+          return true;
+        }
+        do {
+          value.array_.emplace_back();
+          if (!ParseValue(value.array_.back(), depth + 1)) {
+            return false;
+          }
+        } while (Consume(','));
+        return Consume(']');
+      }
+      case '"':
+        ++position_;
+        value.type_ = JsonValue::Type::String;
+        return ParseString(value.string_);
+      case 't':
+        value.type_ = JsonValue::Type::Bool;
+        value.number_ = 1.0;
+        return ConsumeWord("true");
+      case 'f':
+        value.type_ = JsonValue::Type::Bool;
+        return ConsumeWord("false");
+      case 'n': return ConsumeWord("null");
+      default: value.type_ = JsonValue::Type::Number; return ParseNumber(value.number_);
+    }
+  }
+
+  // After the opening quote
+  bool ParseString(std::string &out) {
+    while (position_ != end_ && *position_ != '"') {
+      char c = *position_++;
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (position_ == end_) {
+        return false;
+      }
+      c = *position_++;
+      switch (c) {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+          uint32_t code_point = 0;
+          if (!ParseHex(code_point)) {
+            return false;
+          }
+          // Surrogate pair
+          uint32_t low = 0;
+          if (code_point >= 0xD800 && code_point < 0xDC00 && ConsumeWord("\\u") && ParseHex(low)) {
+            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+          }
+          AppendUTF8(code_point, out);
+          break;
+        }
+        default: out += c; break;
+      }
+    }
+    if (position_ == end_) {
+      return false;
+    }
+    ++position_;
+    return true;
+  }
+
+  bool ParseHex(uint32_t &value) {
+    if (end_ - position_ < 4) {
+      return false;
+    }
+    const std::string digits(position_, 4);
+    char *digits_end = nullptr;
+    value = strtoul(digits.c_str(), &digits_end, 16);
+    position_ += 4;
+    return digits_end == digits.c_str() + 4;
+  }
+
+  static void AppendUTF8(uint32_t code_point, std::string &out) {
+    if (code_point < 0x80) {
+      out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+      out += static_cast<char>(0xC0 | (code_point >> 6));
+      out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+      out += static_cast<char>(0xE0 | (code_point >> 12));
+      out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+      out += static_cast<char>(0xF0 | (code_point >> 18));
+      out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+  }
+
+  bool ParseNumber(double &value) {
+    const char *begin = position_;
+    while (position_ != end_ && (isdigit(*position_) || strchr("+-.eE", *position_))) {
+      ++position_;
+    }
+    const std::string digits(begin, position_);
+    char *digits_end = nullptr;
+    value = strtod(digits.c_str(), &digits_end);
+    return !digits.empty() && digits_end == digits.c_str() + digits.size();
+  }
+
+  const char *position_;
+  const char *end_;
+};
+
+static uint32_t GetComponentSize(GLenum component_type) {
+  switch (component_type) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE: return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT: return 2;
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT: return 4;
+    default: return 0;
+  }
+}
+
+// 0 for the matrix types, no attribute the framework reads has them
+static uint32_t GetComponentCount(const std::string &type) {
+  if (type == "SCALAR") {
+    return 1;
+  } else if (type == "VEC2") {
+    return 2;
+  } else if (type == "VEC3") {
+    return 3;
+  } else if (type == "VEC4") {
+    return 4;
+  }
+  return 0;
+}
+
+static bool DecodeBase64(const char *data, size_t size, std::vector<unsigned char> &out) {
+  auto decode_char = [](char c) -> int32_t {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+  };
+  out.clear();
+  out.reserve(size / 4 * 3);
+  uint32_t bits = 0;
+  int32_t bit_count = 0;
+  for (size_t i = 0; i < size && data[i] != '='; ++i) {
+    const int32_t value = decode_char(data[i]);
+    if (value < 0) {
+      return false;
+    }
+    bits = (bits << 6) | value;
+    bit_count += 6;
+    if (bit_count >= 8) {
+      bit_count -= 8;
+      out.push_back(static_cast<unsigned char>(bits >> bit_count));
+    }
+  }
+  return true;
+}
+
+// False when the URI is not a base64 data URI
+static bool DecodeDataURI(const std::string &uri, std::vector<unsigned char> &out) {
+  const size_t data_start = uri.find(";base64,");
+  if (uri.compare(0, 5, "data:") != 0 || data_start == std::string::npos) {
+    return false;
+  }
+  const size_t begin = data_start + strlen(";base64,");
+  return DecodeBase64(uri.data() + begin, uri.size() - begin, out);
+}
+
+// Relative references are percent encoded
+static std::string DecodeURI(const std::string &uri) {
+  std::string path;
+  for (size_t i = 0; i < uri.size(); ++i) {
+    if (uri[i] == '%' && i + 2 < uri.size() && isxdigit(uri[i + 1]) && isxdigit(uri[i + 2])) {
+      path += static_cast<char>(strtoul(uri.substr(i + 1, 2).c_str(), nullptr, 16));
+      i += 2;
+    } else {
+      path += uri[i];
+    }
+  }
+  return path;
+}
+
+bool GLTFAsset::IsGLTF(const std::string &path) {
+  const size_t dot = path.find_last_of('.');
+  if (dot == std::string::npos) {
+    return false;
+  }
+  std::string extension = path.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+  return extension == "gltf" || extension == "glb";
+}
+
+bool GLTFAsset::LoadBuffer(const std::string &uri, const std::string &directory, BufferData &buffer) {
+  if (uri.compare(0, 5, "data:") == 0) {
+    decoded_.emplace_back();
+    if (!DecodeDataURI(uri, decoded_.back())) {
+      return false;
+    }
+    buffer.data = decoded_.back().data();
+    buffer.size = decoded_.back().size();
+    return true;
+  }
+  std::shared_ptr<MappedFile> file = MappedFile::Open(directory + DecodeURI(uri));
+  if (!file) {
+    ML_LOG(Error, "Unable to open the glTF buffer %s", (directory + uri).c_str());
+    return false;
+  }
+  files_.push_back(file);
+  buffer.data = file->GetData();
+  buffer.size = file->GetSize();
+  return true;
+}
+
+bool GLTFAsset::Load(const std::string &path) {
+  std::shared_ptr<MappedFile> file = MappedFile::Open(path);
+  if (!file) {
+    ML_LOG(Error, "Unable to open %s", path.c_str());
+    return false;
+  }
+  files_.push_back(file);
+  const std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+
+  // Binary files hold the document and the first buffer in chunks
+  const unsigned char *json = file->GetData();
+  uint64_t json_size = file->GetSize();
+  BufferData glb_buffer{nullptr, 0};
+  uint32_t header[5] = {};
+  if (file->GetSize() >= sizeof(header)) {
+    memcpy(header, file->GetData(), sizeof(header));
+  }
+  if (header[0] == kGLBMagic) {
+    const uint64_t file_size = std::min<uint64_t>(header[2], file->GetSize());
+    if (header[1] != 2 || header[4] != kGLBChunkJSON || header[3] > file_size - sizeof(header)) {
+      ML_LOG(Error, "Malformed binary glTF file %s", path.c_str());
+      return false;
+    }
+    json = file->GetData() + sizeof(header);
+    json_size = header[3];
+    // Chunks are 4 byte aligned
+    const uint64_t bin_offset = sizeof(header) + (json_size + 3) / 4 * 4;
+    uint32_t bin_header[2] = {};
+    if (bin_offset + sizeof(bin_header) <= file_size) {
+      memcpy(bin_header, file->GetData() + bin_offset, sizeof(bin_header));
+      if (bin_header[1] == kGLBChunkBIN && bin_header[0] <= file_size - bin_offset - sizeof(bin_header)) {
+        glb_buffer.data = file->GetData() + bin_offset + sizeof(bin_header);
+        glb_buffer.size = bin_header[0];
+      }
+    }
+  }
+
+  JsonValue document;
+  const char *json_begin = reinterpret_cast<const char *>(json);
+  if (!JsonParser(json_begin, json_begin + json_size).Parse(document)) {
+    ML_LOG(Error, "Malformed glTF document %s", path.c_str());
+    return false;
+  }
+  if (document.Get("asset").Get("version").GetString().compare(0, 2, "2.") != 0) {
+    ML_LOG(Error, "%s is not a glTF 2.0 asset", path.c_str());
+    return false;
+  }
+  const JsonValue &required_extensions = document.Get("extensionsRequired");
+  if (required_extensions.GetSize() > 0) {
+    ML_LOG(Warning, "%s requires the unsupported extension %s", path.c_str(),
+           required_extensions.Get(size_t(0)).GetString().c_str());
+    return false;
+  }
+
+  const JsonValue &buffers = document.Get("buffers");
+  for (size_t i = 0; i < buffers.GetSize(); ++i) {
+    const JsonValue &uri = buffers.Get(i).Get("uri");
+    BufferData buffer{nullptr, 0};
+    if (uri.IsNull() && i == 0 && glb_buffer.data) {
+      buffer = glb_buffer;
+    } else if (uri.IsNull() || !LoadBuffer(uri.GetString(), directory, buffer)) {
+      ML_LOG(Error, "Unable to load buffer %zu of %s", i, path.c_str());
+      return false;
+    }
+    if (buffer.size < buffers.Get(i).Get("byteLength").GetNumber(0.0)) {
+      ML_LOG(Error, "Buffer %zu of %s is truncated", i, path.c_str());
+      return false;
+    }
+    buffers_.push_back(buffer);
+  }
+
+  const JsonValue &buffer_views = document.Get("bufferViews");
+  for (size_t i = 0; i < buffer_views.GetSize(); ++i) {
+    const JsonValue &value = buffer_views.Get(i);
+    BufferView view;
+    view.buffer = value.Get("buffer").GetInt(-1);
+    view.offset = value.Get("byteOffset").GetNumber(0.0);
+    view.length = value.Get("byteLength").GetNumber(0.0);
+    view.stride = value.Get("byteStride").GetInt(0);
+    if (view.buffer < 0 || view.buffer >= static_cast<int32_t>(buffers_.size()) ||
+        view.offset > buffers_[view.buffer].size || view.length > buffers_[view.buffer].size - view.offset) {
+      ML_LOG(Error, "Buffer view %zu of %s is out of its buffer", i, path.c_str());
+      return false;
+    }
+    buffer_views_.push_back(view);
+  }
+
+  const JsonValue &accessors = document.Get("accessors");
+  for (size_t i = 0; i < accessors.GetSize(); ++i) {
+    const JsonValue &value = accessors.Get(i);
+    AccessorView accessor;
+    accessor.buffer_view = value.Get("bufferView").GetInt(-1);
+    accessor.offset = value.Get("byteOffset").GetNumber(0.0);
+    accessor.count = value.Get("count").GetNumber(0.0);
+    accessor.component_type = value.Get("componentType").GetInt(0);
+    accessor.component_count = GetComponentCount(value.Get("type").GetString());
+    accessor.normalized = value.Get("normalized").GetBool(false);
+    accessor.sparse = !value.Get("sparse").IsNull();
+    accessors_.push_back(accessor);
+  }
+
+  // Textures only matter for the image they sample
+  std::vector<int32_t> texture_images;
+  const JsonValue &images = document.Get("images");
+  const JsonValue &textures = document.Get("textures");
+  for (size_t i = 0; i < textures.GetSize(); ++i) {
+    const int32_t image = textures.Get(i).Get("source").GetInt(-1);
+    texture_images.push_back(image < static_cast<int32_t>(images.GetSize()) ? image : -1);
+  }
+
+  for (size_t i = 0; i < images.GetSize(); ++i) {
+    const JsonValue &value = images.Get(i);
+    Image image{std::string(), nullptr, 0};
+    const JsonValue &uri = value.Get("uri");
+    const int32_t view_index = value.Get("bufferView").GetInt(-1);
+    if (!uri.IsNull() && uri.GetString().compare(0, 5, "data:") == 0) {
+      decoded_.emplace_back();
+      if (DecodeDataURI(uri.GetString(), decoded_.back())) {
+        image.data = decoded_.back().data();
+        image.size = decoded_.back().size();
+      }
+    } else if (!uri.IsNull()) {
+      image.path = directory + DecodeURI(uri.GetString());
+    } else if (view_index >= 0 && view_index < static_cast<int32_t>(buffer_views_.size())) {
+      const BufferView &view = buffer_views_[view_index];
+      image.data = buffers_[view.buffer].data + view.offset;
+      image.size = view.length;
+    }
+    ML_LOG_IF(Warning, image.path.empty() && !image.data, "Image %zu of %s has no data", i, path.c_str());
+    images_.push_back(image);
+  }
+
+  auto get_image = [&texture_images](const JsonValue &texture_info) {
+    const int32_t texture = texture_info.Get("index").GetInt(-1);
+    return texture >= 0 && texture < static_cast<int32_t>(texture_images.size()) ? texture_images[texture] : -1;
+  };
+  const JsonValue &materials = document.Get("materials");
+  for (size_t i = 0; i < materials.GetSize(); ++i) {
+    const JsonValue &value = materials.Get(i);
+    const JsonValue &pbr = value.Get("pbrMetallicRoughness");
+    Material material;
+    material.base_color = get_image(pbr.Get("baseColorTexture"));
+    material.metallic_roughness = get_image(pbr.Get("metallicRoughnessTexture"));
+    material.normal = get_image(value.Get("normalTexture"));
+    material.occlusion = get_image(value.Get("occlusionTexture"));
+    material.emissive = get_image(value.Get("emissiveTexture"));
+    materials_.push_back(material);
+  }
+
+  const JsonValue &meshes = document.Get("meshes");
+  for (size_t i = 0; i < meshes.GetSize(); ++i) {
+    const JsonValue &primitives = meshes.Get(i).Get("primitives");
+    meshes_.emplace_back();
+    for (size_t j = 0; j < primitives.GetSize(); ++j) {
+      const JsonValue &value = primitives.Get(j);
+      const JsonValue &attributes = value.Get("attributes");
+      Primitive primitive;
+      primitive.position = attributes.Get("POSITION").GetInt(-1);
+      primitive.normal = attributes.Get("NORMAL").GetInt(-1);
+      primitive.tex_coord = attributes.Get("TEXCOORD_0").GetInt(-1);
+      primitive.tangent = attributes.Get("TANGENT").GetInt(-1);
+      primitive.indices = value.Get("indices").GetInt(-1);
+      primitive.material = value.Get("material").GetInt(-1);
+      primitive.mode = value.Get("mode").GetInt(kModeTriangles);
+      if (primitive.material >= static_cast<int32_t>(materials_.size())) {
+        primitive.material = -1;
+      }
+      meshes_.back().push_back(primitive);
+    }
+  }
+
+  const JsonValue &nodes = document.Get("nodes");
+  std::vector<bool> is_child(nodes.GetSize(), false);
+  for (size_t i = 0; i < nodes.GetSize(); ++i) {
+    const JsonValue &value = nodes.Get(i);
+    Node node;
+    node.translation = glm::vec3(0.0f);
+    node.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    node.scale = glm::vec3(1.0f);
+    const JsonValue &matrix = value.Get("matrix");
+    if (matrix.GetSize() == 16) {
+      float elements[16];
+      for (size_t k = 0; k < 16; ++k) {
+        elements[k] = matrix.Get(k).GetNumber(0.0);
+      }
+      glm::vec3 skew;
+      glm::vec4 perspective;
+      glm::decompose(glm::make_mat4(elements), node.scale, node.rotation, node.translation, skew, perspective);
+    } else {
+      const JsonValue &translation = value.Get("translation");
+      const JsonValue &rotation = value.Get("rotation");
+      const JsonValue &scale = value.Get("scale");
+      if (translation.GetSize() == 3) {
+        node.translation = glm::vec3(translation.Get(size_t(0)).GetNumber(0.0), translation.Get(1).GetNumber(0.0),
+                                     translation.Get(2).GetNumber(0.0));
+      }
+      if (rotation.GetSize() == 4) {
+        // Stored x, y, z, w
+        node.rotation = glm::quat(rotation.Get(3).GetNumber(1.0), rotation.Get(size_t(0)).GetNumber(0.0),
+                                  rotation.Get(1).GetNumber(0.0), rotation.Get(2).GetNumber(0.0));
+      }
+      if (scale.GetSize() == 3) {
+        node.scale =
+            glm::vec3(scale.Get(size_t(0)).GetNumber(1.0), scale.Get(1).GetNumber(1.0), scale.Get(2).GetNumber(1.0));
+      }
+    }
+    node.mesh = value.Get("mesh").GetInt(-1);
+    if (node.mesh >= static_cast<int32_t>(meshes_.size())) {
+      node.mesh = -1;
+    }
+    const JsonValue &children = value.Get("children");
+    for (size_t k = 0; k < children.GetSize(); ++k) {
+      const int32_t child = children.Get(k).GetInt(-1);
+      // A child listed twice would make a cycle, the hierarchy has to be a forest
+      if (child < 0 || child >= static_cast<int32_t>(nodes.GetSize()) || is_child[child]) {
+        ML_LOG(Error, "Node %zu of %s has an invalid child", i, path.c_str());
+        return false;
+      }
+      is_child[child] = true;
+      node.children.push_back(child);
+    }
+    nodes_.push_back(node);
+  }
+
+  const JsonValue &scenes = document.Get("scenes");
+  const JsonValue &scene_nodes = scenes.Get(document.Get("scene").GetInt(0)).Get("nodes");
+  for (size_t i = 0; i < scene_nodes.GetSize(); ++i) {
+    const int32_t node = scene_nodes.Get(i).GetInt(-1);
+    if (node >= 0 && node < static_cast<int32_t>(nodes_.size()) && !is_child[node]) {
+      scene_nodes_.push_back(node);
+    }
+  }
+  if (scenes.GetSize() == 0) {
+    // Without scenes every root node is shown
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+      if (!is_child[i]) {
+        scene_nodes_.push_back(i);
+      }
+    }
+  }
+  return true;
+}
+
+bool GLTFAsset::GetAccessor(int32_t index, Accessor &accessor) const {
+  if (index < 0 || index >= static_cast<int32_t>(accessors_.size())) {
+    return false;
+  }
+  const AccessorView &view = accessors_[index];
+  const uint32_t component_size = GetComponentSize(view.component_type);
+  if (view.sparse || view.buffer_view < 0 || view.buffer_view >= static_cast<int32_t>(buffer_views_.size()) ||
+      component_size == 0 || view.component_count == 0) {
+    return false;
+  }
+  const BufferView &buffer_view = buffer_views_[view.buffer_view];
+  const uint32_t element_size = component_size * view.component_count;
+  const uint32_t stride = buffer_view.stride ? buffer_view.stride : element_size;
+  if (view.count > 0 && (stride < element_size || view.offset > buffer_view.length ||
+                         (view.count - 1) * static_cast<uint64_t>(stride) + element_size >
+                             buffer_view.length - view.offset)) {
+    return false;
+  }
+  accessor.data = buffers_[buffer_view.buffer].data + buffer_view.offset + view.offset;
+  accessor.count = view.count;
+  accessor.stride = stride;
+  accessor.component_type = view.component_type;
+  accessor.component_count = view.component_count;
+  accessor.normalized = view.normalized;
+  return true;
+}
+}
+}
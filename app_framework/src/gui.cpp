@@ -103,6 +103,7 @@ void Gui::Initialize(MLHandle input_handle) {
   std::shared_ptr<Mesh> quad = Registry::GetInstance()->GetResourcePool()->GetMesh<QuadMesh>();
   std::shared_ptr<TexturedMaterial> gui_mat = std::make_shared<TexturedMaterial>(off_screen_texture_);
   std::shared_ptr<RenderableComponent> gui_renderable = std::make_shared<RenderableComponent>(quad, gui_mat);
+  gui_renderable->options.transparent = true;
   gui_node_ = std::make_shared<Node>();
   gui_node_->AddComponent(gui_renderable);
 
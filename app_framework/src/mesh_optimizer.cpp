@@ -0,0 +1,213 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include <app_framework/mesh_optimizer.h>
+
+#include <algorithm>
+
+namespace ml {
+namespace app_framework {
+
+static const uint32_t kNoVertex = ~0u;
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t> &indices, uint32_t num_vertices,
+                                    uint32_t cache_size) {
+  VertexCacheStats stats{0, static_cast<uint32_t>(indices.size() / 3), num_vertices};
+  // Miss count when each vertex last entered the cache, 0 for never. The last cache_size misses are in it.
+  std::vector<uint32_t> entered(num_vertices, 0);
+  for (uint32_t index : indices) {
+    if (index >= num_vertices) {
+      continue;
+    }
+    if (entered[index] == 0 || stats.transformed - entered[index] >= cache_size) {
+      entered[index] = ++stats.transformed;
+    }
+  }
+  return stats;
+}
+
+void OptimizeVertexCache(const std::vector<uint32_t> &indices, uint32_t num_vertices, uint32_t cache_size,
+                         std::vector<uint32_t> &result, std::vector<uint32_t> &clusters) {
+  const uint32_t num_triangles = static_cast<uint32_t>(indices.size() / 3);
+  result.clear();
+  result.reserve(num_triangles * 3);
+  clusters.clear();
+
+  // Triangles of each vertex
+  std::vector<uint32_t> offsets(num_vertices + 1, 0);
+  for (uint32_t i = 0; i < num_triangles * 3; ++i) {
+    ++offsets[indices[i] + 1];
+  }
+  for (uint32_t v = 0; v < num_vertices; ++v) {
+    offsets[v + 1] += offsets[v];
+  }
+  std::vector<uint32_t> adjacency(num_triangles * 3);
+  std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+  for (uint32_t i = 0; i < num_triangles * 3; ++i) {
+    adjacency[fill[indices[i]]++] = i / 3;
+  }
+
+  // Triangles of each vertex not emitted yet
+  std::vector<uint32_t> live(num_vertices);
+  for (uint32_t v = 0; v < num_vertices; ++v) {
+    live[v] = offsets[v + 1] - offsets[v];
+  }
+  // Time each vertex entered the cache, the clock starts past the size so none are in it
+  std::vector<uint32_t> cache_time(num_vertices, 0);
+  uint32_t time = cache_size + 1;
+  std::vector<bool> emitted(num_triangles, false);
+  // Vertices of the emitted triangles, most recent last, to restart from when fanning runs out
+  std::vector<uint32_t> dead_end;
+  std::vector<uint32_t> candidates;
+  uint32_t cursor = 0;
+
+  auto skip_dead_end = [&]() {
+    while (!dead_end.empty()) {
+      const uint32_t v = dead_end.back();
+      dead_end.pop_back();
+      if (live[v] > 0) {
+        return v;
+      }
+    }
+    for (; cursor < num_vertices; ++cursor) {
+      if (live[cursor] > 0) {
+        return cursor;
+      }
+    }
+    return kNoVertex;
+  };
+
+  uint32_t fanning = skip_dead_end();
+  bool flushed = true;
+  while (fanning != kNoVertex) {
+    if (flushed) {
+      clusters.push_back(static_cast<uint32_t>(result.size() / 3));
+    }
+
+    // Emit the whole fan of the vertex
+    candidates.clear();
+    for (uint32_t i = offsets[fanning]; i < offsets[fanning + 1]; ++i) {
+      const uint32_t triangle = adjacency[i];
+      if (emitted[triangle]) {
+        continue;
+      }
+      for (uint32_t c = 0; c < 3; ++c) {
+        const uint32_t v = indices[triangle * 3 + c];
+        result.push_back(v);
+        dead_end.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        if (time - cache_time[v] > cache_size) {
+          cache_time[v] = time++;
+        }
+      }
+      emitted[triangle] = true;
+    }
+
+    // Next the oldest candidate that stays in the cache while its own fan is emitted
+    uint32_t next = kNoVertex;
+    int64_t best_priority = -1;
+    for (uint32_t v : candidates) {
+      if (live[v] == 0) {
+        continue;
+      }
+      int64_t priority = 0;
+      if (time - cache_time[v] + 2 * live[v] <= cache_size) {
+        priority = time - cache_time[v];
+      }
+      if (priority > best_priority) {
+        best_priority = priority;
+        next = v;
+      }
+    }
+    if (next == kNoVertex) {
+      next = skip_dead_end();
+    }
+    // A cluster ends where the next fan starts with nothing useful in the cache
+    flushed = next != kNoVertex && time - cache_time[next] > cache_size;
+    fanning = next;
+  }
+}
+
+void OptimizeOverdraw(const glm::vec3 *positions, const std::vector<uint32_t> &clusters,
+                      std::vector<uint32_t> &indices) {
+  const uint32_t num_triangles = static_cast<uint32_t>(indices.size() / 3);
+  if (clusters.size() < 2) {
+    return;
+  }
+
+  struct Cluster {
+    uint32_t begin;
+    uint32_t end;
+    // Area weighted sums of the triangles, the area is counted twice
+    glm::vec3 centroid;
+    glm::vec3 normal;
+    float area;
+    float sort_key;
+  };
+  std::vector<Cluster> sorted(clusters.size());
+  glm::vec3 mesh_centroid(0.0f);
+  float mesh_area = 0.0f;
+  for (size_t i = 0; i < clusters.size(); ++i) {
+    Cluster &cluster = sorted[i];
+    cluster.begin = clusters[i];
+    cluster.end = i + 1 < clusters.size() ? clusters[i + 1] : num_triangles;
+    cluster.centroid = glm::vec3(0.0f);
+    cluster.normal = glm::vec3(0.0f);
+    cluster.area = 0.0f;
+    for (uint32_t t = cluster.begin; t < cluster.end; ++t) {
+      const glm::vec3 &a = positions[indices[t * 3]];
+      const glm::vec3 &b = positions[indices[t * 3 + 1]];
+      const glm::vec3 &c = positions[indices[t * 3 + 2]];
+      const glm::vec3 normal = glm::cross(b - a, c - a);
+      const float area = glm::length(normal);
+      cluster.centroid += (a + b + c) * (area / 3.0f);
+      cluster.normal += normal;
+      cluster.area += area;
+    }
+    mesh_centroid += cluster.centroid;
+    mesh_area += cluster.area;
+  }
+  if (mesh_area <= 0.0f) {
+    return;
+  }
+  mesh_centroid /= mesh_area;
+
+  // How far out the cluster faces, the linear approximation of the occlusion test of the paper
+  for (auto &cluster : sorted) {
+    const float normal_length = glm::length(cluster.normal);
+    if (cluster.area <= 0.0f || normal_length <= 0.0f) {
+      cluster.sort_key = 0.0f;
+      continue;
+    }
+    cluster.sort_key = glm::dot(cluster.centroid / cluster.area - mesh_centroid, cluster.normal / normal_length);
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const Cluster &a, const Cluster &b) { return a.sort_key > b.sort_key; });
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  for (const auto &cluster : sorted) {
+    result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+  }
+  indices.swap(result);
+}
+
+uint32_t OptimizeVertexFetch(std::vector<uint32_t> &indices, uint32_t num_vertices, std::vector<uint32_t> &remap) {
+  remap.assign(num_vertices, kNoVertex);
+  uint32_t next = 0;
+  for (auto &index : indices) {
+    if (remap[index] == kNoVertex) {
+      remap[index] = next++;
+    }
+    index = remap[index];
+  }
+  return next;
+}
+}
+}
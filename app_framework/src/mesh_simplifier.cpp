@@ -0,0 +1,248 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include <app_framework/mesh_simplifier.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace ml {
+namespace app_framework {
+
+// Sum of the squared distances to a set of planes, as the symmetric matrix of the plane equations
+struct Quadric {
+  double a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+
+  void AddPlane(const glm::vec3 &normal, float distance) {
+    const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+    a2 += a * a;
+    b2 += b * b;
+    c2 += c * c;
+    ab += a * b;
+    ac += a * c;
+    bc += b * c;
+    ad += a * d;
+    bd += b * d;
+    cd += c * d;
+    d2 += d * d;
+  }
+
+  void Add(const Quadric &other) {
+    a2 += other.a2;
+    b2 += other.b2;
+    c2 += other.c2;
+    ab += other.ab;
+    ac += other.ac;
+    bc += other.bc;
+    ad += other.ad;
+    bd += other.bd;
+    cd += other.cd;
+    d2 += other.d2;
+  }
+
+  double Evaluate(const glm::vec3 &point) const {
+    const double x = point.x, y = point.y, z = point.z;
+    return a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z) +
+           2.0 * (ad * x + bd * y + cd * z) + d2;
+  }
+};
+
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  float error;
+};
+
+static uint64_t GetEdgeKey(uint32_t a, uint32_t b) {
+  return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+static void RemoveDegenerateTriangles(std::vector<uint32_t> &indices) {
+  size_t count = 0;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    const uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+    if (a == b || b == c || c == a) {
+      continue;
+    }
+    indices[count++] = a;
+    indices[count++] = b;
+    indices[count++] = c;
+  }
+  indices.resize(count);
+}
+
+float SimplifyMesh(const glm::vec3 *positions, uint32_t num_vertices, const std::vector<uint32_t> &indices,
+                   uint32_t target_index_count, float target_error, std::vector<uint32_t> &result) {
+  result.assign(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+  RemoveDegenerateTriangles(result);
+
+  // Vertices sharing a position with another, split by a seam in the other attributes. Welded by position
+  // they give the topology, where an edge used by a single triangle is on the border.
+  std::vector<uint32_t> sorted(num_vertices);
+  for (uint32_t v = 0; v < num_vertices; ++v) {
+    sorted[v] = v;
+  }
+  auto position_less = [positions](uint32_t a, uint32_t b) {
+    const glm::vec3 &pa = positions[a];
+    const glm::vec3 &pb = positions[b];
+    return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+  };
+  std::sort(sorted.begin(), sorted.end(), position_less);
+  std::vector<uint32_t> welded(num_vertices);
+  std::vector<bool> locked(num_vertices, false);
+  for (uint32_t begin = 0, end = 0; begin < num_vertices; begin = end) {
+    for (end = begin + 1; end < num_vertices && positions[sorted[end]] == positions[sorted[begin]]; ++end) {
+    }
+    for (uint32_t i = begin; i < end; ++i) {
+      welded[sorted[i]] = sorted[begin];
+      locked[sorted[i]] = end - begin > 1;
+    }
+  }
+  // Seam vertices neither move nor receive collapses, the border ones can still receive them
+  std::vector<bool> seam(locked);
+  std::unordered_map<uint64_t, uint32_t> edge_counts;
+  for (size_t i = 0; i < result.size(); i += 3) {
+    for (uint32_t e = 0; e < 3; ++e) {
+      ++edge_counts[GetEdgeKey(welded[result[i + e]], welded[result[i + (e + 1) % 3]])];
+    }
+  }
+  for (size_t i = 0; i < result.size(); i += 3) {
+    for (uint32_t e = 0; e < 3; ++e) {
+      const uint32_t a = result[i + e];
+      const uint32_t b = result[i + (e + 1) % 3];
+      if (edge_counts[GetEdgeKey(welded[a], welded[b])] == 1) {
+        locked[a] = true;
+        locked[b] = true;
+      }
+    }
+  }
+
+  // Planes of the triangles around each vertex
+  std::vector<Quadric> quadrics(num_vertices, Quadric{});
+  for (size_t i = 0; i < result.size(); i += 3) {
+    const glm::vec3 &a = positions[result[i]];
+    const glm::vec3 normal = glm::cross(positions[result[i + 1]] - a, positions[result[i + 2]] - a);
+    const float length = glm::length(normal);
+    if (length <= 0.0f) {
+      continue;
+    }
+    const glm::vec3 unit_normal = normal / length;
+    for (uint32_t c = 0; c < 3; ++c) {
+      quadrics[result[i + c]].AddPlane(unit_normal, -glm::dot(unit_normal, a));
+    }
+  }
+
+  // Passes of independent collapses, the candidates are scored again between them
+  float max_error = 0.0f;
+  std::vector<Collapse> candidates;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> adjacency;
+  std::vector<bool> touched(num_vertices);
+  std::vector<uint32_t> remap(num_vertices);
+  while (result.size() > target_index_count) {
+    candidates.clear();
+    for (size_t i = 0; i < result.size(); i += 3) {
+      for (uint32_t e = 0; e < 3; ++e) {
+        const uint32_t a = result[i + e];
+        const uint32_t b = result[i + (e + 1) % 3];
+        const uint32_t ends[2][2] = {{a, b}, {b, a}};
+        for (const auto &end : ends) {
+          if (locked[end[0]] || seam[end[1]]) {
+            continue;
+          }
+          Quadric quadric = quadrics[end[0]];
+          quadric.Add(quadrics[end[1]]);
+          const float error = static_cast<float>(std::sqrt(std::max(quadric.Evaluate(positions[end[1]]), 0.0)));
+          if (error <= target_error) {
+            candidates.push_back(Collapse{end[0], end[1], error});
+          }
+        }
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Collapse &a, const Collapse &b) { return a.error < b.error; });
+
+    // Triangles of each vertex
+    offsets.assign(num_vertices + 1, 0);
+    for (uint32_t index : result) {
+      ++offsets[index + 1];
+    }
+    for (uint32_t v = 0; v < num_vertices; ++v) {
+      offsets[v + 1] += offsets[v];
+    }
+    adjacency.resize(result.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (uint32_t i = 0; i < result.size(); ++i) {
+      adjacency[fill[result[i]]++] = i / 3;
+    }
+
+    std::fill(touched.begin(), touched.end(), false);
+    for (uint32_t v = 0; v < num_vertices; ++v) {
+      remap[v] = v;
+    }
+    const size_t triangles_to_remove = (result.size() - target_index_count + 2) / 3;
+    size_t removed = 0;
+    for (const Collapse &collapse : candidates) {
+      if (removed >= triangles_to_remove) {
+        break;
+      }
+      if (touched[collapse.from] || touched[collapse.to]) {
+        continue;
+      }
+      // Rejected when one of the triangles left around the vertex would fold over
+      bool flips = false;
+      size_t collapsed_triangles = 0;
+      for (uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1] && !flips; ++i) {
+        const uint32_t *triangle = &result[adjacency[i] * 3];
+        if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+          ++collapsed_triangles;
+          continue;
+        }
+        glm::vec3 corners[3];
+        for (uint32_t c = 0; c < 3; ++c) {
+          corners[c] = positions[triangle[c]];
+        }
+        const glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+        for (uint32_t c = 0; c < 3; ++c) {
+          if (triangle[c] == collapse.from) {
+            corners[c] = positions[collapse.to];
+          }
+        }
+        const glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+        flips = glm::dot(before, after) <= 0.0f;
+      }
+      if (flips) {
+        continue;
+      }
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to].Add(quadrics[collapse.from]);
+      max_error = std::max(max_error, collapse.error);
+      removed += collapsed_triangles;
+      // The triangles around the vertex change, their other collapses wait for the next pass
+      for (uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1]; ++i) {
+        const uint32_t *triangle = &result[adjacency[i] * 3];
+        touched[triangle[0]] = true;
+        touched[triangle[1]] = true;
+        touched[triangle[2]] = true;
+      }
+      touched[collapse.to] = true;
+    }
+    if (removed == 0) {
+      break;
+    }
+    for (auto &index : result) {
+      index = remap[index];
+    }
+    RemoveDegenerateTriangles(result);
+  }
+  return max_error;
+}
+}
+}
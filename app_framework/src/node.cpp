@@ -13,6 +13,7 @@
 #include <algorithm>
 #include <app_framework/ml_macros.h>
 #include <app_framework/node.h>
+#include <app_framework/render/render_list.h>
 #include <glm/ext.hpp>
 #define GLM_ENABLE_EXPERIMENTAL 1
 #include <glm/gtx/transform.hpp>
@@ -23,15 +24,16 @@ namespace app_framework {
 Node::Node() : Node(glm::vec3(0)) {}
 
 Node::Node(const glm::vec3 &translation_vector)
-    : local_dirty_(true),
-      world_dirty_(true),
-      local_transform_(glm::mat4(1)),
-      local_translation_(translation_vector),
-      local_rotation_(glm::mat4(1)),
-      local_scale_(glm::vec3(1, 1, 1)),
-      world_transform_(glm::mat4(1)),
-      parent_(),
-      name_("") {}
+    : transform_(TransformStore::GetInstance()->Allocate(translation_vector)), parent_(), name_("") {}
+
+Node::~Node() {
+  // The children can outlive this node, they become roots of the transform hierarchy
+  const auto &transform_store = TransformStore::GetInstance();
+  for (auto &child : child_list_) {
+    transform_store->SetParent(child->transform_, TransformStore::kInvalidHandle);
+  }
+  transform_store->Release(transform_);
+}
 
 bool Node::AddChild(std::shared_ptr<ml::app_framework::Node> new_child) {
   auto shared_this = shared_from_this();
@@ -58,8 +60,9 @@ bool Node::AddChild(std::shared_ptr<ml::app_framework::Node> new_child) {
   }
 
   new_child->parent_ = shared_this;
-  new_child->SetDirty();
+  TransformStore::GetInstance()->SetParent(new_child->transform_, transform_);
   child_list_.push_back(new_child);
+  new_child->SetRenderList(render_list_.lock());
   return true;
 }
 
@@ -69,6 +72,8 @@ bool Node::RemoveChild(std::shared_ptr<ml::app_framework::Node> child) {
                                      [child](std::shared_ptr<ml::app_framework::Node> &node) { return node == child; }),
                       child_list_.end());
     child->parent_.reset();
+    TransformStore::GetInstance()->SetParent(child->transform_, TransformStore::kInvalidHandle);
+    child->SetRenderList(nullptr);
   } else {
     ML_LOG(Error, "Can not remove null pointer");
     return false;
@@ -80,14 +85,28 @@ const std::vector<std::shared_ptr<ml::app_framework::Node>> &Node::GetChildren()
   return child_list_;
 }
 
-const glm::mat4 Node::GetParentWorldTransform() const {
-  glm::mat4 parentWorldTransform;
-  if (auto locked_parent = parent_.lock()) {
-    parentWorldTransform = locked_parent->GetWorldTransform();
-  } else {
-    parentWorldTransform = glm::mat4(1);
+void Node::SetRenderList(std::shared_ptr<RenderList> render_list) {
+  std::vector<std::shared_ptr<ml::app_framework::Node>> dfs_stack;
+  dfs_stack.push_back(shared_from_this());
+  while (!dfs_stack.empty()) {
+    auto back = dfs_stack.back();
+    dfs_stack.pop_back();
+    auto previous_render_list = back->render_list_.lock();
+    if (previous_render_list == render_list) {
+      // The subtree is already attached to this render list
+      continue;
+    }
+    if (previous_render_list) {
+      previous_render_list->MarkDirty(back);
+    }
+    if (render_list) {
+      render_list->MarkDirty(back);
+    }
+    back->render_list_ = render_list;
+    for (auto &child : back->child_list_) {
+      dfs_stack.push_back(child);
+    }
   }
-  return parentWorldTransform;
 }
 
 void Node::SetName(std::string name) {
@@ -95,40 +114,39 @@ void Node::SetName(std::string name) {
 }
 
 const bool Node::IsDirty() const {
-  return local_dirty_ || world_dirty_;
+  return TransformStore::GetInstance()->IsWorldStale(transform_);
 }
 
 void Node::SetDirty() {
-  local_dirty_ = true;
-  world_dirty_ = true;
-  for (auto &child : child_list_) {
-    child->SetDirty();
-  }
+  TransformStore::GetInstance()->Invalidate(transform_);
 }
 
 void Node::SetLocalTranslation(const glm::vec3 &translation) {
-  SetDirty();
-  local_translation_ = translation;
+  TransformStore::GetInstance()->SetLocalTranslation(transform_, translation);
 }
 
 void Node::SetWorldTranslation(const glm::vec3 &translation) {
-  SetDirty();
-  local_translation_ = glm::vec3(glm::inverse(GetParentWorldTransform()) * glm::vec4(translation, 1));
+  glm::vec3 local_translation = translation;
+  if (auto locked_parent = parent_.lock()) {
+    local_translation = glm::vec3(locked_parent->GetInverseWorldTransform() * glm::vec4(translation, 1));
+  }
+  TransformStore::GetInstance()->SetLocalTranslation(transform_, local_translation);
 }
 
 void Node::SetLocalRotation(const glm::quat &quaternion) {
-  SetDirty();
-  local_rotation_ = quaternion;
+  TransformStore::GetInstance()->SetLocalRotation(transform_, quaternion);
 }
 
 void Node::SetWorldRotation(const glm::quat &quaternion) {
-  SetDirty();
-  local_rotation_ = glm::quat_cast(glm::inverse(GetParentWorldTransform())) * quaternion;
+  glm::quat local_rotation = quaternion;
+  if (auto locked_parent = parent_.lock()) {
+    local_rotation = glm::inverse(locked_parent->GetWorldRotation()) * quaternion;
+  }
+  TransformStore::GetInstance()->SetLocalRotation(transform_, local_rotation);
 }
 
 void Node::SetLocalScale(const glm::vec3 &scale_vector) {
-  SetDirty();
-  local_scale_ = scale_vector;
+  TransformStore::GetInstance()->SetLocalScale(transform_, scale_vector);
 }
 
 void Node::AddComponent(std::shared_ptr<app_framework::Component> component) {
@@ -140,42 +158,46 @@ void Node::AddComponent(std::shared_ptr<app_framework::Component> component) {
   components_.push_back(component);
   components_by_type_[component->GetRuntimeType()] = component;
   component->SetNode(shared_from_this());
-}
 
-const glm::mat4 &Node::GetLocalTransform() const {
-  if (local_dirty_) {
-    local_transform_ = glm::translate(local_translation_) * glm::mat4_cast(local_rotation_) * glm::scale(local_scale_);
-    local_dirty_ = false;
+  if (auto locked_render_list = render_list_.lock()) {
+    locked_render_list->MarkDirty(shared_from_this());
   }
-  return local_transform_;
 }
 
-const glm::mat4 &Node::GetWorldTransform() const {
-  if (world_dirty_) {
-    world_transform_ = GetParentWorldTransform() * GetLocalTransform();
-    world_dirty_ = false;
-  }
-  return world_transform_;
+const glm::mat4 Node::GetLocalTransform() const {
+  return TransformStore::GetInstance()->GetLocalTransform(transform_);
+}
+
+const glm::mat4 Node::GetWorldTransform() const {
+  return TransformStore::GetInstance()->GetWorldTransform(transform_);
 }
 
-const glm::vec3 &Node::GetLocalTranslation() const {
-  return local_translation_;
+const glm::vec3 Node::GetLocalTranslation() const {
+  return TransformStore::GetInstance()->GetLocalTranslation(transform_);
+}
+
+const glm::mat4 Node::GetInverseWorldTransform() const {
+  return TransformStore::GetInstance()->GetInverseWorldTransform(transform_);
 }
 
 const glm::vec3 Node::GetWorldTranslation() const {
-  return glm::vec3(GetWorldTransform()[3]);
+  return TransformStore::GetInstance()->GetWorldTranslation(transform_);
 }
 
-const glm::quat &Node::GetLocalRotation() const {
-  return local_rotation_;
+const glm::quat Node::GetLocalRotation() const {
+  return TransformStore::GetInstance()->GetLocalRotation(transform_);
 }
 
 const glm::quat Node::GetWorldRotation() const {
-  return glm::toQuat(GetWorldTransform());
+  return TransformStore::GetInstance()->GetWorldRotation(transform_);
+}
+
+const glm::vec3 Node::GetLocalScale() const {
+  return TransformStore::GetInstance()->GetLocalScale(transform_);
 }
 
-const glm::vec3 &Node::GetLocalScale() const {
-  return local_scale_;
+const glm::vec3 Node::GetWorldScale() const {
+  return TransformStore::GetInstance()->GetWorldScale(transform_);
 }
 
 }  // namespace app_framework
@@ -8,29 +8,176 @@
 // %BANNER_END%
 #include "buffer.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
 namespace ml {
 namespace app_framework {
 
+static const GLuint64 kStreamFenceTimeoutNs = 1000000000;
+// Regions of streamed buffers start at multiples of this, enough for any vertex or index type
+static const uint64_t kStreamRegionAlignment = 256;
+
+static std::atomic<uint64_t> s_total_reallocation_count(0);
+static std::atomic<uint64_t> s_total_uploaded_bytes(0);
+
+const uint32_t Buffer::kStreamRegionCount;
+
 Buffer::Buffer(Buffer::Category category, GLint gl_buffer_type)
-    : buffer_(0), gl_buffer_type_(gl_buffer_type), category_(category) {
+    : buffer_(0),
+      gl_buffer_type_(gl_buffer_type),
+      category_(category),
+      size_(0),
+      capacity_(0),
+      offset_(0),
+      allocation_version_(0),
+      reallocation_count_(0),
+      uploaded_bytes_(0),
+      stream_data_(nullptr),
+      stream_region_(0) {
   gl_buffer_category_ = Buffer::GetGLBufferCategory(category);
+  for (auto &fence : stream_fences_) {
+    fence = 0;
+  }
   glGenBuffers(1, &buffer_);
 }
 
 Buffer::~Buffer() {
+  ReleaseStreamStorage();
   if (buffer_) {
     glDeleteBuffers(1, &buffer_);
     buffer_ = 0;
   }
 }
 
+uint64_t Buffer::GetTotalReallocationCount() {
+  return s_total_reallocation_count;
+}
+
+uint64_t Buffer::GetTotalUploadedBytes() {
+  return s_total_uploaded_bytes;
+}
+
+void Buffer::RecreateGLBuffer(uint64_t size) {
+  if (buffer_) {
+    glDeleteBuffers(1, &buffer_);
+  }
+  glGenBuffers(1, &buffer_);
+  size_ = size;
+  capacity_ = size;
+  OnReallocated();
+}
+
+uint64_t Buffer::GetGrownCapacity(uint64_t size) const {
+  return std::max(size, capacity_ + capacity_ / 2);
+}
+
+void Buffer::OnReallocated() {
+  ++allocation_version_;
+  ++reallocation_count_;
+  ++s_total_reallocation_count;
+}
+
 void Buffer::UpdateBuffer(const char *data, uint64_t size) {
-  if (data != nullptr && size > 0) {
-    size_ = size;
-    glBindBuffer(gl_buffer_type_, buffer_);
-    glBufferData(gl_buffer_type_, size, data, gl_buffer_category_);
-    glBindBuffer(gl_buffer_type_, 0);
+  if (data == nullptr || size == 0) {
+    return;
+  }
+
+  if (category_ != Category::Stream || !GLAD_GL_ARB_buffer_storage || !UpdateStreamBuffer(data, size)) {
+    // The element array binding belongs to the bound vertex array, upload index data through the copy target
+    GLenum target = gl_buffer_type_ == GL_ELEMENT_ARRAY_BUFFER ? GL_COPY_WRITE_BUFFER : gl_buffer_type_;
+    glBindBuffer(target, buffer_);
+    if (size > capacity_) {
+      capacity_ = GetGrownCapacity(size);
+      glBufferData(target, capacity_, nullptr, gl_buffer_category_);
+      OnReallocated();
+    } else if (category_ != Category::Static) {
+      // Orphan the storage, the driver hands out a fresh one instead of waiting for the pending draws
+      glBufferData(target, capacity_, nullptr, gl_buffer_category_);
+    }
+    glBufferSubData(target, 0, size, data);
+    glBindBuffer(target, 0);
+  }
+
+  size_ = size;
+  uploaded_bytes_ += size;
+  s_total_uploaded_bytes += size;
+}
+
+void Buffer::UpdateBufferRange(const char *data, uint64_t offset, uint64_t size) {
+  if (data == nullptr || size == 0) {
+    return;
+  }
+  if (offset + size > capacity_ || stream_data_) {
+    ML_LOG(Error, "Buffer range update of %" PRIu64 " bytes at %" PRIu64 " does not fit in place", size, offset);
+    return;
+  }
+  GLenum target = gl_buffer_type_ == GL_ELEMENT_ARRAY_BUFFER ? GL_COPY_WRITE_BUFFER : gl_buffer_type_;
+  glBindBuffer(target, buffer_);
+  glBufferSubData(target, offset, size, data);
+  glBindBuffer(target, 0);
+
+  size_ = std::max(size_, offset + size);
+  uploaded_bytes_ += size;
+  s_total_uploaded_bytes += size;
+}
+
+bool Buffer::UpdateStreamBuffer(const char *data, uint64_t size) {
+  if (size > capacity_ || !stream_data_) {
+    ReleaseStreamStorage();
+    const uint64_t capacity =
+        (GetGrownCapacity(size) + kStreamRegionAlignment - 1) / kStreamRegionAlignment * kStreamRegionAlignment;
+    RecreateGLBuffer(capacity);
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, capacity_ * kStreamRegionCount, nullptr, flags);
+    stream_data_ =
+        static_cast<char *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity_ * kStreamRegionCount, flags));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (!stream_data_) {
+      ML_LOG(Error, "Failed to map the streamed buffer persistently, falling back to dynamic updates");
+      category_ = Category::Dynamic;
+      gl_buffer_category_ = GetGLBufferCategory(category_);
+      RecreateGLBuffer(0);
+      return false;
+    }
+    stream_region_ = 0;
+  } else {
+    // The draws issued so far read the current region, fence it and move on to the next one
+    stream_fences_[stream_region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stream_region_ = (stream_region_ + 1) % kStreamRegionCount;
+    GLsync &fence = stream_fences_[stream_region_];
+    if (fence) {
+      GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, kStreamFenceTimeoutNs);
+      if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+        ML_LOG(Warning, "Streamed buffer fence wait did not complete (0x%x)", result);
+      }
+      glDeleteSync(fence);
+      fence = 0;
+    }
+  }
+
+  offset_ = stream_region_ * capacity_;
+  memcpy(stream_data_ + offset_, data, size);
+  return true;
+}
+
+void Buffer::ReleaseStreamStorage() {
+  for (auto &fence : stream_fences_) {
+    if (fence) {
+      glDeleteSync(fence);
+      fence = 0;
+    }
+  }
+  if (stream_data_) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    stream_data_ = nullptr;
   }
+  offset_ = 0;
 }
 }
 }
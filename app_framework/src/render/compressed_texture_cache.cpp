@@ -0,0 +1,244 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "compressed_texture_cache.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+// Not part of the core profile, listed in GL_COMPRESSED_TEXTURE_FORMATS when supported
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+namespace ml {
+namespace app_framework {
+
+// Part of the keys, bumped whenever the mips or the baking change
+static const uint32_t kBakeVersion = 1;
+static const unsigned char kKTXIdentifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+static const uint32_t kKTXEndianness = 0x04030201;
+// Anything larger comes from a corrupted file
+static const uint32_t kMaxLevelSize = 256 * 1024 * 1024;
+
+// Fields of the KTX 1.1 header after the identifier
+struct KTXHeader {
+  uint32_t endianness;
+  uint32_t gl_type;
+  uint32_t gl_type_size;
+  uint32_t gl_format;
+  uint32_t gl_internal_format;
+  uint32_t gl_base_internal_format;
+  uint32_t pixel_width;
+  uint32_t pixel_height;
+  uint32_t pixel_depth;
+  uint32_t array_element_count;
+  uint32_t face_count;
+  uint32_t level_count;
+  uint32_t key_value_data_size;
+};
+
+CompressedTextureCache::CompressedTextureCache()
+    : linear_format_(0),
+      srgb_format_(0),
+      num_loaded_(0),
+      num_baked_(0),
+      compressed_bytes_(0),
+      uncompressed_bytes_(0) {}
+
+const std::unique_ptr<CompressedTextureCache> &CompressedTextureCache::GetInstance() {
+  static std::unique_ptr<CompressedTextureCache> instance(new CompressedTextureCache());
+  return instance;
+}
+
+void CompressedTextureCache::SetDirectory(const std::string &directory) {
+  directory_ = directory;
+  linear_format_ = 0;
+  srgb_format_ = 0;
+  if (directory_.empty()) {
+    return;
+  }
+
+  GLint format_count = 0;
+  glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &format_count);
+  std::vector<GLint> formats(format_count);
+  if (format_count > 0) {
+    glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+  }
+  auto supported = [&formats](GLenum format) {
+    return std::find(formats.begin(), formats.end(), static_cast<GLint>(format)) != formats.end();
+  };
+  // Desktop drivers may list ETC2 while only emulating it, BC comes first there
+#if ML_LUMIN
+  const GLenum candidates[][2] = {{GL_COMPRESSED_RGBA8_ETC2_EAC, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC}};
+#else
+  const GLenum candidates[][2] = {{GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT},
+                                  {GL_COMPRESSED_RGBA8_ETC2_EAC, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC}};
+#endif
+  for (const auto &candidate : candidates) {
+    if (supported(candidate[0]) && supported(candidate[1])) {
+      linear_format_ = candidate[0];
+      srgb_format_ = candidate[1];
+      break;
+    }
+  }
+  if (!linear_format_) {
+    ML_LOG(Warning, "The driver supports none of the texture compression formats, textures are not compressed");
+    directory_.clear();
+    return;
+  }
+  if (directory_.back() != '/') {
+    directory_ += '/';
+  }
+  ML_LOG(Debug, "Caching compressed textures (0x%x, 0x%x) in %s", linear_format_.load(), srgb_format_.load(),
+         directory_.c_str());
+}
+
+GLenum CompressedTextureCache::GetFormat(GLint gl_internal_format) const {
+  if (!IsEnabled()) {
+    return 0;
+  }
+  switch (gl_internal_format) {
+    case GL_RGBA8: return linear_format_;
+    case GL_SRGB8_ALPHA8: return srgb_format_;
+    default: return 0;
+  }
+}
+
+void CompressedTextureCache::DisableFormat(GLenum format) {
+  // Warned once, by the first texture that failed
+  GLenum linear = format;
+  GLenum srgb = format;
+  const bool linear_disabled = linear_format_.compare_exchange_strong(linear, 0);
+  const bool srgb_disabled = srgb_format_.compare_exchange_strong(srgb, 0);
+  ML_LOG_IF(Warning, linear_disabled || srgb_disabled,
+            "The driver failed to compress to 0x%x, textures of the format are left uncompressed", format);
+}
+
+uint64_t CompressedTextureCache::GetKey(const unsigned char *source, uint64_t size, GLenum format) const {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ull;
+  auto hash_bytes = [&hash](const void *data, uint64_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (uint64_t i = 0; i < size; ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ull;
+    }
+  };
+  hash_bytes(&kBakeVersion, sizeof(kBakeVersion));
+  hash_bytes(&format, sizeof(format));
+  hash_bytes(source, size);
+  return hash;
+}
+
+std::string CompressedTextureCache::GetPath(uint64_t key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "texture_%016" PRIx64 ".ktx", key);
+  return directory_ + name;
+}
+
+bool CompressedTextureCache::Load(uint64_t key, Entry &entry) const {
+  if (!IsEnabled()) {
+    return false;
+  }
+  FILE *file = fopen(GetPath(key).c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+
+  unsigned char identifier[sizeof(kKTXIdentifier)];
+  KTXHeader header{};
+  bool valid = fread(identifier, sizeof(identifier), 1, file) == 1 && fread(&header, sizeof(header), 1, file) == 1 &&
+               memcmp(identifier, kKTXIdentifier, sizeof(identifier)) == 0 && header.endianness == kKTXEndianness &&
+               header.gl_type == 0 && header.pixel_depth == 0 && header.face_count == 1 && header.level_count > 0 &&
+               header.level_count <= 32 && fseek(file, header.key_value_data_size, SEEK_CUR) == 0;
+
+  entry.format = header.gl_internal_format;
+  entry.levels.clear();
+  entry.data.clear();
+  for (uint32_t i = 0; valid && i < header.level_count; ++i) {
+    uint32_t size = 0;
+    valid = fread(&size, sizeof(size), 1, file) == 1 && size <= kMaxLevelSize;
+    if (!valid) {
+      break;
+    }
+    TextureLevel level;
+    level.width = std::max<int32_t>(header.pixel_width >> i, 1);
+    level.height = std::max<int32_t>(header.pixel_height >> i, 1);
+    level.offset = entry.data.size();
+    level.size = size;
+    entry.data.resize(entry.data.size() + size);
+    // Levels are padded to 4 bytes
+    const uint32_t padding = 3 - ((size + 3) % 4);
+    valid = (size == 0 || fread(entry.data.data() + level.offset, size, 1, file) == 1) &&
+            fseek(file, padding, SEEK_CUR) == 0;
+    entry.levels.push_back(level);
+  }
+  fclose(file);
+
+  if (!valid) {
+    ML_LOG(Warning, "Ignoring the corrupted texture cache file %s", GetPath(key).c_str());
+    return false;
+  }
+  return true;
+}
+
+void CompressedTextureCache::Store(uint64_t key, const Entry &entry) const {
+  if (!IsEnabled() || entry.levels.empty()) {
+    return;
+  }
+  KTXHeader header{};
+  header.endianness = kKTXEndianness;
+  header.gl_type_size = 1;
+  header.gl_internal_format = entry.format;
+  header.gl_base_internal_format = GL_RGBA;
+  header.pixel_width = entry.levels[0].width;
+  header.pixel_height = entry.levels[0].height;
+  header.face_count = 1;
+  header.level_count = entry.levels.size();
+
+  // Written next to the final file and renamed, a partial file is never read back
+  const std::string path = GetPath(key);
+  const std::string temp_path = path + ".tmp";
+  FILE *file = fopen(temp_path.c_str(), "wb");
+  if (!file) {
+    ML_LOG(Warning, "Failed to create the texture cache file %s", temp_path.c_str());
+    return;
+  }
+  static const unsigned char kPadding[3] = {};
+  bool written = fwrite(kKTXIdentifier, sizeof(kKTXIdentifier), 1, file) == 1 &&
+                 fwrite(&header, sizeof(header), 1, file) == 1;
+  for (const auto &level : entry.levels) {
+    const uint32_t size = level.size;
+    const uint32_t padding = 3 - ((size + 3) % 4);
+    written = written && fwrite(&size, sizeof(size), 1, file) == 1 &&
+              fwrite(entry.data.data() + level.offset, 1, size, file) == size &&
+              fwrite(kPadding, 1, padding, file) == padding;
+  }
+  if (fclose(file) != 0 || !written || rename(temp_path.c_str(), path.c_str()) != 0) {
+    ML_LOG(Warning, "Failed to write the texture cache file %s", path.c_str());
+    remove(temp_path.c_str());
+  }
+}
+
+void CompressedTextureCache::AddTexture(bool loaded, uint64_t compressed_bytes, uint64_t uncompressed_bytes) {
+  if (loaded) {
+    ++num_loaded_;
+  } else {
+    ++num_baked_;
+  }
+  compressed_bytes_ += compressed_bytes;
+  uncompressed_bytes_ += uncompressed_bytes;
+}
+}
+}
@@ -0,0 +1,120 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "gl_state_cache.h"
+
+namespace ml {
+namespace app_framework {
+
+// Value no call sets, the state is unknown until the first call
+static const GLuint kUnknown = ~0u;
+
+GLStateCache::GLStateCache() : num_issued_(0), num_elided_(0) {
+  Invalidate();
+}
+
+void GLStateCache::Enable(GLenum capability) {
+  SetCapability(capability, true);
+}
+
+void GLStateCache::Disable(GLenum capability) {
+  SetCapability(capability, false);
+}
+
+void GLStateCache::SetCapability(GLenum capability, bool enabled) {
+  auto it = capabilities_.find(capability);
+  if (it != capabilities_.end() && it->second == enabled) {
+    ++num_elided_;
+    return;
+  }
+  capabilities_[capability] = enabled;
+  ++num_issued_;
+  if (enabled) {
+    glEnable(capability);
+  } else {
+    glDisable(capability);
+  }
+}
+
+void GLStateCache::BlendFunc(GLenum src, GLenum dst) {
+  if (Update(blend_func_, std::make_pair(src, dst))) {
+    glBlendFunc(src, dst);
+  }
+}
+
+void GLStateCache::PolygonMode(GLenum mode) {
+  if (Update(polygon_mode_, mode)) {
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+  }
+}
+
+void GLStateCache::PointSize(float size) {
+  if (Update(point_size_, size)) {
+    glPointSize(size);
+  }
+}
+
+void GLStateCache::BindProgramPipeline(GLuint pipeline) {
+  if (Update(program_pipeline_, pipeline)) {
+    glBindProgramPipeline(pipeline);
+  }
+}
+
+void GLStateCache::BindVertexArray(GLuint vertex_array) {
+  if (Update(vertex_array_, vertex_array)) {
+    glBindVertexArray(vertex_array);
+  }
+}
+
+void GLStateCache::BindUniformBufferRange(GLuint binding, GLuint buffer, uint64_t offset, uint64_t size) {
+  if (binding >= uniform_buffers_.size()) {
+    uniform_buffers_.resize(binding + 1, BufferRange{kUnknown, 0, 0});
+  }
+  if (Update(uniform_buffers_[binding], BufferRange{buffer, offset, size})) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+  }
+}
+
+void GLStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture) {
+  if (unit >= textures_.size()) {
+    textures_.resize(unit + 1, TextureBinding{kUnknown, kUnknown});
+  }
+  if (textures_[unit] == TextureBinding{target, texture}) {
+    ++num_elided_;
+    return;
+  }
+  if (Update(active_texture_unit_, unit)) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+  }
+  Update(textures_[unit], TextureBinding{target, texture});
+  glBindTexture(target, texture);
+}
+
+void GLStateCache::Invalidate() {
+  capabilities_.clear();
+  blend_func_ = std::make_pair(kUnknown, kUnknown);
+  polygon_mode_ = kUnknown;
+  // Not a valid point size
+  point_size_ = -1.0f;
+  InvalidateBindings();
+}
+
+void GLStateCache::InvalidateBindings() {
+  program_pipeline_ = kUnknown;
+  vertex_array_ = kUnknown;
+  uniform_buffers_.clear();
+  active_texture_unit_ = kUnknown;
+  textures_.clear();
+}
+
+void GLStateCache::ResetCounters() {
+  num_issued_ = 0;
+  num_elided_ = 0;
+}
+}
+}
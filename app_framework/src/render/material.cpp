@@ -8,10 +8,17 @@
 // %BANNER_END%
 #include "material.h"
 
+#include <algorithm>
+#include <atomic>
+
 namespace ml {
 namespace app_framework {
 
-Material::Material(const Material& rhs) {
+static std::atomic<uint32_t> s_next_material_id(0);
+
+Material::Material() : dirty_(true), id_(s_next_material_id++), param_slot_(0) {}
+
+Material::Material(const Material& rhs) : id_(s_next_material_id++), param_slot_(0) {
   dirty_ = true;
   SetVertexProgram(rhs.vert_);
   SetGeometryProgram(rhs.geom_);
@@ -24,14 +31,24 @@ Material::Material(const Material& rhs) {
   }
 }
 
-std::shared_ptr<UniformBuffer> Material::UpdateMaterialUniformBuffer() {
-  if (!buffer_) {
-    return nullptr;
+Material::~Material() {
+  if (param_arena_) {
+    param_arena_->Release(param_slot_);
   }
+}
 
-  if (!dirty_) {
-    return buffer_;
+void Material::UpdateMaterialParams() {
+  if (!param_arena_ || !dirty_) {
+    return;
+  }
+  const char *params = GetParamsData();
+  if (params) {
+    // Already laid out as the block
+    param_arena_->Write(param_slot_, params, GetParamsSize());
+    dirty_ = false;
+    return;
   }
+
   // Pack the buffer
   for (const auto& des : blk_desc_.entries) {
     auto variable = variables_by_name_[des.name];
@@ -46,37 +63,47 @@ std::shared_ptr<UniformBuffer> Material::UpdateMaterialUniformBuffer() {
               des.size, variable_size);
     memcpy(ubo_cache_.data() + des.offset, variable->GetMemoryPtr(), variable_size);
   }
-  buffer_->UpdateBuffer(ubo_cache_.data(), ubo_cache_.size());
+  param_arena_->Write(param_slot_, ubo_cache_.data(), ubo_cache_.size());
   dirty_ = false;
-  return buffer_;
 }
 
-void Material::UpdateMaterialUniforms() {
-  // Update texture
+void Material::UpdateMaterialUniforms(GLStateCache &state) {
+  // Update texture, units already holding the texture are skipped
   for(int i = 0; i < textures_des_.size(); ++i) {
-    const auto& des = textures_des_[i];
-    auto variable = variables_by_name_[des.name];
-    std::shared_ptr<Texture> tex = variable->GetValue<std::shared_ptr<Texture>>();
+    std::shared_ptr<Texture> tex = texture_variables_[i]->GetValue<std::shared_ptr<Texture>>();
     if (!tex) {
       continue;
     }
-    glActiveTexture(GL_TEXTURE0 + i);
-    glBindTexture(tex->GetTextureType(), tex->GetGLTexture());
+    state.BindTexture(i, tex->GetTextureType(), tex->GetGLTexture());
   }
 }
 
 void Material::BuildVariable() {
+  // The fragment program can be replaced, start over from the new one
+  if (param_arena_) {
+    param_arena_->Release(param_slot_);
+    param_arena_.reset();
+  }
+  variables_by_name_.clear();
+  textures_des_.clear();
+  texture_variables_.clear();
+
   const auto& fragment_ubo_blk_list = frag_->GetUniformBlocks();
   auto fragment_ubo_it = fragment_ubo_blk_list.find(UniformName::kMaterial);
   if (fragment_ubo_it != fragment_ubo_blk_list.end()) {
     blk_desc_ = fragment_ubo_it->second;
-    buffer_ = std::make_shared<UniformBuffer>(Buffer::Category::Dynamic);
-    ubo_cache_.resize(blk_desc_.size);
-    variables_by_name_.clear();
+    param_arena_ = MaterialParamArena::Get(frag_->GetGLProgram(), blk_desc_.size);
+    param_slot_ = param_arena_->Allocate();
+    dirty_ = true;
 
-    for (const auto& des: blk_desc_.entries) {
-      std::shared_ptr<Variable> variable = MakeVariableFromGLType(des.name, des.type);
-      variables_by_name_[variable->GetName()] = variable;
+    if (GetParamsData()) {
+      ValidateParams();
+    } else {
+      ubo_cache_.resize(blk_desc_.size);
+      for (const auto& des: blk_desc_.entries) {
+        std::shared_ptr<Variable> variable = MakeVariableFromGLType(des.name, des.type);
+        variables_by_name_[variable->GetName()] = variable;
+      }
     }
   }
 
@@ -90,10 +117,38 @@ void Material::BuildVariable() {
       glUniform1i(des.location, textures_des_.size() - 1);
       std::shared_ptr<Variable> variable = MakeVariableFromGLType(des.name, des.type);
       variables_by_name_[variable->GetName()] = variable;
+      texture_variables_.push_back(variable);
       glUseProgram(0);
     }
   }
 }
 
+void Material::UseTypedParams() {
+  for (const auto &des : blk_desc_.entries) {
+    variables_by_name_.erase(des.name);
+  }
+  std::vector<char>().swap(ubo_cache_);
+  if (param_arena_) {
+    ValidateParams();
+  }
+}
+
+void Material::ValidateParams() const {
+  const auto fields = GetParamFields();
+  for (const auto& des : blk_desc_.entries) {
+    auto field = std::find_if(fields.begin(), fields.end(),
+                              [&des](const MaterialParamField &field) { return des.name == field.name; });
+    if (field == fields.end()) {
+      ML_LOG(Fatal, "Entry of the Material block (%s) is missing in the parameter struct", des.name.c_str());
+      continue;
+    }
+    const uint64_t size = des.type == GL_BOOL ? sizeof(Std140Bool) : des.size;
+    ML_LOG_IF(Fatal, field->offset != des.offset || field->size != size,
+              "Parameter %s is at offset %" PRIu64 " with size %" PRIu64 ", the shader expects offset %" PRIu64
+              " with size %" PRIu64,
+              des.name.c_str(), field->offset, field->size, des.offset, size);
+  }
+}
+
 }
 }
@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "material_param_arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace ml {
+namespace app_framework {
+
+static std::unordered_map<GLuint, std::weak_ptr<MaterialParamArena>> s_arenas;
+
+MaterialParamArena::MaterialParamArena(uint64_t block_size)
+    : block_size_(block_size),
+      slot_size_(block_size),
+      dirty_begin_(std::numeric_limits<uint64_t>::max()),
+      dirty_end_(0) {
+  GLint alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  if (alignment > 0) {
+    slot_size_ = (block_size + alignment - 1) / alignment * alignment;
+  }
+  buffer_ = std::make_shared<Buffer>(Buffer::Category::Dynamic, GL_UNIFORM_BUFFER);
+}
+
+std::shared_ptr<MaterialParamArena> MaterialParamArena::Get(GLuint fragment_program, uint64_t block_size) {
+  auto arena = s_arenas[fragment_program].lock();
+  if (!arena || arena->GetBlockSize() != block_size) {
+    arena = std::make_shared<MaterialParamArena>(block_size);
+    s_arenas[fragment_program] = arena;
+  }
+  return arena;
+}
+
+void MaterialParamArena::FlushAll() {
+  for (auto it = s_arenas.begin(); it != s_arenas.end();) {
+    auto arena = it->second.lock();
+    if (!arena) {
+      it = s_arenas.erase(it);
+      continue;
+    }
+    arena->Flush();
+    ++it;
+  }
+}
+
+uint32_t MaterialParamArena::Allocate() {
+  if (!free_slots_.empty()) {
+    uint32_t slot = free_slots_.back();
+    free_slots_.pop_back();
+    return slot;
+  }
+  uint32_t slot = static_cast<uint32_t>(data_.size() / slot_size_);
+  data_.resize(data_.size() + slot_size_, 0);
+  return slot;
+}
+
+void MaterialParamArena::Release(uint32_t slot) {
+  free_slots_.push_back(slot);
+}
+
+void MaterialParamArena::Write(uint32_t slot, const char *data, uint64_t size) {
+  const uint64_t offset = GetOffset(slot);
+  size = std::min(size, block_size_);
+  memcpy(data_.data() + offset, data, size);
+  dirty_begin_ = std::min(dirty_begin_, offset);
+  dirty_end_ = std::max(dirty_end_, offset + size);
+}
+
+void MaterialParamArena::Flush() {
+  if (dirty_begin_ >= dirty_end_) {
+    return;
+  }
+  if (data_.size() > buffer_->GetCapacity()) {
+    // New slots since the last flush, the whole arena goes to the grown storage
+    buffer_->UpdateBuffer(data_.data(), data_.size());
+  } else {
+    buffer_->UpdateBufferRange(data_.data() + dirty_begin_, dirty_begin_, dirty_end_ - dirty_begin_);
+  }
+  dirty_begin_ = std::numeric_limits<uint64_t>::max();
+  dirty_end_ = 0;
+}
+}
+}
@@ -8,14 +8,125 @@
 // %BANNER_END%
 #include "mesh.h"
 
+#include <atomic>
+
 namespace ml {
 namespace app_framework {
 
-Mesh::Mesh(Buffer::Category buffer_category, GLint index_buffer_element_type) : num_vertices_(0) {
+static std::atomic<uint32_t> s_next_mesh_id(0);
+
+Mesh::Mesh(Buffer::Category buffer_category, GLint index_buffer_element_type)
+    : id_(s_next_mesh_id++), num_vertices_(0) {
   vert_buffer_ = std::make_shared<VertexBuffer>(VertexAttributeName::kPosition, buffer_category, GL_FLOAT, 3);
   normal_buffer_ = std::make_shared<VertexBuffer>(VertexAttributeName::kNormal, buffer_category, GL_FLOAT, 3);
   tex_coords_buffer_ = std::make_shared<VertexBuffer>(VertexAttributeName::kTextureCoordinates, buffer_category, GL_FLOAT, 2);
   index_buffer_ = std::make_shared<IndexBuffer>(buffer_category, index_buffer_element_type);
 }
+
+Mesh::~Mesh() {
+  for (auto &pair : vertex_arrays_) {
+    glDeleteVertexArrays(1, &pair.second.gl_vertex_array);
+  }
+}
+
+GLuint Mesh::GetVertexArray(const VertexProgram &program, GLStateCache &state) {
+  const uint64_t layout_version = GetLayoutVersion();
+  auto it = vertex_arrays_.find(program.GetAttributeLayoutId());
+  if (it != vertex_arrays_.end()) {
+    if (it->second.layout_version == layout_version) {
+      state.BindVertexArray(it->second.gl_vertex_array);
+      for (const auto &streamed : it->second.streamed_attributes) {
+        BindAttributeBuffer(streamed.first, *streamed.second);
+      }
+      return it->second.gl_vertex_array;
+    }
+    // Start from a clean vertex array, attributes of a dropped buffer must not stay enabled.
+    // Unbound first, the name can be handed out again to the new one.
+    state.BindVertexArray(0);
+    glDeleteVertexArrays(1, &it->second.gl_vertex_array);
+    vertex_arrays_.erase(it);
+  }
+
+  VertexArray vertex_array{0, layout_version, {}};
+  glGenVertexArrays(1, &vertex_array.gl_vertex_array);
+  state.BindVertexArray(vertex_array.gl_vertex_array);
+
+  const auto &vertex_attr_list = program.GetVertexAttributes();
+  BindAttribute(vert_buffer_, VertexAttributeName::kPosition, vertex_attr_list, vertex_array);
+  BindAttribute(normal_buffer_, VertexAttributeName::kNormal, vertex_attr_list, vertex_array);
+  BindAttribute(tex_coords_buffer_, VertexAttributeName::kTextureCoordinates, vertex_attr_list, vertex_array);
+  for (const auto &custom_buffer : custom_buffers_) {
+    BindAttribute(custom_buffer, custom_buffer->GetName(), vertex_attr_list, vertex_array);
+  }
+  if (index_buffer_->GetIndexCount() > 0) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_->GetGLBuffer());
+  }
+
+  vertex_arrays_[program.GetAttributeLayoutId()] = vertex_array;
+  return vertex_array.gl_vertex_array;
+}
+
+std::shared_ptr<Mesh> Mesh::CreateLod(void const *indices, size_t num_indices) const {
+  auto lod = std::make_shared<Mesh>(index_buffer_->GetCategory(), index_buffer_->GetIndexType());
+  lod->vert_buffer_ = vert_buffer_;
+  lod->normal_buffer_ = normal_buffer_;
+  lod->tex_coords_buffer_ = tex_coords_buffer_;
+  lod->custom_buffers_ = custom_buffers_;
+  lod->num_vertices_ = num_vertices_;
+  lod->index_buffer_->UpdateBuffer((char *)indices, num_indices * lod->index_buffer_->GetIndexSize());
+  return lod;
+}
+
+uint64_t Mesh::GetLayoutVersion() const {
+  uint64_t version = custom_buffers_.size() + vert_buffer_->GetAllocationVersion() +
+                     normal_buffer_->GetAllocationVersion() + tex_coords_buffer_->GetAllocationVersion() +
+                     index_buffer_->GetAllocationVersion();
+  for (const auto &custom_buffer : custom_buffers_) {
+    version += custom_buffer->GetAllocationVersion();
+  }
+  return version;
+}
+
+uint64_t Mesh::GetGPUByteSize() const {
+  uint64_t size = vert_buffer_->GetCapacity() + normal_buffer_->GetCapacity() + tex_coords_buffer_->GetCapacity() +
+                  index_buffer_->GetCapacity();
+  for (const auto &custom_buffer : custom_buffers_) {
+    size += custom_buffer->GetCapacity();
+  }
+  return size;
+}
+
+void Mesh::BindAttribute(const std::shared_ptr<VertexBuffer> &buffer, const std::string &name,
+                         const std::unordered_map<std::string, VertexAttributeDescription> &vertex_attr_list,
+                         VertexArray &vertex_array) {
+  if (!buffer || buffer->GetVertexCount() == 0) {
+    return;
+  }
+  auto it = vertex_attr_list.find(name);
+  if (it == vertex_attr_list.end() || it->second.location < 0) {
+    return;
+  }
+  const GLuint location = it->second.location;
+  if (GLAD_GL_VERSION_4_3) {
+    // One binding point per attribute, named after its location
+    glVertexAttribFormat(location, buffer->GetElementCount(), buffer->GetElementType(), GL_FALSE, 0);
+    glVertexAttribBinding(location, location);
+  }
+  BindAttributeBuffer(location, *buffer);
+  glEnableVertexAttribArray(location);
+  if (buffer->GetCategory() == Buffer::Category::Stream) {
+    vertex_array.streamed_attributes.push_back(std::make_pair(location, buffer));
+  }
+}
+
+void Mesh::BindAttributeBuffer(GLuint location, const VertexBuffer &buffer) {
+  if (GLAD_GL_VERSION_4_3) {
+    glBindVertexBuffer(location, buffer.GetGLBuffer(), buffer.GetOffset(), buffer.GetVertexSize());
+  } else {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer.GetGLBuffer());
+    glVertexAttribPointer(location, buffer.GetElementCount(), buffer.GetElementType(), GL_FALSE,
+                          buffer.GetVertexSize(), (void *)buffer.GetOffset());
+  }
+}
 }
 }
@@ -0,0 +1,61 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "pipeline_cache.h"
+
+#include <chrono>
+
+namespace ml {
+namespace app_framework {
+
+PipelineCache::PipelineCache() : num_hits_(0), num_misses_(0), num_warmed_(0), creation_time_(0.0) {}
+
+PipelineCache::~PipelineCache() {
+  for (const auto &pair : pipelines_) {
+    glDeleteProgramPipelines(1, &pair.second);
+  }
+}
+
+GLuint PipelineCache::GetPipeline(const ShaderKey &key) {
+  auto it = pipelines_.find(key);
+  if (it != pipelines_.end()) {
+    ++num_hits_;
+    return it->second;
+  }
+  ++num_misses_;
+  ML_LOG(Debug, "Pipeline (%u, %u, %u) created while drawing, it was not warmed", std::get<0>(key), std::get<1>(key),
+         std::get<2>(key));
+  return CreatePipeline(key);
+}
+
+void PipelineCache::Warm(const ShaderKey &key) {
+  if (pipelines_.find(key) == pipelines_.end()) {
+    ++num_warmed_;
+    CreatePipeline(key);
+  }
+}
+
+GLuint PipelineCache::CreatePipeline(const ShaderKey &key) {
+  const auto start_time = std::chrono::steady_clock::now();
+  GLuint pipeline = 0;
+  glGenProgramPipelines(1, &pipeline);
+  glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, std::get<0>(key));
+  if (std::get<1>(key) != 0) {
+    glUseProgramStages(pipeline, GL_GEOMETRY_SHADER_BIT, std::get<1>(key));
+  }
+  glUseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, std::get<2>(key));
+  // Validation links the stages together, which most drivers would otherwise defer to the first draw
+  glValidateProgramPipeline(pipeline);
+  pipelines_[key] = pipeline;
+
+  const std::chrono::duration<double> creation_time = std::chrono::steady_clock::now() - start_time;
+  creation_time_ += creation_time.count();
+  return pipeline;
+}
+}
+}
@@ -6,10 +6,12 @@
 // %COPYRIGHT_END%
 // ---------------------------------------------------------------------
 // %BANNER_END%
+#include <chrono>
 #include <set>
 
 #include "gl_type_size.h"
 #include "program.h"
+#include "program_cache.h"
 
 namespace ml {
 namespace app_framework {
@@ -17,25 +19,117 @@ namespace app_framework {
 const std::string VertexAttributeName::kPosition("position");
 const std::string VertexAttributeName::kNormal("normal");
 const std::string VertexAttributeName::kTextureCoordinates("tex_coords");
+const std::string VertexAttributeName::kTangent("tangent");
+const std::string VertexAttributeName::kInstanceModel("instance_model");
+const std::string VertexAttributeName::kInstanceColor("instance_color");
+const std::string VertexAttributeName::kInstanceColorWeight("instance_color_weight");
 const std::string UniformName::kMaterial("Material");
 const std::string UniformName::kTransforms("Transforms");
 const std::string UniformName::kLight("Lights");
+const std::string UniformName::kStereoTransforms("StereoTransforms");
 
 GLint Program::sMaxUniformBinding = 0;
 GLint Program::sVertBindingLocation = 0;
 GLint Program::sGeomBindingLocation = 0;
 GLint Program::sFragBindingLocation = 0;
 
-Program::Program(const char *code, GLenum type) : program_(0), type_(type), uniform_cnt_(0), uniform_blk_cnt_(0) {
+Program::Program(const char *code, GLenum type) : code_(code), program_(0), type_(type), uniform_cnt_(0), uniform_blk_cnt_(0) {
+  const auto start_time = std::chrono::steady_clock::now();
+  const auto &cache = ProgramCache::GetInstance();
+  ProgramCache::Entry entry;
+  uint64_t key = 0;
+  bool loaded = false;
+  if (cache->IsEnabled()) {
+    key = cache->GetKey(code_, type_);
+    loaded = cache->Load(key, entry) && LoadBinary(entry.binary_format, entry.binary);
+    if (loaded) {
+      SetReflection(entry.uniform_blocks, entry.uniforms);
+    }
+  }
+
+  if (!loaded) {
+    Compile();
+    Reflect();
+    GLint binary_length = 0;
+    glGetProgramiv(program_, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+    if (cache->IsEnabled() && binary_length > 0) {
+      entry.binary.resize(binary_length);
+      glGetProgramBinary(program_, binary_length, nullptr, &entry.binary_format, entry.binary.data());
+      entry.uniform_blocks.clear();
+      for (const auto &pair : uniform_blocks_by_name_) {
+        entry.uniform_blocks.push_back(pair.second);
+      }
+      entry.uniforms.clear();
+      for (const auto &pair : uniforms_by_name_) {
+        entry.uniforms.push_back(pair.second);
+      }
+      cache->Store(key, entry);
+    }
+  }
+
+  const std::chrono::duration<double> build_time = std::chrono::steady_clock::now() - start_time;
+  cache->AddProgram(loaded, build_time.count());
+}
+
+void Program::Compile() {
   GLint success = 0;
   char info_log[512]{};
 
-  program_ = glCreateShaderProgramv(type_, 1, &code);
+  // Same as glCreateShaderProgramv, with the hint set before linking
+  const char *code = code_.c_str();
+  GLuint shader = glCreateShader(type_);
+  glShaderSource(shader, 1, &code, nullptr);
+  glCompileShader(shader);
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  if (!success) {
+    glGetShaderInfoLog(shader, 512, nullptr, info_log);
+    ML_LOG(Fatal, "Shader compilation failed: %s", info_log);
+  }
+
+  program_ = glCreateProgram();
+  glProgramParameteri(program_, GL_PROGRAM_SEPARABLE, GL_TRUE);
+  glProgramParameteri(program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glAttachShader(program_, shader);
+  glLinkProgram(program_);
+  glDetachShader(program_, shader);
+  glDeleteShader(shader);
   glGetProgramiv(program_, GL_LINK_STATUS, &success);
   if (!success) {
     glGetProgramInfoLog(program_, 512, nullptr, info_log);
     ML_LOG(Fatal, "Shader compilation failed: %s", info_log);
   }
+}
+
+bool Program::LoadBinary(GLenum binary_format, const std::vector<char> &binary) {
+  program_ = glCreateProgram();
+  glProgramParameteri(program_, GL_PROGRAM_SEPARABLE, GL_TRUE);
+  glProgramBinary(program_, binary_format, binary.data(), binary.size());
+  GLint success = 0;
+  glGetProgramiv(program_, GL_LINK_STATUS, &success);
+  if (!success) {
+    ML_LOG(Warning, "Cached program binary rejected by the driver, compiling the program");
+    glDeleteProgram(program_);
+    program_ = 0;
+    return false;
+  }
+  return true;
+}
+
+void Program::SetReflection(const std::vector<UniformBlockDescription> &uniform_blocks,
+                            const std::vector<UniformDescription> &uniforms) {
+  // The block bindings are not part of the binary
+  for (const auto &block : uniform_blocks) {
+    glUniformBlockBinding(program_, block.index, block.binding);
+    uniform_blocks_by_name_[block.name] = block;
+  }
+  for (const auto &uniform : uniforms) {
+    uniforms_by_name_[uniform.name] = uniform;
+  }
+  glGetProgramiv(program_, GL_ACTIVE_UNIFORM_BLOCKS, &uniform_blk_cnt_);
+  glGetProgramiv(program_, GL_ACTIVE_UNIFORMS, &uniform_cnt_);
+}
+
+void Program::Reflect() {
   glUseProgram(program_);
 
   GLint binding = 0;
@@ -53,7 +147,7 @@ Program::Program(const char *code, GLenum type) : program_(0), type_(type), unif
 
   if (type_ == GL_VERTEX_SHADER) {
     binding = sVertBindingLocation;
-  } else if (type == GL_GEOMETRY_SHADER) {
+  } else if (type_ == GL_GEOMETRY_SHADER) {
     binding = sGeomBindingLocation;
   } else {
     binding = sFragBindingLocation;
@@ -140,5 +234,17 @@ Program::~Program() {
     program_ = 0;
   }
 }
+
+std::string Program::InjectPreamble(const char *code, const std::string &preamble) {
+  std::string result(code);
+  size_t position = 0;
+  size_t version = result.find("#version");
+  if (version != std::string::npos) {
+    position = result.find('\n', version);
+    position = position == std::string::npos ? result.size() : position + 1;
+  }
+  result.insert(position, preamble);
+  return result;
+}
 }
 }
@@ -0,0 +1,261 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "program_cache.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace ml {
+namespace app_framework {
+
+// Bumped whenever the layout of the file changes
+static const uint32_t kFileMagic = 0x43504c4d;  // "MLPC"
+static const uint32_t kFileVersion = 1;
+
+static void HashBytes(uint64_t &hash, const void *data, size_t size) {
+  // FNV-1a
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+}
+
+template <typename T>
+static void WriteValue(std::vector<char> &out, const T &value) {
+  const char *bytes = reinterpret_cast<const char *>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static void WriteString(std::vector<char> &out, const std::string &value) {
+  WriteValue(out, static_cast<uint32_t>(value.size()));
+  out.insert(out.end(), value.begin(), value.end());
+}
+
+static void WriteUniform(std::vector<char> &out, const UniformDescription &uniform) {
+  WriteString(out, uniform.name);
+  WriteValue(out, uniform.index);
+  WriteValue(out, uniform.size);
+  WriteValue(out, uniform.location);
+  WriteValue(out, uniform.offset);
+  WriteValue(out, uniform.type);
+}
+
+// Reads fail once past the end of the data, the caller checks IsValid at the end
+class Reader {
+public:
+  Reader(const std::vector<char> &data) : data_(data), position_(0), valid_(true) {}
+
+  template <typename T>
+  T Read() {
+    T value{};
+    if (!Has(sizeof(T))) {
+      return value;
+    }
+    memcpy(&value, data_.data() + position_, sizeof(T));
+    position_ += sizeof(T);
+    return value;
+  }
+
+  std::string ReadString() {
+    const uint32_t size = Read<uint32_t>();
+    if (!Has(size)) {
+      return std::string();
+    }
+    std::string value(data_.data() + position_, size);
+    position_ += size;
+    return value;
+  }
+
+  void ReadBytes(std::vector<char> &out, uint64_t size) {
+    if (!Has(size)) {
+      return;
+    }
+    out.assign(data_.data() + position_, data_.data() + position_ + size);
+    position_ += size;
+  }
+
+  UniformDescription ReadUniform() {
+    UniformDescription uniform;
+    uniform.name = ReadString();
+    uniform.index = Read<uint32_t>();
+    uniform.size = Read<uint64_t>();
+    uniform.location = Read<int32_t>();
+    uniform.offset = Read<uint64_t>();
+    uniform.type = Read<GLenum>();
+    return uniform;
+  }
+
+  // Counts are checked against the remaining bytes before anything is resized
+  bool Has(uint64_t size) {
+    valid_ = valid_ && size <= data_.size() - position_;
+    return valid_;
+  }
+
+  bool IsValid() const {
+    return valid_ && position_ == data_.size();
+  }
+
+private:
+  const std::vector<char> &data_;
+  size_t position_;
+  bool valid_;
+};
+
+ProgramCache::ProgramCache() : num_loaded_(0), num_compiled_(0), build_time_(0.0) {}
+
+const std::unique_ptr<ProgramCache> &ProgramCache::GetInstance() {
+  static std::unique_ptr<ProgramCache> instance(new ProgramCache());
+  return instance;
+}
+
+void ProgramCache::SetDirectory(const std::string &directory) {
+  directory_ = directory;
+  if (directory_.empty()) {
+    return;
+  }
+  GLint format_count = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+  if (format_count == 0) {
+    ML_LOG(Warning, "The driver does not support program binaries, shader programs are not cached");
+    directory_.clear();
+    return;
+  }
+  if (directory_.back() != '/') {
+    directory_ += '/';
+  }
+  ML_LOG(Debug, "Caching shader programs in %s", directory_.c_str());
+}
+
+uint64_t ProgramCache::GetKey(const std::string &code, GLenum type) {
+  if (driver_.empty()) {
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+      const GLubyte *value = glGetString(name);
+      driver_ += value ? reinterpret_cast<const char *>(value) : "";
+      driver_ += '\n';
+    }
+  }
+  uint64_t hash = 14695981039346656037ull;
+  HashBytes(hash, &kFileVersion, sizeof(kFileVersion));
+  HashBytes(hash, driver_.data(), driver_.size());
+  HashBytes(hash, &type, sizeof(type));
+  HashBytes(hash, code.data(), code.size());
+  return hash;
+}
+
+std::string ProgramCache::GetPath(uint64_t key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "program_%016" PRIx64 ".bin", key);
+  return directory_ + name;
+}
+
+bool ProgramCache::Load(uint64_t key, Entry &entry) const {
+  if (!IsEnabled()) {
+    return false;
+  }
+  FILE *file = fopen(GetPath(key).c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  std::vector<char> data;
+  char chunk[4096];
+  size_t read = 0;
+  while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    data.insert(data.end(), chunk, chunk + read);
+  }
+  fclose(file);
+
+  Reader reader(data);
+  if (reader.Read<uint32_t>() != kFileMagic || reader.Read<uint32_t>() != kFileVersion ||
+      reader.Read<uint64_t>() != key) {
+    return false;
+  }
+  entry.binary_format = reader.Read<GLenum>();
+  reader.ReadBytes(entry.binary, reader.Read<uint64_t>());
+
+  const uint32_t block_count = reader.Read<uint32_t>();
+  entry.uniform_blocks.clear();
+  for (uint32_t i = 0; i < block_count && reader.Has(1); ++i) {
+    UniformBlockDescription block;
+    block.name = reader.ReadString();
+    block.index = reader.Read<uint32_t>();
+    block.size = reader.Read<uint64_t>();
+    block.binding = reader.Read<uint32_t>();
+    const uint32_t entry_count = reader.Read<uint32_t>();
+    for (uint32_t j = 0; j < entry_count && reader.Has(1); ++j) {
+      block.entries.push_back(reader.ReadUniform());
+    }
+    entry.uniform_blocks.push_back(block);
+  }
+  const uint32_t uniform_count = reader.Read<uint32_t>();
+  entry.uniforms.clear();
+  for (uint32_t i = 0; i < uniform_count && reader.Has(1); ++i) {
+    entry.uniforms.push_back(reader.ReadUniform());
+  }
+
+  if (!reader.IsValid()) {
+    ML_LOG(Warning, "Ignoring the corrupted program cache file %s", GetPath(key).c_str());
+    return false;
+  }
+  return true;
+}
+
+void ProgramCache::Store(uint64_t key, const Entry &entry) const {
+  if (!IsEnabled()) {
+    return;
+  }
+  std::vector<char> data;
+  WriteValue(data, kFileMagic);
+  WriteValue(data, kFileVersion);
+  WriteValue(data, key);
+  WriteValue(data, entry.binary_format);
+  WriteValue(data, static_cast<uint64_t>(entry.binary.size()));
+  data.insert(data.end(), entry.binary.begin(), entry.binary.end());
+  WriteValue(data, static_cast<uint32_t>(entry.uniform_blocks.size()));
+  for (const auto &block : entry.uniform_blocks) {
+    WriteString(data, block.name);
+    WriteValue(data, block.index);
+    WriteValue(data, block.size);
+    WriteValue(data, block.binding);
+    WriteValue(data, static_cast<uint32_t>(block.entries.size()));
+    for (const auto &uniform : block.entries) {
+      WriteUniform(data, uniform);
+    }
+  }
+  WriteValue(data, static_cast<uint32_t>(entry.uniforms.size()));
+  for (const auto &uniform : entry.uniforms) {
+    WriteUniform(data, uniform);
+  }
+
+  // Written next to the final file and renamed, a partial file is never read back
+  const std::string path = GetPath(key);
+  const std::string temp_path = path + ".tmp";
+  FILE *file = fopen(temp_path.c_str(), "wb");
+  if (!file) {
+    ML_LOG(Warning, "Failed to create the program cache file %s", temp_path.c_str());
+    return;
+  }
+  const bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+  if (fclose(file) != 0 || !written || rename(temp_path.c_str(), path.c_str()) != 0) {
+    ML_LOG(Warning, "Failed to write the program cache file %s", path.c_str());
+    remove(temp_path.c_str());
+  }
+}
+
+void ProgramCache::AddProgram(bool loaded, double seconds) {
+  if (loaded) {
+    ++num_loaded_;
+  } else {
+    ++num_compiled_;
+  }
+  build_time_ += seconds;
+}
+}
+}
@@ -0,0 +1,95 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "render_list.h"
+
+#include <algorithm>
+
+#include <app_framework/node.h>
+
+namespace ml {
+namespace app_framework {
+
+template <typename ComponentType>
+static void EraseComponentsOf(std::vector<std::shared_ptr<ComponentType>> &components,
+                              const std::unordered_set<const Node *> &nodes) {
+  components.erase(std::remove_if(components.begin(), components.end(),
+                                  [&nodes](const std::shared_ptr<ComponentType> &component) {
+                                    return nodes.find(component->GetNode().get()) != nodes.end();
+                                  }),
+                   components.end());
+}
+
+void RenderList::MarkDirty(std::shared_ptr<Node> node) {
+  pending_nodes_.push_back(node);
+}
+
+void RenderList::Update() {
+  reindexed_node_count_ = 0;
+  if (pending_nodes_.empty()) {
+    return;
+  }
+
+  // Only the nodes that already have entries need a pass over the arrays,
+  // nodes that are new to the list are just appended.
+  std::unordered_set<const Node *> dirty_nodes;
+  std::unordered_set<const Node *> stale_nodes;
+  for (const auto &node : pending_nodes_) {
+    dirty_nodes.insert(node.get());
+    if (indexed_nodes_.find(node.get()) != indexed_nodes_.end()) {
+      stale_nodes.insert(node.get());
+    }
+  }
+  if (!stale_nodes.empty()) {
+    RemoveNodes(stale_nodes);
+  }
+
+  for (const auto &node : pending_nodes_) {
+    // Skip the duplicates, a node can be marked more than once per frame
+    if (dirty_nodes.erase(node.get()) == 0) {
+      continue;
+    }
+    ++reindexed_node_count_;
+    if (node->GetRenderList().get() != this) {
+      continue;
+    }
+
+    bool indexed = false;
+    auto renderable = node->GetComponent<RenderableComponent>();
+    if (renderable) {
+      renderables_.push_back(renderable);
+      indexed = true;
+    }
+    auto cam = node->GetComponent<CameraComponent>();
+    if (cam) {
+      cameras_.push_back(cam);
+      indexed = true;
+    }
+    auto light = node->GetComponent<LightComponent>();
+    if (light) {
+      lights_.push_back(light);
+      indexed = true;
+    }
+    if (indexed) {
+      indexed_nodes_.insert(node.get());
+    }
+  }
+  pending_nodes_.clear();
+}
+
+void RenderList::RemoveNodes(const std::unordered_set<const Node *> &nodes) {
+  EraseComponentsOf(renderables_, nodes);
+  EraseComponentsOf(cameras_, nodes);
+  EraseComponentsOf(lights_, nodes);
+  for (const Node *node : nodes) {
+    indexed_nodes_.erase(node);
+  }
+}
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,125 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "render_queue.h"
+
+#include <cstring>
+
+#include <app_framework/node.h>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+const uint64_t kLayerBits = 4;
+const uint64_t kPipelineBits = 12;
+const uint64_t kMaterialBits = 14;
+const uint64_t kMeshBits = 12;
+const uint64_t kDepthBits = 21;
+
+inline uint64_t Mask(uint64_t value, uint64_t bits) {
+  return value & ((uint64_t(1) << bits) - 1);
+}
+
+// The bits of a positive float sort like the float itself, keep the top ones
+inline uint64_t QuantizeDepth(float distance_squared) {
+  uint32_t bits = 0;
+  std::memcpy(&bits, &distance_squared, sizeof(bits));
+  return Mask(bits >> (31 - kDepthBits), kDepthBits);
+}
+
+}  // namespace
+
+ShaderKey RenderQueue::GetShaderKey(const RenderableComponent &renderable) {
+  auto material = renderable.GetMaterial();
+  auto geom = material->GetGeometryProgram();
+  // The geometry stage is only used for the primitives it was written for
+  bool bind_gs = geom && renderable.options.primitives == geom->GetInputPrimitiveType();
+  return std::make_tuple(material->GetVertexProgram()->GetGLProgram(), bind_gs ? geom->GetGLProgram() : 0,
+                         material->GetFragmentProgram()->GetGLProgram());
+}
+
+void RenderQueue::Build(const std::vector<std::shared_ptr<RenderableComponent>> &renderables,
+                        const glm::vec3 &view_position) {
+  entries_.clear();
+  for (uint32_t index = 0; index < renderables.size(); ++index) {
+    const auto &renderable = renderables[index];
+    if (!renderable->GetVisible()) {
+      continue;
+    }
+
+    const glm::vec3 offset = renderable->GetNode()->GetWorldTranslation() - view_position;
+    const uint64_t depth = QuantizeDepth(glm::dot(offset, offset));
+    const uint64_t layer = Mask(renderable->options.layer, kLayerBits);
+    const uint64_t pipeline = Mask(GetPipelineId(GetShaderKey(*renderable)), kPipelineBits);
+    // Instanceable materials are left out so the draws of a mesh stay contiguous and can be batched
+    const auto &renderable_material = renderable->GetMaterial();
+    const uint64_t material =
+        renderable_material->IsInstanceable() ? 0 : Mask(renderable_material->GetId(), kMaterialBits);
+    const uint64_t mesh = Mask(renderable->GetMesh()->GetId(), kMeshBits);
+    const uint64_t state = (pipeline << (kMaterialBits + kMeshBits)) | (material << kMeshBits) | mesh;
+    const uint64_t state_bits = kPipelineBits + kMaterialBits + kMeshBits;
+
+    uint64_t key = layer << (64 - kLayerBits);
+    if (renderable->options.transparent) {
+      const uint64_t inverted_depth = Mask(~depth, kDepthBits);
+      key |= uint64_t(1) << (63 - kLayerBits);
+      key |= (inverted_depth << state_bits) | state;
+    } else {
+      key |= (state << kDepthBits) | depth;
+    }
+    entries_.push_back({key, index});
+  }
+
+  Sort();
+
+  order_.resize(entries_.size());
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    order_[i] = entries_[i].index;
+  }
+}
+
+uint32_t RenderQueue::GetPipelineId(const ShaderKey &shader_key) {
+  auto it = pipeline_ids_.find(shader_key);
+  if (it != pipeline_ids_.end()) {
+    return it->second;
+  }
+  uint32_t id = static_cast<uint32_t>(pipeline_ids_.size());
+  pipeline_ids_[shader_key] = id;
+  return id;
+}
+
+void RenderQueue::Sort() {
+  // LSD radix sort on 8 bit digits, stable so the lower digits keep their order
+  const size_t count = entries_.size();
+  scratch_entries_.resize(count);
+  for (uint32_t shift = 0; shift < 64; shift += 8) {
+    size_t offsets[256] = {};
+    for (const auto &entry : entries_) {
+      ++offsets[(entry.key >> shift) & 0xff];
+    }
+    // Skip the digits shared by every key, e.g. unused layers
+    if (offsets[(entries_.empty() ? 0 : entries_[0].key >> shift) & 0xff] == count) {
+      continue;
+    }
+    size_t sum = 0;
+    for (size_t &offset : offsets) {
+      size_t digit_count = offset;
+      offset = sum;
+      sum += digit_count;
+    }
+    for (const auto &entry : entries_) {
+      scratch_entries_[offsets[(entry.key >> shift) & 0xff]++] = entry;
+    }
+    entries_.swap(scratch_entries_);
+  }
+}
+
+}  // namespace app_framework
+}  // namespace ml
@@ -17,6 +17,22 @@ RenderTarget::~RenderTarget() {
   }
 }
 
+void RenderTarget::AttachTexture(GLenum attachment, const Texture &texture, uint32_t layer_index) {
+  auto texture_type = texture.GetTextureType();
+  if (texture_type == GL_TEXTURE_2D_ARRAY) {
+    if (stereo_mode_ == StereoMode::Multiview) {
+      glFramebufferTextureMultiviewOVR(GL_FRAMEBUFFER, attachment, texture.GetGLTexture(), 0, 0, 2);
+    } else if (stereo_mode_ == StereoMode::InstancedLayer) {
+      // Layered attachment, gl_Layer selects the eye
+      glFramebufferTexture(GL_FRAMEBUFFER, attachment, texture.GetGLTexture(), 0);
+    } else {
+      glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, texture.GetGLTexture(), 0, layer_index);
+    }
+  } else if (texture_type == GL_TEXTURE_2D) {
+    glFramebufferTexture(GL_FRAMEBUFFER, attachment, texture.GetGLTexture(), 0);
+  }
+}
+
 void RenderTarget::InitializeFramebuffer() {
   gl_framebuffer_ = 0;
   if (color_) {
@@ -25,23 +41,14 @@ void RenderTarget::InitializeFramebuffer() {
     glGenFramebuffers(1, &gl_framebuffer_);
     glBindFramebuffer(GL_FRAMEBUFFER, gl_framebuffer_);
 
-    auto color_texture_type = color_->GetTextureType();
-    if (color_texture_type == GL_TEXTURE_2D_ARRAY) {
-      glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, color_->GetGLTexture(), 0,
-                                color_layer_index_);
-    } else if (color_texture_type == GL_TEXTURE_2D) {
-      glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, color_->GetGLTexture(), 0);
-    }
+    AttachTexture(GL_COLOR_ATTACHMENT0, *color_, color_layer_index_);
 
     // Only do depth when we have color
     if (depth_) {
-      auto depth_texture_type = depth_->GetTextureType();
-      if (depth_texture_type == GL_TEXTURE_2D_ARRAY) {
-        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_->GetGLTexture(), 0,
-                                  depth_layer_index_);
-      } else if (depth_texture_type == GL_TEXTURE_2D) {
-        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_->GetGLTexture(), 0);
-      }
+      AttachTexture(GL_DEPTH_ATTACHMENT, *depth_, depth_layer_index_);
+    }
+    if (stereo_mode_ != StereoMode::None && glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      ML_LOG(Error, "Layered stereo framebuffer is not complete");
     }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
   }
@@ -9,20 +9,90 @@
 #include "renderer.h"
 
 #include <algorithm>
+#include <cstddef>
+
+#include <app_framework/material/flat_material.h>
+#include <app_framework/material/magicleap_mesh_visualization_material.h>
+#include <app_framework/material/pbr_material.h>
+#include <app_framework/material/textured_material.h>
 
 namespace ml {
 namespace app_framework {
 
-Renderer::Renderer() : program_pipeline_(0), transform_uniform_buffer_dirty_(false) {}
+// A coarser level is only picked once its error is this much under the limit, so a node sitting
+// at the distance of a switch does not flip between two levels every frame
+static const float kLodHysteresis = 0.25f;
+
+Renderer::Renderer()
+    : program_pipeline_(0),
+      lights_offset_(0),
+      stereo_transforms_offset_(0),
+      stereo_mode_(StereoMode::None),
+      num_instanced_batches_(0),
+      num_instanced_draws_(0),
+      lod_pixel_error_(1.0f),
+      num_triangles_(0),
+      num_full_detail_triangles_(0) {}
 
 void Renderer::Initialize() {
-  glGenVertexArrays(1, &vertex_array_);
-  transform_uniform_buffer_ = std::make_shared<UniformBuffer>(Buffer::Category::Dynamic);
-  light_uniform_buffer_ = std::make_shared<UniformBuffer>(Buffer::Category::Dynamic);
+  frame_uniform_buffer_ = std::make_shared<UniformBuffer>(Buffer::Category::Dynamic);
+
+  // Pipelines of the materials of the framework, the stereo mode has to be set already
+  WarmPipelines(FlatMaterial(glm::vec4(1.0f)));
+  WarmPipelines(TexturedMaterial(nullptr));
+  WarmPipelines(PBRMaterial());
+  WarmPipelines(MagicLeapMeshVisualizationMaterial());
+}
+
+void Renderer::WarmPipelines(const Material &material) {
+  auto vertex_program = material.GetVertexProgram();
+  auto frag_program = material.GetFragmentProgram();
+  auto geom_program = material.GetGeometryProgram();
+  if (!vertex_program || !frag_program) {
+    return;
+  }
+
+  // The geometry stage is only bound for its input primitive type, both combinations can be drawn
+  if (geom_program) {
+    pipeline_cache_.Warm(
+        std::make_tuple(vertex_program->GetGLProgram(), geom_program->GetGLProgram(), frag_program->GetGLProgram()));
+  }
+  pipeline_cache_.Warm(std::make_tuple(vertex_program->GetGLProgram(), 0u, frag_program->GetGLProgram()));
+
+  // Same variants as RenderBatch
+  std::vector<std::pair<std::shared_ptr<VertexProgram>, std::shared_ptr<FragmentProgram>>> variants{
+      {vertex_program, frag_program}};
+  if (material.IsInstanceable() && !geom_program && vertex_program->GetInstancedVariant() &&
+      frag_program->GetInstancedVariant()) {
+    variants.emplace_back(vertex_program->GetInstancedVariant(), frag_program->GetInstancedVariant());
+  }
+  for (const auto &variant : variants) {
+    pipeline_cache_.Warm(std::make_tuple(variant.first->GetGLProgram(), 0u, variant.second->GetGLProgram()));
+    auto stereo_program = variant.first->GetStereoVariant(stereo_mode_);
+    if (stereo_program) {
+      pipeline_cache_.Warm(std::make_tuple(stereo_program->GetGLProgram(), 0u, variant.second->GetGLProgram()));
+    }
+  }
 }
 
 Renderer::~Renderer() {}
 
+void Renderer::SetSinglePassStereo(bool enable) {
+  stereo_mode_ = StereoMode::None;
+  if (enable) {
+    if (GLAD_GL_OVR_multiview) {
+      stereo_mode_ = StereoMode::Multiview;
+    } else if (GLAD_GL_ARB_shader_viewport_layer_array || GLAD_GL_AMD_vertex_shader_layer) {
+      stereo_mode_ = StereoMode::InstancedLayer;
+    } else {
+      ML_LOG(Warning, "Single pass stereo is not supported, rendering each eye separately");
+    }
+  }
+  ML_LOG(Info, "Stereo mode: %s",
+         stereo_mode_ == StereoMode::Multiview ? "multiview"
+                                               : stereo_mode_ == StereoMode::InstancedLayer ? "instanced layer" : "none");
+}
+
 void Renderer::QueueCamera(std::shared_ptr<CameraComponent> camera) {
   queued_cameras_.push_back(camera);
 }
@@ -35,89 +105,319 @@ void Renderer::QueueLight(std::shared_ptr<LightComponent> light) {
   queued_lights_.push_back(light);
 }
 
+void Renderer::SelectLods() {
+  if (queued_cameras_.empty()) {
+    return;
+  }
+  for (const std::shared_ptr<RenderableComponent> &renderable : queued_renderables_) {
+    const std::shared_ptr<const LodChain> &lods = renderable->GetLodChain();
+    if (!lods || lods->levels.empty() || !renderable->GetVisible()) {
+      continue;
+    }
+    const glm::mat4 &model = renderable->GetNode()->GetWorldTransform();
+    const glm::vec3 center = glm::vec3(model * glm::vec4(lods->center, 1.0f));
+    const float scale = std::max(glm::length(glm::vec3(model[0])),
+                                 std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    const float radius = lods->radius * scale;
+
+    // Diameter of the bounding sphere in pixels, the largest under any camera
+    float screen_size = 0.0f;
+    bool inside = false;
+    for (const std::shared_ptr<CameraComponent> &cam : queued_cameras_) {
+      const float distance = glm::length(center - cam->GetNode()->GetWorldTranslation());
+      if (distance <= radius) {
+        inside = true;
+        break;
+      }
+      screen_size =
+          std::max(screen_size, radius / distance * cam->GetProjectionMatrix()[1][1] * cam->GetViewport().w);
+    }
+    if (inside) {
+      renderable->SetLodLevel(0);
+      continue;
+    }
+
+    // The errors are relative to the radius, half the diameter on screen
+    auto pixel_error = [&lods, screen_size](uint32_t level) {
+      return level == 0 ? 0.0f : lods->levels[level - 1].error * screen_size * 0.5f;
+    };
+    uint32_t level = renderable->GetLodLevel();
+    while (level > 0 && pixel_error(level) > lod_pixel_error_) {
+      --level;
+    }
+    while (level < lods->levels.size() && pixel_error(level + 1) <= lod_pixel_error_ * (1.0f - kLodHysteresis)) {
+      ++level;
+    }
+    renderable->SetLodLevel(level);
+  }
+}
+
 void Renderer::Render() {
   // Simple single pass, per-object basis forward rendering
   if (pre_render_callback_) {
     pre_render_callback_();
   }
 
-  glEnable(GL_PROGRAM_POINT_SIZE);
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glEnable(GL_FRAMEBUFFER_SRGB);
+  // Only issued when something changed them since the last frame
+  gl_state_.ResetCounters();
+  gl_state_.Enable(GL_PROGRAM_POINT_SIZE);
+  gl_state_.Enable(GL_DEPTH_TEST);
+  gl_state_.Enable(GL_BLEND);
+  gl_state_.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  gl_state_.Enable(GL_FRAMEBUFFER_SRGB);
 
+  // One draw order for every camera, the depth is measured from their center
+  glm::vec3 view_position(0.0f);
   for (const std::shared_ptr<CameraComponent> &cam : queued_cameras_) {
+    view_position += cam->GetNode()->GetWorldTranslation();
+  }
+  if (!queued_cameras_.empty()) {
+    view_position /= static_cast<float>(queued_cameras_.size());
+  }
+  // Meshes are part of the sort key as well, the levels of detail are picked first
+  SelectLods();
+  // Programs are part of the sort key, materials switch them before the order is built. Loaded
+  // materials had their permutation warmed by the resource pool, this only catches flags changed since.
+  for (const std::shared_ptr<RenderableComponent> &renderable : queued_renderables_) {
+    if (renderable->GetVisible() && renderable->GetMaterial()->UpdatePrograms()) {
+      WarmPipelines(*renderable->GetMaterial());
+    }
+  }
+  render_queue_.Build(queued_renderables_, view_position);
+
+  // Changed material parameters go to their arenas, uploaded in one range per arena
+  for (uint32_t index : render_queue_.GetOrder()) {
+    queued_renderables_[index]->GetMaterial()->UpdateMaterialParams();
+  }
+  MaterialParamArena::FlushAll();
+
+  // The lights do not change within a frame, write them once for every draw.
+  // The instance data of the batches goes to the same ring, bound as vertex attributes.
+  const uint64_t frame_uniform_size =
+      frame_uniform_buffer_->GetAlignedSize(sizeof(LightsUBO)) +
+      queued_cameras_.size() / 2 * frame_uniform_buffer_->GetAlignedSize(sizeof(StereoTransformsUBO)) +
+      render_queue_.GetOrder().size() * queued_cameras_.size() *
+          (frame_uniform_buffer_->GetAlignedSize(sizeof(TransformsUBO)) +
+           frame_uniform_buffer_->GetAlignedSize(sizeof(InstanceData)));
+  num_instanced_batches_ = 0;
+  num_instanced_draws_ = 0;
+  num_triangles_ = 0;
+  num_full_detail_triangles_ = 0;
+  frame_uniform_buffer_->BeginFrame(frame_uniform_size);
+  lights_.clear();
+  for (auto &light : queued_lights_) {
+    Light l(
+      light->GetNode()->GetWorldTranslation(),
+      light->GetLightColor(),
+      light->GetDirection(),
+      light->GetLightType(),
+      light->GetLightStrength());
+    lights_.push_back(l);
+  }
+  LightsUBO lights_ubo(lights_);
+  // Nothing is drawn without them, the ring is larger next frame
+  const bool lights_written = frame_uniform_buffer_->WriteBlock(&lights_ubo, sizeof(lights_ubo), lights_offset_);
+
+  // Objects bound last frame may have been deleted and their names reused since
+  gl_state_.InvalidateBindings();
+
+  const auto &order = render_queue_.GetOrder();
+  for (size_t cam_index = 0; lights_written && cam_index < queued_cameras_.size(); ++cam_index) {
+    const std::shared_ptr<CameraComponent> &cam = queued_cameras_[cam_index];
+    if (cam_index + 1 < queued_cameras_.size() && RenderStereo(cam, queued_cameras_[cam_index + 1])) {
+      ++cam_index;
+      continue;
+    }
+
     current_cam_ = cam;
     if (pre_cam_callback_) {
       pre_cam_callback_(current_cam_);
+      gl_state_.InvalidateBindings();
     }
+    RenderCamera(cam, order, true);
+  }
 
-    // Bind the render target
-    auto render_target = cam->GetRenderTarget();
-    if (!render_target) {
-      continue;
-    }
-    GLuint framebuffer = render_target->GetGLFramebuffer();
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-    auto viewport = current_cam_->GetViewport();
-    glViewport((int)viewport.x, (int)viewport.y, (int)viewport.z, (int)viewport.w);
+  frame_uniform_buffer_->EndFrame();
+  gl_state_.BindVertexArray(0);
+
+  if (post_render_callback_) {
+    post_render_callback_();
+  }
+  ClearQueues();
+}
+
+void Renderer::RenderCamera(std::shared_ptr<CameraComponent> cam, const std::vector<uint32_t> &order, bool clear) {
+  current_cam_ = cam;
+
+  // Bind the render target
+  auto render_target = cam->GetRenderTarget();
+  if (!render_target) {
+    return;
+  }
+  GLuint framebuffer = render_target->GetGLFramebuffer();
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  auto viewport = current_cam_->GetViewport();
+  glViewport((int)viewport.x, (int)viewport.y, (int)viewport.z, (int)viewport.w);
 
+  if (clear) {
     glClearColor(0.0, 0.0, 0.0, 0.0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  }
 
-    // Sort back-to-front to allow for alpha blending
-    const auto camera_position = cam->GetNode()->GetWorldTranslation();
-    std::sort(queued_renderables_.begin(), queued_renderables_.end(),
-              [&camera_position](const std::shared_ptr<RenderableComponent> &renderable1,
-                                 const std::shared_ptr<RenderableComponent> &renderable2) {
-                const auto dist1 = glm::distance(camera_position, renderable1->GetNode()->GetWorldTranslation());
-                const auto dist2 = glm::distance(camera_position, renderable2->GetNode()->GetWorldTranslation());
-                return dist1 > dist2;
-              });
-
-    for (const std::shared_ptr<RenderableComponent> &renderable : queued_renderables_) {
-      if (!renderable->GetVisible()) {
-        continue;
-      }
+  // Invisible renderables are already filtered out by the render queue
+  for (size_t i = 0; i < order.size();) {
+    i += RenderBatch(order, i, false);
+  }
 
-      current_vertex_program_ = renderable->GetMaterial()->GetVertexProgram();
-      current_frag_program_ = renderable->GetMaterial()->GetFragmentProgram();
-      current_geom_program_ = renderable->GetMaterial()->GetGeometryProgram();
+  // Reset the global state to GL_FILL, on platform this is being
+  // changed so it causes imgui to not render properly.
+  gl_state_.PolygonMode(GL_FILL);
 
-      bool bind_gs = true;
-      if (!current_geom_program_) {
-        bind_gs = false;
-      } else if (renderable->options.primitives != current_geom_program_->GetInputPrimitiveType()) {
-        bind_gs = false;
-      }
+  auto blit_target = cam->GetBlitTarget();
+  if (blit_target) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, blit_target->GetGLFramebuffer());
+    glBlitFramebuffer((int)viewport.x, (int)viewport.y, (int)viewport.z, (int)viewport.w, 0, 0,
+                      blit_target->GetWidth(), blit_target->GetHeight(), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+  }
+
+  if (post_cam_callback_) {
+    post_cam_callback_(current_cam_);
+    gl_state_.InvalidateBindings();
+  }
+}
 
-      BindProgram(current_vertex_program_->GetGLProgram(), bind_gs ? current_geom_program_->GetGLProgram() : 0,
-                  current_frag_program_->GetGLProgram());
-      Render(renderable);
+bool Renderer::RenderStereo(std::shared_ptr<CameraComponent> left_cam, std::shared_ptr<CameraComponent> right_cam) {
+  if (stereo_mode_ == StereoMode::None) {
+    return false;
+  }
+  auto left_target = left_cam->GetRenderTarget();
+  auto right_target = right_cam->GetRenderTarget();
+  if (!left_target || !right_target) {
+    return false;
+  }
+  // Both eyes have to be the two layers of the same layered target, drawn with the same viewport
+  auto stereo_target = left_target->GetStereoRenderTarget();
+  if (!stereo_target || stereo_target != right_target->GetStereoRenderTarget() ||
+      left_target->GetColorTextureLayerIndex() != 0 || right_target->GetColorTextureLayerIndex() != 1 ||
+      left_cam->GetViewport() != right_cam->GetViewport()) {
+    return false;
+  }
+
+  if (pre_cam_callback_) {
+    pre_cam_callback_(left_cam);
+    pre_cam_callback_(right_cam);
+    gl_state_.InvalidateBindings();
+  }
+
+  StereoTransformsUBO stereo_transforms_ubo;
+  stereo_transforms_ubo.view_proj[0] = left_cam->GetProjectionMatrix() * left_cam->GetNode()->GetInverseWorldTransform();
+  stereo_transforms_ubo.view_proj[1] =
+      right_cam->GetProjectionMatrix() * right_cam->GetNode()->GetInverseWorldTransform();
+  if (!frame_uniform_buffer_->WriteBlock(&stereo_transforms_ubo, sizeof(stereo_transforms_ubo),
+                                        stereo_transforms_offset_)) {
+    // The callbacks already ran for this pair, the eyes are skipped for the frame
+    return true;
+  }
+  stereo_camera_position_ =
+      (left_cam->GetNode()->GetWorldTranslation() + right_cam->GetNode()->GetWorldTranslation()) * 0.5f;
+
+  current_cam_ = left_cam;
+  glBindFramebuffer(GL_FRAMEBUFFER, stereo_target->GetGLFramebuffer());
+  auto viewport = left_cam->GetViewport();
+  glViewport((int)viewport.x, (int)viewport.y, (int)viewport.z, (int)viewport.w);
+  glClearColor(0.0, 0.0, 0.0, 0.0);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  // Geometry stages and programs without a stereo variant are drawn once per eye afterwards
+  fallback_order_.clear();
+  const auto &order = render_queue_.GetOrder();
+  for (size_t i = 0; i < order.size();) {
+    const size_t count = RenderBatch(order, i, true);
+    if (count == 0) {
+      fallback_order_.push_back(order[i++]);
+    } else {
+      i += count;
     }
+  }
+  gl_state_.PolygonMode(GL_FILL);
 
-    // Reset the global state to GL_FILL, on platform this is being
-    // changed so it causes imgui to not render properly.
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  RenderCamera(left_cam, fallback_order_, false);
+  RenderCamera(right_cam, fallback_order_, false);
+  return true;
+}
+
+size_t Renderer::GetBatchSize(const std::vector<uint32_t> &order, size_t start) const {
+  const std::shared_ptr<RenderableComponent> &first = queued_renderables_[order[start]];
+  auto material = first->GetMaterial();
+  if (!material->IsInstanceable() || material->GetGeometryProgram() ||
+      !material->GetVertexProgram()->GetInstancedVariant() || !material->GetFragmentProgram()->GetInstancedVariant()) {
+    return 1;
+  }
 
-    auto blit_target = cam->GetBlitTarget();
-    if (blit_target) {
-      glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
-      glBindFramebuffer(GL_DRAW_FRAMEBUFFER, blit_target->GetGLFramebuffer());
-      glBlitFramebuffer((int)viewport.x, (int)viewport.y, (int)viewport.z, (int)viewport.w, 0, 0,
-                        blit_target->GetWidth(), blit_target->GetHeight(), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+  size_t count = 1;
+  for (; start + count < order.size(); ++count) {
+    const std::shared_ptr<RenderableComponent> &renderable = queued_renderables_[order[start + count]];
+    auto other = renderable->GetMaterial();
+    if (renderable->GetMesh() != first->GetMesh() || !other->IsInstanceable() || other->GetGeometryProgram() ||
+        other->GetVertexProgram() != material->GetVertexProgram() ||
+        other->GetFragmentProgram() != material->GetFragmentProgram() ||
+        renderable->options.primitives != first->options.primitives ||
+        renderable->options.fillmode != first->options.fillmode ||
+        (first->options.primitives == GL_POINTS && renderable->options.point_size != first->options.point_size)) {
+      break;
     }
+  }
+  return count;
+}
 
-    if (post_cam_callback_) {
-      post_cam_callback_(current_cam_);
+size_t Renderer::RenderBatch(const std::vector<uint32_t> &order, size_t start, bool stereo) {
+  const std::shared_ptr<RenderableComponent> &renderable = queued_renderables_[order[start]];
+  auto material = renderable->GetMaterial();
+  const ShaderKey shader_key = RenderQueue::GetShaderKey(*renderable);
+  const size_t batch_size = GetBatchSize(order, start);
+
+  std::shared_ptr<VertexProgram> vertex_program = material->GetVertexProgram();
+  std::shared_ptr<FragmentProgram> frag_program = material->GetFragmentProgram();
+  std::shared_ptr<GeometryProgram> geom_program = material->GetGeometryProgram();
+  GLuint geom = std::get<1>(shader_key);
+  if (batch_size > 1) {
+    vertex_program = vertex_program->GetInstancedVariant();
+    frag_program = frag_program->GetInstancedVariant();
+  }
+  if (stereo) {
+    vertex_program = geom == 0 ? vertex_program->GetStereoVariant(stereo_mode_) : nullptr;
+    if (!vertex_program) {
+      return 0;
     }
+    geom_program = nullptr;
   }
 
-  if (post_render_callback_) {
-    post_render_callback_();
+  current_vertex_program_ = vertex_program;
+  current_frag_program_ = frag_program;
+  current_geom_program_ = geom_program;
+  BindProgram(vertex_program->GetGLProgram(), geom, frag_program->GetGLProgram());
+
+  if (batch_size == 1) {
+    Render(renderable, stereo, 0, 0);
+    return 1;
   }
-  ClearQueues();
+
+  instance_data_.resize(batch_size);
+  for (size_t i = 0; i < batch_size; ++i) {
+    const std::shared_ptr<RenderableComponent> &instance = queued_renderables_[order[start + i]];
+    instance_data_[i].model = instance->GetNode()->GetWorldTransform();
+    instance->GetMaterial()->GetInstanceColor(instance_data_[i].color, instance_data_[i].color_weight);
+  }
+  uint64_t instance_offset = 0;
+  if (!frame_uniform_buffer_->WriteBlock(instance_data_.data(), batch_size * sizeof(InstanceData), instance_offset)) {
+    return batch_size;
+  }
+  Render(renderable, stereo, batch_size, instance_offset);
+
+  ++num_instanced_batches_;
+  num_instanced_draws_ += batch_size;
+  return batch_size;
 }
 
 void Renderer::ClearQueues() {
@@ -127,115 +427,124 @@ void Renderer::ClearQueues() {
 }
 
 void Renderer::BindProgram(GLuint vert, GLuint geom, GLuint frag) {
-  std::tuple<GLuint, GLuint, GLuint> key = std::make_tuple(vert, geom, frag);
-  auto it = shader_program_cache_.find(key);
-  if (it == shader_program_cache_.end()) {
-    glGenProgramPipelines(1, &program_pipeline_);
-    glUseProgramStages(program_pipeline_, GL_VERTEX_SHADER_BIT, vert);
-    if (geom != 0) {
-      glUseProgramStages(program_pipeline_, GL_GEOMETRY_SHADER_BIT, geom);
-    }
-    glUseProgramStages(program_pipeline_, GL_FRAGMENT_SHADER_BIT, frag);
-    shader_program_cache_[key] = program_pipeline_;
-  } else {
-    program_pipeline_ = it->second;
-  }
-  glBindProgramPipeline(program_pipeline_);
+  program_pipeline_ = pipeline_cache_.GetPipeline(std::make_tuple(vert, geom, frag));
+  gl_state_.BindProgramPipeline(program_pipeline_);
 }
 
-void Renderer::Render(std::shared_ptr<RenderableComponent> renderable) {
-  auto lightsComp = GetCurrentLights();
+void Renderer::Render(std::shared_ptr<RenderableComponent> renderable, bool stereo, uint32_t instance_count,
+                      uint64_t instance_offset) {
   auto cam = GetCurrentCamera();
   auto model = renderable->GetNode()->GetWorldTransform();
-  glm::mat4 view_proj = cam->GetProjectionMatrix() * glm::inverse(cam->GetNode()->GetWorldTransform());
+  glm::mat4 view_proj = cam->GetProjectionMatrix() * cam->GetNode()->GetInverseWorldTransform();
 
   auto mesh = renderable->GetMesh();
   auto material = renderable->GetMaterial();
 
-  // Vertex data
-  const auto& vertex_attr_list = GetCurrentVertexProgram()->GetVertexAttributes();
-  glBindVertexArray(vertex_array_);
+  // Get the camera data, mvp, write it to the frame ring. The draw is skipped when it does not fit.
+  TransformsUBO transforms_ubo(
+    view_proj,
+    model,
+    cam->GetNode()->GetInverseWorldTransform() * model,
+    stereo ? stereo_camera_position_ : cam->GetNode()->GetWorldTranslation());
+  uint64_t transforms_offset = 0;
+  if (!frame_uniform_buffer_->WriteBlock(&transforms_ubo, sizeof(transforms_ubo), transforms_offset)) {
+    return;
+  }
 
-  // Position
+  // Vertex data, the vertex array of the mesh is cached per attribute layout of the program
+  mesh->GetVertexArray(*GetCurrentVertexProgram(), gl_state_);
   auto vertex_buffer = mesh->GetVertexBuffer();
-  BindBuffer(vertex_buffer, VertexAttributeName::kPosition, vertex_attr_list);
-
-  // Normal
-  auto normal_buffer = mesh->GetNormalBuffer();
-  BindBuffer(normal_buffer, VertexAttributeName::kNormal, vertex_attr_list);
-
-  // Texture coordinate
-  auto texture_coords_buffer = mesh->GetTextureCoordinatesBuffer();
-  BindBuffer(texture_coords_buffer, VertexAttributeName::kTextureCoordinates, vertex_attr_list);
-
-  const auto& buffer_list = mesh->GetCustomBuffers();
-  for (const auto& custom_buffer : buffer_list) {
-    auto custom_it = vertex_attr_list.find(custom_buffer->GetName());
-    if (custom_it != vertex_attr_list.end()) {
-      const auto& attr = custom_it->second;
-      glBindBuffer(GL_ARRAY_BUFFER, custom_buffer->GetGLBuffer());
-      glVertexAttribPointer(attr.location, custom_buffer->GetElementCount(), custom_buffer->GetElementType(), GL_FALSE,
-                            custom_buffer->GetVertexSize(), (void *)0);
-      glEnableVertexAttribArray(attr.location);
+
+  // Per instance attributes of a batch, advancing once per eye pair on the instanced stereo path
+  const GLuint eye_count = (stereo && stereo_mode_ == StereoMode::InstancedLayer) ? 2 : 1;
+  if (instance_count > 0) {
+    const auto& vertex_attr_list = GetCurrentVertexProgram()->GetVertexAttributes();
+    glBindBuffer(GL_ARRAY_BUFFER, frame_uniform_buffer_->GetGLBuffer());
+    BindInstanceAttribute(VertexAttributeName::kInstanceColor, 4, instance_offset + offsetof(InstanceData, color),
+                          eye_count, vertex_attr_list);
+    BindInstanceAttribute(VertexAttributeName::kInstanceColorWeight, 1,
+                          instance_offset + offsetof(InstanceData, color_weight), eye_count, vertex_attr_list);
+    // A mat4 attribute takes one location per column
+    auto model_it = vertex_attr_list.find(VertexAttributeName::kInstanceModel);
+    for (uint32_t column = 0; model_it != vertex_attr_list.end() && column < 4; ++column) {
+      const GLint location = model_it->second.location + column;
+      glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                            (void *)(instance_offset + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+      glVertexAttribDivisor(location, eye_count);
+      glEnableVertexAttribArray(location);
+      instance_attribute_locations_.push_back(location);
     }
   }
 
-  // Get the camera data, mvp, update the uniform
-  transform_uniform_buffer_dirty_ = true;
-  TransformsUBO transforms_ubo(
-    view_proj,
-    model,
-    glm::inverse(cam->GetNode()->GetWorldTransform()) * model,
-    cam->GetNode()->GetWorldTranslation());
-  BindTransformUniform(GetCurrentVertexProgram(), transforms_ubo);
-  BindTransformUniform(GetCurrentGeometryProgram(), transforms_ubo);
-  BindTransformUniform(GetCurrentFragmentProgram(), transforms_ubo);
+  BindTransformUniform(GetCurrentVertexProgram(), transforms_offset);
+  BindTransformUniform(GetCurrentGeometryProgram(), transforms_offset);
+  BindTransformUniform(GetCurrentFragmentProgram(), transforms_offset);
 
-  const auto& fragment_ubo_blk_list = GetCurrentFragmentProgram()->GetUniformBlocks();
-  // Light info
-  lights_.clear();
-  for (auto& light : lightsComp) {
-    Light l(
-      light->GetNode()->GetWorldTranslation(),
-      light->GetLightColor(),
-      light->GetDirection(),
-      light->GetLightType(),
-      light->GetLightStrength());
-    lights_.push_back(l);
+  if (stereo) {
+    const auto& stereo_ubo_list = GetCurrentVertexProgram()->GetUniformBlocks();
+    auto stereo_ubo_it = stereo_ubo_list.find(UniformName::kStereoTransforms);
+    if (stereo_ubo_it != stereo_ubo_list.end()) {
+      gl_state_.BindUniformBufferRange(stereo_ubo_it->second.binding, frame_uniform_buffer_->GetGLBuffer(),
+                                       stereo_transforms_offset_, sizeof(StereoTransformsUBO));
+    }
   }
-  LightsUBO lights_ubo(lights_);
+
+  const auto& fragment_ubo_blk_list = GetCurrentFragmentProgram()->GetUniformBlocks();
+  // Light info, written once at the beginning of the frame
   auto fragment_ubo_light_it = fragment_ubo_blk_list.find(UniformName::kLight);
   if (fragment_ubo_light_it != fragment_ubo_blk_list.end()) {
     const auto& des = fragment_ubo_light_it->second;
-    light_uniform_buffer_->UpdateBuffer((char *)&lights_ubo, sizeof(lights_ubo));
-    glBindBufferBase(GL_UNIFORM_BUFFER, des.binding, light_uniform_buffer_->GetGLBuffer());
+    gl_state_.BindUniformBufferRange(des.binding, frame_uniform_buffer_->GetGLBuffer(), lights_offset_,
+                                     sizeof(LightsUBO));
   }
 
-  material->UpdateMaterialUniforms();
+  material->UpdateMaterialUniforms(gl_state_);
+  // Parameters were uploaded at the beginning of the frame, select the slot of the material
   auto fragment_ubo_it = fragment_ubo_blk_list.find(UniformName::kMaterial);
-  if (fragment_ubo_it != fragment_ubo_blk_list.end()) {
+  const auto& param_arena = material->GetParamArena();
+  if (fragment_ubo_it != fragment_ubo_blk_list.end() && param_arena) {
     const auto& des = fragment_ubo_it->second;
-    auto material_uniform_buffer = material->UpdateMaterialUniformBuffer();
-    glBindBufferBase(GL_UNIFORM_BUFFER, des.binding, material_uniform_buffer->GetGLBuffer());
+    gl_state_.BindUniformBufferRange(des.binding, param_arena->GetGLBuffer(),
+                                     param_arena->GetOffset(material->GetParamSlot()), param_arena->GetBlockSize());
   }
 
-  glPolygonMode(GL_FRONT_AND_BACK, renderable->options.fillmode);
+  gl_state_.PolygonMode(renderable->options.fillmode);
 
   if (renderable->options.primitives == GL_POINTS) {
-    glPointSize(renderable->options.point_size);
+    gl_state_.PointSize(renderable->options.point_size);
   }
 
+  // Multiview broadcasts the draw to both views, the instanced stereo path draws one instance per eye
+  const GLsizei draw_instance_count = std::max<GLsizei>(instance_count, 1) * eye_count;
   std::shared_ptr<IndexBuffer> index_buffer = mesh->GetIndexBuffer();
   if (renderable->options.primitives == GL_POINTS || !index_buffer || index_buffer->GetIndexCount() == 0) {
-    glDrawArrays(renderable->options.primitives, 0, vertex_buffer->GetVertexCount());
+    glDrawArraysInstanced(renderable->options.primitives, 0, vertex_buffer->GetVertexCount(), draw_instance_count);
   } else {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer->GetGLBuffer());
-    glDrawElements(renderable->options.primitives, index_buffer->GetIndexCount(), index_buffer->GetIndexType(),
-                   nullptr);
+    glDrawElementsInstanced(renderable->options.primitives, index_buffer->GetIndexCount(),
+                            index_buffer->GetIndexType(), (void *)index_buffer->GetOffset(), draw_instance_count);
   }
+
+  // Counted once per view, both eyes of the stereo pass are drawn by the one call
+  if (renderable->options.primitives == GL_TRIANGLES) {
+    auto get_triangle_count = [](const Mesh &drawn) {
+      std::shared_ptr<IndexBuffer> indices = drawn.GetIndexBuffer();
+      return (indices && indices->GetIndexCount() > 0 ? indices->GetIndexCount()
+                                                       : drawn.GetVertexBuffer()->GetVertexCount()) / 3;
+    };
+    const uint64_t views = static_cast<uint64_t>(std::max<uint32_t>(instance_count, 1)) * (stereo ? 2 : 1);
+    num_triangles_ += get_triangle_count(*mesh) * views;
+    num_full_detail_triangles_ += get_triangle_count(*renderable->GetFullMesh()) * views;
+  }
+
+  // The vertex array is cached with the mesh, do not leave per instance locations behind
+  for (GLint location : instance_attribute_locations_) {
+    glVertexAttribDivisor(location, 0);
+    glDisableVertexAttribArray(location);
+  }
+  instance_attribute_locations_.clear();
 }
 
-void Renderer::BindTransformUniform(std::shared_ptr<Program> program, const TransformsUBO& transforms_ubo) {
+void Renderer::BindTransformUniform(std::shared_ptr<Program> program, uint64_t transforms_offset) {
   if (!program) {
     return;
   }
@@ -244,27 +553,21 @@ void Renderer::BindTransformUniform(std::shared_ptr<Program> program, const Tran
   auto vertex_ubo_it = vertex_ubo_list.find(UniformName::kTransforms);
   if (vertex_ubo_it != vertex_ubo_list.end()) {
     const auto& blk_des = vertex_ubo_it->second;
-    if (transform_uniform_buffer_dirty_) {
-      transform_uniform_buffer_->UpdateBuffer((char *)&transforms_ubo, sizeof(transforms_ubo));
-      transform_uniform_buffer_dirty_ = false;
-    }
-    glBindBufferBase(GL_UNIFORM_BUFFER, blk_des.binding, transform_uniform_buffer_->GetGLBuffer());
+    gl_state_.BindUniformBufferRange(blk_des.binding, frame_uniform_buffer_->GetGLBuffer(), transforms_offset,
+                                     sizeof(TransformsUBO));
   }
 }
 
-void Renderer::BindBuffer(const std::shared_ptr<VertexBuffer>& buffer,
-                                     const std::string& buffer_name,
-                                     const std::unordered_map<std::string, VertexAttributeDescription>& vertex_attr_list) {
-  if (!buffer || buffer->GetVertexCount() == 0) {
-    return;
-  }
-  auto it = vertex_attr_list.find(buffer_name);
+void Renderer::BindInstanceAttribute(const std::string &attribute_name, GLint element_count, uint64_t offset,
+                                     GLuint divisor,
+                                     const std::unordered_map<std::string, VertexAttributeDescription> &vertex_attr_list) {
+  auto it = vertex_attr_list.find(attribute_name);
   if (it != vertex_attr_list.end()) {
-    const auto& attr = it->second;
-    glBindBuffer(GL_ARRAY_BUFFER, buffer->GetGLBuffer());
-    glVertexAttribPointer(attr.location, buffer->GetElementCount(), buffer->GetElementType(), GL_FALSE,
-                          buffer->GetVertexSize(), (void *)0);
-    glEnableVertexAttribArray(attr.location);
+    const GLint location = it->second.location;
+    glVertexAttribPointer(location, element_count, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)offset);
+    glVertexAttribDivisor(location, divisor);
+    glEnableVertexAttribArray(location);
+    instance_attribute_locations_.push_back(location);
   }
 }
 
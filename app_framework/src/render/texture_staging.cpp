@@ -0,0 +1,286 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "texture_staging.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ml {
+namespace app_framework {
+
+// Regions start at multiples of this, more than the alignment of any pixel type
+static const uint64_t kRegionAlignment = 256;
+
+TextureStaging::Image::Image(TextureStaging *staging, const std::vector<TextureLevel> &levels,
+                             GLenum compressed_format)
+    : staging_(staging), levels_(levels), compressed_format_(compressed_format), region_(0), offset_(0) {}
+
+TextureStaging::Image::~Image() {
+  if (region_) {
+    staging_->Release(region_);
+  }
+}
+
+uint64_t TextureStaging::Image::GetSize() const {
+  return levels_.empty() ? 0 : levels_.back().offset + levels_.back().size;
+}
+
+TextureStaging::TextureStaging(uint64_t ring_size)
+    : buffer_(0),
+      ring_size_(ring_size),
+      data_(nullptr),
+      head_(0),
+      next_region_(0),
+      next_ticket_(0),
+      completed_ticket_(0),
+      committed_bytes_(0) {
+  glGenBuffers(1, &buffer_);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer_);
+  if (GLAD_GL_ARB_buffer_storage) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, ring_size_, nullptr, flags);
+    data_ = static_cast<unsigned char *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, ring_size_, flags));
+    ML_LOG_IF(Warning, !data_, "Failed to map the texture staging ring, pixels are staged in client memory");
+  }
+  if (!data_) {
+    // Mapped a slice at a time by the render thread instead
+    glDeleteBuffers(1, &buffer_);
+    glGenBuffers(1, &buffer_);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer_);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, ring_size_, nullptr, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureStaging::~TextureStaging() {
+  for (auto &region : regions_) {
+    if (region.fence) {
+      glDeleteSync(region.fence);
+    }
+  }
+  if (data_) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer_);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+  glDeleteBuffers(1, &buffer_);
+}
+
+std::shared_ptr<TextureStaging::Image> TextureStaging::Stage(std::vector<unsigned char> &&data,
+                                                             const std::vector<TextureLevel> &levels,
+                                                             GLenum compressed_format) {
+  std::shared_ptr<Image> image(new Image(this, levels, compressed_format));
+  // Images taking more than half of the ring would hold up everything else, they go through in slices
+  const uint64_t size = image->GetSize();
+  if (data_ && size <= ring_size_ / 2 && Allocate(size, image->region_, image->offset_)) {
+    memcpy(data_ + image->offset_, data.data(), size);
+    std::vector<unsigned char>().swap(data);
+  } else {
+    image->data_ = std::move(data);
+  }
+  return image;
+}
+
+uint64_t TextureStaging::Upload(const std::shared_ptr<Texture> &texture, const std::shared_ptr<Image> &image) {
+  uploads_.push_back(PendingUpload{texture, image, 0, 0, 0, ++next_ticket_});
+  return next_ticket_;
+}
+
+uint64_t TextureStaging::GetPendingTicket(const std::shared_ptr<Texture> &texture) const {
+  for (const auto &upload : uploads_) {
+    if (upload.texture == texture) {
+      return upload.ticket;
+    }
+  }
+  return 0;
+}
+
+void TextureStaging::Commit(uint64_t budget_bytes) {
+  Retire();
+  if (uploads_.empty()) {
+    return;
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer_);
+  GLuint bound_texture = 0;
+  uint64_t committed = 0;
+  while (!uploads_.empty()) {
+    PendingUpload &upload = uploads_.front();
+    Image &image = *upload.image;
+    const TextureLevel &level = image.levels_[upload.level];
+    // Sliced in rows of blocks, single pixels when uncompressed
+    const int32_t block_height = image.compressed_format_ ? 4 : 1;
+    const int32_t row_count = (level.height + block_height - 1) / block_height;
+    const uint64_t pitch = level.size / row_count;
+    const uint64_t available = budget_bytes > committed ? budget_bytes - committed : 0;
+    if (committed > 0 && available < pitch) {
+      break;
+    }
+    int32_t rows = static_cast<int32_t>(
+        std::min<uint64_t>(std::max<uint64_t>(available / pitch, 1), row_count - upload.next_row));
+    const uint64_t source_offset = level.offset + upload.next_row * pitch;
+
+    uint64_t offset = 0;
+    uint64_t slice_region = 0;
+    const unsigned char *pixels = nullptr;
+    if (image.region_) {
+      offset = image.offset_ + source_offset;
+    } else {
+      // Copied into the ring first, in smaller slices while it is short of space
+      pixels = image.data_.data() + source_offset;
+      int32_t slice_rows = rows;
+      while (!Allocate(slice_rows * pitch, slice_region, offset) && slice_rows > 1) {
+        slice_rows /= 2;
+      }
+      if (slice_region) {
+        rows = slice_rows;
+        if (data_) {
+          memcpy(data_ + offset, pixels, rows * pitch);
+        } else {
+          // The fences guarantee nothing reads the range any more
+          void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, rows * pitch,
+                                          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+          if (mapped) {
+            memcpy(mapped, pixels, rows * pitch);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+          } else {
+            ML_LOG(Error, "Failed to map %" PRIu64 " bytes of the texture staging ring", rows * pitch);
+            Release(slice_region);
+            slice_region = 0;
+          }
+        }
+      }
+      if (slice_region) {
+        pixels = nullptr;
+      }
+    }
+
+    const GLuint texture = upload.texture->GetGLTexture();
+    if (texture != bound_texture) {
+      glBindTexture(GL_TEXTURE_2D, texture);
+      bound_texture = texture;
+    }
+    if (pixels) {
+      // The ring can be held by images queued behind this one, upload from client memory rather than wait
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    const void *source = pixels ? static_cast<const void *>(pixels) : reinterpret_cast<const void *>(offset);
+    const GLint y = upload.next_row * block_height;
+    const GLsizei height = std::min(rows * block_height, level.height - y);
+    if (image.compressed_format_) {
+      glCompressedTexSubImage2D(GL_TEXTURE_2D, upload.level, 0, y, level.width, height, image.compressed_format_,
+                                rows * pitch, source);
+    } else {
+      glTexSubImage2D(GL_TEXTURE_2D, upload.level, 0, y, level.width, height, GL_RGBA, GL_UNSIGNED_BYTE, source);
+    }
+    if (pixels) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer_);
+    }
+    if (slice_region) {
+      SetFence(slice_region, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+      Release(slice_region);
+    }
+    upload.next_row += rows;
+    upload.committed += rows * pitch;
+    committed += rows * pitch;
+
+    if (upload.next_row >= row_count) {
+      upload.next_row = 0;
+      ++upload.level;
+    }
+    if (upload.level == image.levels_.size()) {
+      if (image.region_) {
+        // Released with the image
+        SetFence(image.region_, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+      }
+      completed_ticket_ = upload.ticket;
+      uploads_.pop_front();
+    }
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  committed_bytes_ += committed;
+}
+
+uint64_t TextureStaging::GetQueuedBytes() const {
+  uint64_t size = 0;
+  for (const auto &upload : uploads_) {
+    size += upload.image->GetSize() - upload.committed;
+  }
+  return size;
+}
+
+bool TextureStaging::Allocate(uint64_t size, uint64_t &region, uint64_t &offset) {
+  size = (size + kRegionAlignment - 1) / kRegionAlignment * kRegionAlignment;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (size == 0 || size > ring_size_) {
+    return false;
+  }
+
+  uint64_t begin = 0;
+  if (!regions_.empty()) {
+    const uint64_t tail = regions_.front().begin;
+    if (head_ > tail) {
+      // Free after the head and before the tail, a region never wraps around the end
+      if (head_ + size <= ring_size_) {
+        begin = head_;
+      } else if (size >= tail) {
+        return false;
+      }
+    } else if (head_ + size < tail) {
+      // Strictly less, a head reaching the tail would look like an empty ring
+      begin = head_;
+    } else {
+      return false;
+    }
+  }
+
+  region = ++next_region_;
+  offset = begin;
+  head_ = begin + size;
+  regions_.push_back(Region{region, begin, head_, 0, false});
+  return true;
+}
+
+void TextureStaging::SetFence(uint64_t region, GLsync fence) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &entry : regions_) {
+    if (entry.id == region) {
+      entry.fence = fence;
+      return;
+    }
+  }
+  glDeleteSync(fence);
+}
+
+void TextureStaging::Release(uint64_t region) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &entry : regions_) {
+    if (entry.id == region) {
+      entry.released = true;
+      return;
+    }
+  }
+}
+
+void TextureStaging::Retire() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (!regions_.empty() && regions_.front().released) {
+    Region &region = regions_.front();
+    if (region.fence) {
+      if (glClientWaitSync(region.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        break;
+      }
+      glDeleteSync(region.fence);
+    }
+    regions_.pop_front();
+  }
+}
+}
+}
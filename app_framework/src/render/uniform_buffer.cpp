@@ -0,0 +1,137 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "uniform_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ml {
+namespace app_framework {
+
+static const GLuint64 kFenceTimeoutNs = 1000000000;
+
+const uint32_t UniformBuffer::kRingFrameCount;
+
+UniformBuffer::UniformBuffer(Buffer::Category category)
+    : Buffer(category, GL_UNIFORM_BUFFER),
+      mapped_data_(nullptr),
+      offset_alignment_(0),
+      frame_capacity_(0),
+      frame_offset_(0),
+      frame_end_(0),
+      frame_index_(0),
+      overflow_size_(0) {
+  for (auto &fence : fences_) {
+    fence = 0;
+  }
+  GLint alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  offset_alignment_ = alignment > 0 ? alignment : 256;
+}
+
+UniformBuffer::~UniformBuffer() {
+  for (auto &fence : fences_) {
+    if (fence) {
+      glDeleteSync(fence);
+      fence = 0;
+    }
+  }
+}
+
+void UniformBuffer::BeginFrame(uint64_t frame_size) {
+  // A frame that overflowed gets what it was missing on top of the estimate
+  frame_size = std::max(frame_size, frame_capacity_ + overflow_size_);
+  overflow_size_ = 0;
+  if (frame_size > frame_capacity_) {
+    // Leave some room so the ring is not recreated every time a node is added
+    ResizeRing(GetAlignedSize(frame_size + frame_size / 2));
+  }
+
+  // Wait until the GPU is done with the region written kRingFrameCount frames ago
+  GLsync &fence = fences_[frame_index_];
+  if (fence) {
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, kFenceTimeoutNs);
+    if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+      ML_LOG(Warning, "Uniform ring buffer fence wait did not complete (0x%x)", result);
+    }
+    glDeleteSync(fence);
+    fence = 0;
+  }
+  frame_offset_ = frame_index_ * frame_capacity_;
+  frame_end_ = frame_offset_ + frame_capacity_;
+}
+
+bool UniformBuffer::WriteBlock(const void *data, uint64_t size, uint64_t &offset) {
+  // Blocks already written this frame may be bound by draws in flight, they are never overwritten
+  if (size > frame_end_ - frame_offset_) {
+    ML_LOG_IF(Error, overflow_size_ == 0,
+              "Uniform ring buffer overflow, %llu bytes requested past the frame capacity of %llu",
+              (unsigned long long)size, (unsigned long long)frame_capacity_);
+    overflow_size_ += GetAlignedSize(size);
+    return false;
+  }
+  offset = frame_offset_;
+  frame_offset_ = std::min(offset + GetAlignedSize(size), frame_end_);
+
+  if (mapped_data_) {
+    memcpy(mapped_data_ + offset, data, size);
+  } else {
+    glBindBuffer(GL_UNIFORM_BUFFER, GetGLBuffer());
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+  return true;
+}
+
+void UniformBuffer::EndFrame() {
+  if (mapped_data_) {
+    fences_[frame_index_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  frame_index_ = (frame_index_ + 1) % kRingFrameCount;
+}
+
+void UniformBuffer::ResizeRing(uint64_t frame_capacity) {
+  // The previous storage is released by the driver once the pending draws are done
+  for (auto &fence : fences_) {
+    if (fence) {
+      glDeleteSync(fence);
+      fence = 0;
+    }
+  }
+  if (mapped_data_) {
+    glBindBuffer(GL_UNIFORM_BUFFER, GetGLBuffer());
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    mapped_data_ = nullptr;
+  }
+
+  frame_capacity_ = frame_capacity;
+  const uint64_t size = frame_capacity_ * kRingFrameCount;
+  RecreateGLBuffer(size);
+  glBindBuffer(GL_UNIFORM_BUFFER, GetGLBuffer());
+  if (GLAD_GL_ARB_buffer_storage) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+    mapped_data_ = static_cast<char *>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+    if (!mapped_data_) {
+      ML_LOG(Error, "Failed to map the uniform ring buffer persistently");
+    }
+  }
+  if (!mapped_data_) {
+    // glBufferStorage made the storage immutable, a new name is needed for the fallback
+    if (GLAD_GL_ARB_buffer_storage) {
+      RecreateGLBuffer(size);
+      glBindBuffer(GL_UNIFORM_BUFFER, GetGLBuffer());
+    }
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GetGLBufferCategory());
+  }
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  frame_index_ = 0;
+}
+}
+}
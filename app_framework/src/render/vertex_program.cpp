@@ -7,11 +7,29 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #include "vertex_program.h"
+
+#include <map>
+#include <mutex>
 #include "gl_type_size.h"
 
 namespace ml {
 namespace app_framework {
 
+// Preambles defining STEREO_EYE, the eye index of the vertex, and STEREO_SET_LAYER
+static const char *kInstancedLayerStereoPreamble = R"GLSL(
+  #define STEREO 1
+  #define STEREO_EYE (gl_InstanceID & 1)
+  #define STEREO_SET_LAYER(eye) gl_Layer = (eye)
+)GLSL";
+
+static const char *kMultiviewStereoPreamble = R"GLSL(
+  #extension GL_OVR_multiview : require
+  layout(num_views = 2) in;
+  #define STEREO 1
+  #define STEREO_EYE int(gl_ViewID_OVR)
+  #define STEREO_SET_LAYER(eye)
+)GLSL";
+
 VertexProgram::VertexProgram(const char *code) : Program(code, GL_VERTEX_SHADER) {
   // Parse parameters
   std::vector<GLchar> name_buffer(512);
@@ -32,6 +50,49 @@ VertexProgram::VertexProgram(const char *code) : Program(code, GL_VERTEX_SHADER)
     ML_LOG(Debug, "Found vertex attribute: name(%s), index(%u) size(%" PRIu64 ") type(%x) element_cnt(%u) location(%u)",
            data.name.c_str(), data.index, data.size, data.type, data.element_cnt, data.location);
   }
+
+  // Programs with the same attribute names and locations share the vertex arrays of a mesh
+  std::map<std::string, int32_t> sorted_locations;
+  for (const auto &pair : vertex_attrs_by_name_) {
+    sorted_locations[pair.first] = pair.second.location;
+  }
+  std::string layout;
+  for (const auto &pair : sorted_locations) {
+    layout += pair.first + ":" + std::to_string(pair.second) + ";";
+  }
+  static std::mutex layout_ids_mutex;
+  static std::unordered_map<std::string, uint32_t> layout_ids;
+  std::lock_guard<std::mutex> lock(layout_ids_mutex);
+  auto it = layout_ids.find(layout);
+  if (it == layout_ids.end()) {
+    it = layout_ids.insert(std::make_pair(layout, static_cast<uint32_t>(layout_ids.size()))).first;
+  }
+  attribute_layout_id_ = it->second;
+}
+
+std::shared_ptr<VertexProgram> VertexProgram::GetStereoVariant(StereoMode mode) const {
+  if (mode == StereoMode::None) {
+    return nullptr;
+  }
+
+  std::string preamble;
+  if (mode == StereoMode::Multiview) {
+    preamble = kMultiviewStereoPreamble;
+  } else if (GLAD_GL_ARB_shader_viewport_layer_array) {
+    preamble = std::string("#extension GL_ARB_shader_viewport_layer_array : require") + kInstancedLayerStereoPreamble;
+  } else {
+    preamble = std::string("#extension GL_AMD_vertex_shader_layer : require") + kInstancedLayerStereoPreamble;
+  }
+  auto stereo_variant = GetVariant<VertexProgram>("STEREO", preamble);
+  if (!stereo_variant) {
+    return nullptr;
+  }
+
+  const auto &blocks = stereo_variant->GetUniformBlocks();
+  if (blocks.find(UniformName::kStereoTransforms) == blocks.end()) {
+    return nullptr;
+  }
+  return stereo_variant;
 }
 }
 }
@@ -7,11 +7,16 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #include <app_framework/node.h>
+#include <app_framework/asset_cache.h>
+#include <app_framework/gltf_asset.h>
+#include <app_framework/mesh_optimizer.h>
+#include <app_framework/mesh_simplifier.h>
 #include <app_framework/preset_resource.h>
 #include <app_framework/resource_pool.h>
 #include <app_framework/components/renderable_component.h>
 #include <app_framework/material/pbr_material.h>
 #include <app_framework/material/textured_material.h>
+#include <app_framework/render/compressed_texture_cache.h>
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
@@ -20,128 +25,513 @@
 
 #include <stb_image.h>
 
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
 namespace ml {
 namespace app_framework {
 
+static const uint64_t kTextureStagingSize = 8 * 1024 * 1024;
+
+// Import options recorded in the asset cache files, a file written with others is imported again
+static const uint32_t kAssetOptimizedMeshes = 1 << 0;
+static const uint32_t kAssetGeneratedLods = 1 << 1;
+
+AssetLoad::AssetLoad(const std::string &path)
+    : path_(path), node_(std::make_shared<Node>()), state_(State::Importing) {}
+
 void ResourcePool::InitializePresetResources() {
   PresetResource preset_resource;
   for (const auto &mesh : preset_resource.meshes) {
-    mesh_cache_[std::to_string(mesh->GetRuntimeType())] = mesh;
+    mesh_cache_.Insert(std::to_string(mesh->GetRuntimeType()), mesh, 0, mesh->GetGPUByteSize(), ++tick_, true);
   }
 }
 
-std::shared_ptr<Node> ResourcePool::LoadNodeHierarchy(const std::string &path, const aiScene *ai_scene,
-                                                      const aiNode *ai_node) {
-  ML_LOG(Info, "Loading node %s", ai_node->mName.C_Str());
-  auto node = std::make_shared<Node>();
-  aiVector3D position{};
-  aiQuaternion rotation{};
-  aiVector3D scaling{};
-  ai_node->mTransformation.Decompose(scaling, rotation, position);
-  node->SetLocalTranslation(glm::vec3{position.x, position.y, position.z});
-  node->SetLocalRotation(glm::quat{rotation.w, rotation.x, rotation.y, rotation.z});
-  node->SetLocalScale(glm::vec3{scaling.x, scaling.y, scaling.z});
+// Everything read from the file, filled in on a worker thread without any GL call
+struct ImportedImage {
+  std::string key;
+  GLint gl_internal_format;
+  // Embedded images belong to the asset and are not cached
+  bool embedded;
+  // Index of the embedded image in the scene, written to the asset cache
+  int32_t embedded_index;
+  // Format of the levels, 0 for RGBA8 pixels
+  GLenum compressed_format;
+  std::vector<TextureLevel> levels;
+  // Mip chain still to be compressed on the render thread when there is no cached one, staged otherwise
+  std::vector<unsigned char> data;
+  std::shared_ptr<TextureStaging::Image> staged;
+  bool bake;
+  uint64_t bake_key;
+  // Texture being compressed one level per upload step, with the levels read back so far
+  std::shared_ptr<Texture> baking;
+  CompressedTextureCache::Entry baked;
+};
 
-  for (size_t mesh_index = 0; mesh_index < ai_node->mNumMeshes; ++mesh_index) {
-    auto model = LoadModel(path, ai_scene, ai_node->mMeshes[mesh_index]);
-    auto renderable_pbr = std::make_shared<RenderableComponent>(model.mesh, model.material);
-    renderable_pbr->options.fillmode = GL_FILL;
+struct ImportedTexture {
+  int32_t type;
+  size_t image_index;
+};
 
-    auto model_node = std::make_shared<Node>();
-    model_node->AddComponent(renderable_pbr);
-    node->AddChild(model_node);
+// Simplified triangles indexing the vertices of the mesh
+struct ImportedLod {
+  // Simplified here, left empty when the indices are used in place
+  std::vector<uint32_t> indices;
+  const uint32_t *index_data;
+  uint32_t num_indices;
+  // Relative to the bounding radius of the mesh
+  float error;
+};
+
+struct ImportedMesh {
+  // Read from the scene, left empty when the streams are used in place
+  std::vector<glm::vec3> vertices;
+  std::vector<glm::vec3> normals;
+  std::vector<uint32_t> indices;
+  // Indices narrowed by the optimization when the vertices allow it
+  std::vector<uint16_t> short_indices;
+  std::vector<glm::vec2> tex_coords;
+  std::vector<glm::vec4> tangents;
+
+  // Streams as the buffers take them, in the vectors above or in a mapped file, null when missing
+  uint32_t num_vertices;
+  uint32_t num_indices;
+  GLenum index_type;
+  const glm::vec3 *vertex_data;
+  const glm::vec3 *normal_data;
+  const void *index_data;
+  const glm::vec2 *tex_coord_data;
+  const glm::vec4 *tangent_data;
+
+  std::vector<ImportedTexture> textures;
+  bool valid;
+
+  // Bounding sphere and the levels of detail after the mesh itself, none when they are not generated
+  glm::vec3 center;
+  float radius;
+  std::vector<ImportedLod> lods;
+};
+
+struct ImportedNode {
+  glm::vec3 translation;
+  glm::quat rotation;
+  glm::vec3 scale;
+  std::vector<uint32_t> meshes;
+  std::vector<ImportedNode> children;
+};
+
+struct ResourcePool::AssetImport {
+  std::string path;
+  // Set by the loader threads when the file could not be imported
+  bool failed = false;
+  ImportedNode root;
+  std::vector<ImportedMesh> meshes;
+  std::vector<ImportedImage> images;
+  // Hold the streams of the meshes when they come from the asset cache or a glTF file
+  std::shared_ptr<MappedFile> cache_file;
+  std::shared_ptr<GLTFAsset> gltf_asset;
+
+  // Created on the render thread one upload at a time
+  std::vector<std::shared_ptr<Texture>> textures;
+  std::vector<Model> models;
+  // Last texture upload of the asset
+  uint64_t texture_ticket = 0;
+  // GPU bytes of the meshes and embedded textures
+  uint64_t gpu_bytes = 0;
+};
+
+// Hierarchy of a loaded asset, every load of its path gets a clone of it
+struct ResourcePool::AssetPrototype {
+  ImportedNode root;
+  std::vector<Model> models;
+  // Bytes each clone shares rather than creating them again
+  uint64_t gpu_bytes;
+
+  // Nothing outside of the pool refers to the prototype itself, its clones hold the meshes and materials.
+  // The pool holds each of them twice, here and in the mesh or material cache.
+  bool IsCloned() const {
+    for (const auto &model : models) {
+      if (model.mesh.use_count() > 2 || model.material.use_count() > 2) {
+        return true;
+      }
+    }
+    return false;
   }
+};
 
-  for (size_t child_index = 0; child_index < ai_node->mNumChildren; ++child_index) {
-    node->AddChild(LoadNodeHierarchy(path, ai_scene, ai_node->mChildren[child_index]));
+ResourcePool::ResourcePool()
+    : tick_(0),
+      memory_budget_(0),
+      over_budget_(false),
+      shared_bytes_(0),
+      mesh_optimization_(false),
+      lod_generation_(false),
+      texture_staging_(new TextureStaging(kTextureStagingSize)) {
+  // Evicting a prototype with clones alive would free nothing and import the asset again on the next load
+  prototype_cache_.SetInUse([](const AssetPrototype &prototype) { return prototype.IsCloned(); });
+}
+
+// Averages 2x2 blocks into the next level until 1x1, sRGB pixels are averaged in linear space
+static void GenerateMipChain(std::vector<unsigned char> &&pixels, int32_t width, int32_t height, bool srgb,
+                             std::vector<TextureLevel> &levels, std::vector<unsigned char> &data) {
+  // Built once, loader threads run this concurrently
+  static const std::vector<float> s_to_linear = []() {
+    std::vector<float> table(256);
+    for (int i = 0; i < 256; ++i) {
+      const float value = i / 255.0f;
+      table[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+    return table;
+  }();
+  auto to_byte = [srgb](float value) {
+    if (srgb) {
+      value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+    return static_cast<unsigned char>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+  };
+
+  data = std::move(pixels);
+  levels.assign(1, TextureLevel{width, height, 0, static_cast<uint64_t>(width) * height * 4});
+  while (width > 1 || height > 1) {
+    const TextureLevel source = levels.back();
+    const int32_t level_width = std::max(width / 2, 1);
+    const int32_t level_height = std::max(height / 2, 1);
+    levels.push_back(TextureLevel{level_width, level_height, data.size(),
+                                  static_cast<uint64_t>(level_width) * level_height * 4});
+    data.resize(data.size() + levels.back().size);
+    const unsigned char *src = data.data() + source.offset;
+    unsigned char *dst = data.data() + levels.back().offset;
+    for (int32_t y = 0; y < level_height; ++y) {
+      const int32_t y0 = std::min(y * 2, height - 1);
+      const int32_t y1 = std::min(y * 2 + 1, height - 1);
+      for (int32_t x = 0; x < level_width; ++x) {
+        const int32_t x0 = std::min(x * 2, width - 1);
+        const int32_t x1 = std::min(x * 2 + 1, width - 1);
+        const unsigned char *texels[4] = {src + (y0 * width + x0) * 4, src + (y0 * width + x1) * 4,
+                                          src + (y1 * width + x0) * 4, src + (y1 * width + x1) * 4};
+        for (int32_t channel = 0; channel < 4; ++channel) {
+          // Alpha is linear
+          const bool linear = srgb && channel < 3;
+          float sum = 0.0f;
+          for (const unsigned char *texel : texels) {
+            sum += linear ? s_to_linear[texel[channel]] : texel[channel] / 255.0f;
+          }
+          const float value = sum / 4.0f;
+          dst[(y * level_width + x) * 4 + channel] =
+              linear ? to_byte(value)
+                     : static_cast<unsigned char>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+      }
+    }
+    width = level_width;
+    height = level_height;
   }
+}
 
-  return node;
+// Any thread. Loads the compressed variant of the source from the cache, or decodes it and builds its
+// mip chain. Sources with a width are raw RGBA8 texels, encoded images otherwise.
+static bool PrepareImage(const unsigned char *source, uint64_t size, int32_t raw_width, int32_t raw_height,
+                         ImportedImage &image, TextureStaging &staging) {
+  const auto &compressed_cache = CompressedTextureCache::GetInstance();
+  image.compressed_format = compressed_cache->GetFormat(image.gl_internal_format);
+  image.bake = false;
+  if (image.compressed_format) {
+    image.bake_key = compressed_cache->GetKey(source, size, image.compressed_format);
+    CompressedTextureCache::Entry entry;
+    if (compressed_cache->Load(image.bake_key, entry) && entry.format == image.compressed_format) {
+      image.levels = entry.levels;
+      const uint64_t compressed_size = entry.data.size();
+      image.staged = staging.Stage(std::move(entry.data), image.levels, image.compressed_format);
+      // Against the RGBA8 mip chain, a third more than the top level
+      const uint64_t uncompressed_size = static_cast<uint64_t>(image.levels[0].width) * image.levels[0].height * 4;
+      compressed_cache->AddTexture(true, compressed_size, uncompressed_size + uncompressed_size / 3);
+      return true;
+    }
+  }
+
+  int32_t width = raw_width;
+  int32_t height = raw_height;
+  std::vector<unsigned char> pixels;
+  if (raw_width > 0) {
+    pixels.assign(source, source + size);
+  } else {
+    int32_t channels = 0;
+    unsigned char *buffer = stbi_load_from_memory(source, size, &width, &height, &channels, STBI_rgb_alpha);
+    if (buffer == nullptr) {
+      ML_LOG(Error, "Unable to decode texture %s, %s", image.key.c_str(), stbi_failure_reason());
+      return false;
+    }
+    ML_LOG(Debug, "Number of channels for image %s is %d", image.key.c_str(), channels);
+    pixels.assign(buffer, buffer + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(buffer);
+  }
+  GenerateMipChain(std::move(pixels), width, height, image.gl_internal_format == GL_SRGB8_ALPHA8, image.levels,
+                   image.data);
+  if (image.compressed_format) {
+    // The driver compresses it on the render thread
+    image.bake = true;
+    return true;
+  }
+  image.staged = staging.Stage(std::move(image.data), image.levels);
+  return true;
 }
 
-std::shared_ptr<Node> ResourcePool::LoadAsset(const std::string &path) {
-  Assimp::Importer importer;
-  const aiScene *ai_scene = importer.ReadFile(path.c_str(), aiProcess_Triangulate | aiProcess_GenSmoothNormals |
-                                                                aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices);
-  if (ai_scene == nullptr || ai_scene->mNumMeshes <= 0) {
-    ML_LOG(Error, "Unable to load model for file %s, %s", path.c_str(), importer.GetErrorString());
-    return nullptr;
+static bool DecodeImage(const std::string &path, ImportedImage &image, TextureStaging &staging) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    ML_LOG(Error, "Unable to load texture %s", path.c_str());
+    return false;
   }
+  std::vector<unsigned char> source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  return PrepareImage(source.data(), source.size(), 0, 0, image, staging);
+}
 
-  return LoadNodeHierarchy(path, ai_scene, ai_scene->mRootNode);
+static bool DecodeEmbeddedImage(const aiTexture *ai_tex, ImportedImage &image, TextureStaging &staging) {
+  const unsigned char *source = reinterpret_cast<const unsigned char *>(ai_tex->pcData);
+  if (ai_tex->mHeight != 0) {
+    // Already uncompressed texels
+    return PrepareImage(source, static_cast<uint64_t>(ai_tex->mWidth) * ai_tex->mHeight * 4, ai_tex->mWidth,
+                        ai_tex->mHeight, image, staging);
+  }
+  ML_LOG(Debug, "Compressed texture %u %u, image format %s", ai_tex->mWidth, ai_tex->mHeight, ai_tex->achFormatHint);
+  return PrepareImage(source, ai_tex->mWidth, 0, 0, image, staging);
 }
 
-Model ResourcePool::LoadModel(const std::string &path, const aiScene *ai_scene, size_t mesh_index) {
-  const aiMesh *ai_mesh = ai_scene->mMeshes[mesh_index];
-  ML_LOG(Info, "Loading mesh %s", ai_mesh->mName.C_Str());
+// Has the driver compress the next level of the image, reads it back for the cache. False when the driver
+// does not compress to the format, the level is then left undefined.
+static bool BakeTextureLevel(ImportedImage &image) {
+  const size_t i = image.baked.levels.size();
+  const TextureLevel &level = image.levels[i];
+  glTexImage2D(GL_TEXTURE_2D, i, image.compressed_format, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               image.data.data() + level.offset);
+  GLint compressed = GL_FALSE;
+  GLint size = 0;
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_COMPRESSED, &compressed);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+  // 16 bytes per 4x4 block in all the formats used, anything else is an emulation
+  const uint64_t expected_size = static_cast<uint64_t>((level.width + 3) / 4) * ((level.height + 3) / 4) * 16;
+  if (compressed != GL_TRUE || static_cast<uint64_t>(size) != expected_size) {
+    return false;
+  }
+  CompressedTextureCache::Entry &entry = image.baked;
+  entry.levels.push_back(TextureLevel{level.width, level.height, entry.data.size(), expected_size});
+  entry.data.resize(entry.data.size() + expected_size);
+  glGetCompressedTexImage(GL_TEXTURE_2D, i, entry.data.data() + entry.levels.back().offset);
+  return true;
+}
 
-  Model model;
-  std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(Buffer::Category::Static, GL_UNSIGNED_INT);
-  std::shared_ptr<PBRMaterial> mat = std::make_shared<PBRMaterial>();
+// Left bound, with the sampling state of the mip chain of the image
+static std::shared_ptr<Texture> GenerateTexture(const ImportedImage &image) {
+  const TextureLevel &top = image.levels[0];
+  GLuint gl_texture = 0;
+  glGenTextures(1, &gl_texture);
+  glBindTexture(GL_TEXTURE_2D, gl_texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels.size() - 1);
+  return std::make_shared<Texture>(GL_TEXTURE_2D, gl_texture, top.width, top.height, true);
+}
 
-  const glm::vec3 *vertices = nullptr;
-  const glm::vec3 *normals = nullptr;
-  std::vector<uint32_t> indices;
-  size_t num_vertices = 0;
+// Render thread. A texture still to be baked is compressed one level per call so the upload budget applies to
+// it, nullptr is returned until its last level is done. Otherwise only its storage is allocated and the levels
+// follow through the staging ring.
+std::shared_ptr<Texture> ResourcePool::CreateTexture(ImportedImage &image, uint64_t &gpu_bytes, uint64_t &ticket) {
+  if (image.bake) {
+    if (image.baking) {
+      glBindTexture(GL_TEXTURE_2D, image.baking->GetGLTexture());
+    } else {
+      image.baking = GenerateTexture(image);
+      image.baked.format = image.compressed_format;
+    }
+    const auto &compressed_cache = CompressedTextureCache::GetInstance();
+    // The format may have failed with another texture since the image was imported
+    const bool usable = compressed_cache->GetFormat(image.gl_internal_format) == image.compressed_format;
+    const bool compressed = usable && BakeTextureLevel(image);
+    if (compressed && image.baked.levels.size() < image.levels.size()) {
+      glBindTexture(GL_TEXTURE_2D, 0);
+      return nullptr;
+    }
+    if (compressed) {
+      gpu_bytes = image.baked.data.size();
+      compressed_cache->Store(image.bake_key, image.baked);
+      compressed_cache->AddTexture(false, image.baked.data.size(), image.data.size());
+    } else {
+      if (usable) {
+        compressed_cache->DisableFormat(image.compressed_format);
+      }
+      gpu_bytes = image.data.size();
+      for (size_t i = 0; i < image.levels.size(); ++i) {
+        const TextureLevel &level = image.levels[i];
+        glTexImage2D(GL_TEXTURE_2D, i, image.gl_internal_format, level.width, level.height, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, image.data.data() + level.offset);
+      }
+    }
+    std::shared_ptr<Texture> texture = std::move(image.baking);
+    image.baked = CompressedTextureCache::Entry();
+    std::vector<unsigned char>().swap(image.data);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+  }
 
-  if (ai_mesh->HasPositions()) {
-    vertices = (const glm::vec3 *)ai_mesh->mVertices;
-    num_vertices = ai_mesh->mNumVertices;
-  } else {
+  auto texture = GenerateTexture(image);
+  gpu_bytes = image.staged->GetSize();
+  for (size_t i = 0; i < image.levels.size(); ++i) {
+    const TextureLevel &level = image.levels[i];
+    if (image.compressed_format) {
+      glCompressedTexImage2D(GL_TEXTURE_2D, i, image.compressed_format, level.width, level.height, 0, level.size,
+                             nullptr);
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, i, image.gl_internal_format, level.width, level.height, 0, GL_RGBA,
+                   GL_UNSIGNED_BYTE, nullptr);
+    }
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  ticket = texture_staging_->Upload(texture, image.staged);
+  image.staged.reset();
+  return texture;
+}
+
+// Format the texture type is sampled with, false for the types the PBR material does not use
+static bool GetTextureFormat(int32_t type, GLint &gl_internal_format) {
+  switch (type) {
+    case aiTextureType_DIFFUSE:
+    case aiTextureType_EMISSIVE: gl_internal_format = GL_SRGB8_ALPHA8; return true;
+    case aiTextureType_SPECULAR:
+    case aiTextureType_LIGHTMAP:
+    case aiTextureType_AMBIENT:
+    case aiTextureType_NORMALS:
+    case aiTextureType_HEIGHT:
+    case aiTextureType_SHININESS:
+    case aiTextureType_UNKNOWN: gl_internal_format = GL_RGBA8; return true;
+    default: return false;
+  }
+}
+
+static void SetMaterialTexture(PBRMaterial &mat, int32_t type, const std::shared_ptr<Texture> &tex) {
+  switch (type) {
+    case aiTextureType_DIFFUSE:
+      mat.SetAlbedo(tex);
+      mat.SetHasAlbedo(true);
+      ML_LOG(Debug, "Setting albedo...");
+      break;
+    case aiTextureType_SPECULAR:
+      mat.SetMetallicChannel(0);
+      mat.SetMetallic(tex);
+      mat.SetHasMetallic(true);
+      ML_LOG(Debug, "Setting metallic...");
+      break;
+    case aiTextureType_LIGHTMAP:
+    case aiTextureType_AMBIENT:
+      mat.SetAmbientOcclusion(tex);
+      mat.SetHasAmbientOcclusion(true);
+      ML_LOG(Debug, "Setting ao...");
+      break;
+    case aiTextureType_EMISSIVE:
+      mat.SetEmissive(tex);
+      mat.SetHasEmissive(true);
+      ML_LOG(Debug, "Setting emissive...");
+      break;
+    case aiTextureType_NORMALS:
+    case aiTextureType_HEIGHT:
+      mat.SetNormals(tex);
+      mat.SetHasNormalMap(true);
+      ML_LOG(Debug, "Setting normal map...");
+      break;
+    case aiTextureType_SHININESS:
+      mat.SetRoughnessChannel(0);
+      mat.SetRoughness(tex);
+      mat.SetHasRoughness(true);
+      ML_LOG(Debug, "Setting roughness...");
+      break;
+    case aiTextureType_UNKNOWN:
+      mat.SetMetallicChannel(2);
+      mat.SetRoughnessChannel(1);
+      mat.SetMetallic(tex);
+      mat.SetRoughness(tex);
+      mat.SetHasRoughness(true);
+      mat.SetHasMetallic(true);
+      ML_LOG(Debug, "Setting metallic and roughness...");
+    default: break;
+  }
+}
+
+static void ImportNode(const aiNode *ai_node, ImportedNode &node) {
+  ML_LOG(Info, "Loading node %s", ai_node->mName.C_Str());
+  aiVector3D position{};
+  aiQuaternion rotation{};
+  aiVector3D scaling{};
+  ai_node->mTransformation.Decompose(scaling, rotation, position);
+  node.translation = glm::vec3{position.x, position.y, position.z};
+  node.rotation = glm::quat{rotation.w, rotation.x, rotation.y, rotation.z};
+  node.scale = glm::vec3{scaling.x, scaling.y, scaling.z};
+  node.meshes.assign(ai_node->mMeshes, ai_node->mMeshes + ai_node->mNumMeshes);
+
+  node.children.resize(ai_node->mNumChildren);
+  for (size_t child_index = 0; child_index < ai_node->mNumChildren; ++child_index) {
+    ImportNode(ai_node->mChildren[child_index], node.children[child_index]);
+  }
+}
+
+static void ImportMesh(const std::string &path, const aiScene *ai_scene, const aiMesh *ai_mesh, ImportedMesh &mesh,
+                       std::vector<ImportedImage> &images, TextureStaging &staging) {
+  ML_LOG(Info, "Loading mesh %s", ai_mesh->mName.C_Str());
+  mesh.valid = false;
+  if (!ai_mesh->HasPositions()) {
     ML_LOG(Error, "No vert data");
-    return model;
+    return;
   }
+  const glm::vec3 *vertices = (const glm::vec3 *)ai_mesh->mVertices;
+  mesh.vertices.assign(vertices, vertices + ai_mesh->mNumVertices);
 
   if (ai_mesh->HasNormals()) {
-    mat->SetHasNormals(true);
-    normals = (const glm::vec3 *)ai_mesh->mNormals;
+    const glm::vec3 *normals = (const glm::vec3 *)ai_mesh->mNormals;
+    mesh.normals.assign(normals, normals + ai_mesh->mNumVertices);
   }
 
   if (ai_mesh->HasFaces()) {
-    indices.resize(ai_mesh->mNumFaces * 3);
+    mesh.indices.resize(ai_mesh->mNumFaces * 3);
     int indices_index = 0;
     for (int i = 0; i < ai_mesh->mNumFaces; ++i) {
       const aiFace ai_face = ai_mesh->mFaces[i];
       if (ai_face.mNumIndices != 3) {
         ML_LOG(Error, "Unexpected index cnt %d", ai_face.mNumIndices);
-        return model;
+        return;
       }
-      indices[indices_index++] = ai_face.mIndices[0];
-      indices[indices_index++] = ai_face.mIndices[1];
-      indices[indices_index++] = ai_face.mIndices[2];
+      mesh.indices[indices_index++] = ai_face.mIndices[0];
+      mesh.indices[indices_index++] = ai_face.mIndices[1];
+      mesh.indices[indices_index++] = ai_face.mIndices[2];
     }
   }
+  ML_LOG(Debug, "Inited model vert:%d indices:%u", ai_mesh->mNumVertices, (uint32_t)mesh.indices.size());
 
-  ML_LOG(Debug, "Inited model vert:%d indices:%u", ai_mesh->mNumVertices, (uint32_t)indices.size());
-  mesh->UpdateMesh(vertices, normals, ai_mesh->mNumVertices, indices.data(), indices.size());
   if (ai_mesh->HasTextureCoords(0)) {
-    std::vector<glm::vec2> tex_coords(ai_mesh->mNumVertices);
+    mesh.tex_coords.resize(ai_mesh->mNumVertices);
     for (uint32_t i = 0; i < ai_mesh->mNumVertices; ++i) {
-      tex_coords[i].x = ai_mesh->mTextureCoords[0][i].x;
-      tex_coords[i].y = ai_mesh->mTextureCoords[0][i].y;
+      mesh.tex_coords[i].x = ai_mesh->mTextureCoords[0][i].x;
+      mesh.tex_coords[i].y = ai_mesh->mTextureCoords[0][i].y;
     }
-    mesh->UpdateTexCoordsBuffer((glm::vec2 const *)tex_coords.data());
   }
 
-  mesh_cache_.insert(std::make_pair(path, mesh));
-  model.mesh = mesh;
-
-  // Load material
-  const aiMaterial *ai_mat = ai_scene->mMaterials[ai_mesh->mMaterialIndex];
-
-  for (uint32_t i = 0; i < ai_mat->mNumProperties; ++i) {
-    ML_LOG(Debug, "Property name: %s, sematic %x data size %u", ai_mat->mProperties[i]->mKey.data,
-           ai_mat->mProperties[i]->mSemantic, ai_mat->mProperties[i]->mDataLength);
+  // Tangent frame for normal mapping, the bitangent is rebuilt in the shader from its handedness in w
+  if (!mesh.normals.empty() && ai_mesh->HasTangentsAndBitangents()) {
+    mesh.tangents.resize(ai_mesh->mNumVertices);
+    for (uint32_t i = 0; i < ai_mesh->mNumVertices; ++i) {
+      const glm::vec3 tangent(ai_mesh->mTangents[i].x, ai_mesh->mTangents[i].y, ai_mesh->mTangents[i].z);
+      const glm::vec3 bitangent(ai_mesh->mBitangents[i].x, ai_mesh->mBitangents[i].y, ai_mesh->mBitangents[i].z);
+      const float handedness = glm::dot(glm::cross(mesh.normals[i], tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+      mesh.tangents[i] = glm::vec4(tangent, handedness);
+    }
   }
 
-  aiString name;
-  ai_mat->Get(AI_MATKEY_TEXTURE_DIFFUSE(0), name);
-  ML_LOG(Debug, "property ...%s", name.data);
-
-  // Test textures
+  // Textures, decoded once per asset however many meshes share them
+  const aiMaterial *ai_mat = ai_scene->mMaterials[ai_mesh->mMaterialIndex];
   for (int32_t i = (int32_t)aiTextureType_NONE; i <= aiTextureType_UNKNOWN; ++i) {
+    GLint gl_internal_format = GL_RGBA8;
     uint32_t tex_cnt = ai_mat->GetTextureCount((aiTextureType)i);
-    if (tex_cnt == 0) {
+    if (tex_cnt == 0 || !GetTextureFormat(i, gl_internal_format)) {
       continue;
     }
     ML_LOG(Debug, "Texture cnt %u for %x", tex_cnt, i);
@@ -152,155 +542,1192 @@ Model ResourcePool::LoadModel(const std::string &path, const aiScene *ai_scene,
         ML_LOG(Error, "Failed for for %x.%u", i, j);
         continue;
       }
-      std::shared_ptr<Texture> tex;
-      const aiTexture *ai_tex = nullptr;
-      std::string texture_full_name;
-      bool embedded_texture = false;
-
       ML_LOG(Debug, "Texture name %s for %x.%u", texture_path.data, i, j);
-      if (texture_path.data[0] == '*') {
-        embedded_texture = true;
-        int32_t ai_tex_index = atoi(&texture_path.data[1]);
-        ai_tex = ai_scene->mTextures[ai_tex_index];
+
+      ImportedImage image{};
+      image.embedded = texture_path.data[0] == '*';
+      image.embedded_index = image.embedded ? atoi(&texture_path.data[1]) : -1;
+      if (image.embedded) {
+        image.key = path + texture_path.data;
       } else {
         std::string base_filename = path.substr(path.find_last_of("/\\") + 1);
-        std::string dir_name = path.substr(0, path.find(base_filename));
-        texture_full_name = dir_name;
-        texture_full_name.append((char *)texture_path.data);
-        ML_LOG(Debug, "Loading texture name %s", texture_full_name.c_str());
+        image.key = path.substr(0, path.find(base_filename));
+        image.key.append((char *)texture_path.data);
+      }
+      auto existing = std::find_if(images.begin(), images.end(),
+                                   [&image](const ImportedImage &other) { return other.key == image.key; });
+      if (existing == images.end()) {
+        ML_LOG(Debug, "Loading texture name %s", image.key.c_str());
+        image.gl_internal_format = gl_internal_format;
+        const bool decoded =
+            image.embedded ? DecodeEmbeddedImage(ai_scene->mTextures[image.embedded_index], image, staging)
+                           : DecodeImage(image.key, image, staging);
+        if (!decoded) {
+          continue;
+        }
+        existing = images.insert(images.end(), std::move(image));
+      }
+      mesh.textures.push_back(ImportedTexture{i, static_cast<size_t>(existing - images.begin())});
+    }
+  }
+
+  mesh.num_vertices = ai_mesh->mNumVertices;
+  mesh.num_indices = mesh.indices.size();
+  mesh.index_type = GL_UNSIGNED_INT;
+  mesh.vertex_data = mesh.vertices.data();
+  mesh.normal_data = mesh.normals.empty() ? nullptr : mesh.normals.data();
+  mesh.index_data = mesh.indices.empty() ? nullptr : mesh.indices.data();
+  mesh.tex_coord_data = mesh.tex_coords.empty() ? nullptr : mesh.tex_coords.data();
+  mesh.tangent_data = mesh.tangents.empty() ? nullptr : mesh.tangents.data();
+  mesh.valid = true;
+}
+
+// Component of an accessor element as a float, normalized integers map to [0, 1] or [-1, 1]
+static float ReadComponent(const unsigned char *data, GLenum type, bool normalized) {
+  switch (type) {
+    case GL_FLOAT: {
+      float value;
+      memcpy(&value, data, sizeof(value));
+      return value;
+    }
+    case GL_UNSIGNED_BYTE: return normalized ? data[0] / 255.0f : data[0];
+    case GL_UNSIGNED_SHORT: {
+      uint16_t value;
+      memcpy(&value, data, sizeof(value));
+      return normalized ? value / 65535.0f : value;
+    }
+    case GL_BYTE: {
+      const int8_t value = static_cast<int8_t>(data[0]);
+      return normalized ? std::max(value / 127.0f, -1.0f) : value;
+    }
+    case GL_SHORT: {
+      int16_t value;
+      memcpy(&value, data, sizeof(value));
+      return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+    }
+    default: return 0.0f;
+  }
+}
+
+// Float attribute stream, pointing into the asset when it is stored the way the buffer takes it and
+// converted into storage otherwise. Null when the accessor is missing or does not match the vertices.
+template <typename T>
+static const T *GetAttributeStream(const GLTFAsset &asset, int32_t index, uint32_t num_vertices,
+                                   std::vector<T> &storage) {
+  GLTFAsset::Accessor accessor;
+  const uint32_t component_count = sizeof(T) / sizeof(float);
+  if (!asset.GetAccessor(index, accessor) || accessor.count != num_vertices ||
+      accessor.component_count != component_count) {
+    return nullptr;
+  }
+  if (accessor.component_type == GL_FLOAT && accessor.stride == sizeof(T) &&
+      reinterpret_cast<uintptr_t>(accessor.data) % alignof(float) == 0) {
+    return reinterpret_cast<const T *>(accessor.data);
+  }
+  // Interleaved or quantized
+  const uint64_t component_size = GetGLTypeSize(accessor.component_type);
+  storage.resize(num_vertices);
+  for (uint32_t i = 0; i < num_vertices; ++i) {
+    float *element = reinterpret_cast<float *>(&storage[i]);
+    for (uint32_t c = 0; c < component_count; ++c) {
+      element[c] = ReadComponent(accessor.data + static_cast<uint64_t>(i) * accessor.stride + c * component_size,
+                                 accessor.component_type, accessor.normalized);
+    }
+  }
+  return storage.data();
+}
+
+static uint32_t ReadIndex(const void *data, GLenum type, uint32_t i) {
+  switch (type) {
+    case GL_UNSIGNED_BYTE: return static_cast<const uint8_t *>(data)[i];
+    case GL_UNSIGNED_SHORT: {
+      uint16_t index;
+      memcpy(&index, static_cast<const uint16_t *>(data) + i, sizeof(index));
+      return index;
+    }
+    default: {
+      uint32_t index;
+      memcpy(&index, static_cast<const uint32_t *>(data) + i, sizeof(index));
+      return index;
+    }
+  }
+}
+
+static uint32_t GetIndex(const ImportedMesh &mesh, uint32_t i) {
+  return mesh.index_data ? ReadIndex(mesh.index_data, mesh.index_type, i) : i;
+}
+
+// Area weighted normals shared by the triangles of each vertex, where the file has none
+static void GenerateNormals(ImportedMesh &mesh) {
+  mesh.normals.assign(mesh.num_vertices, glm::vec3(0.0f));
+  const uint32_t count = mesh.index_data ? mesh.num_indices : mesh.num_vertices;
+  for (uint32_t i = 0; i + 2 < count; i += 3) {
+    const uint32_t a = GetIndex(mesh, i);
+    const uint32_t b = GetIndex(mesh, i + 1);
+    const uint32_t c = GetIndex(mesh, i + 2);
+    if (a >= mesh.num_vertices || b >= mesh.num_vertices || c >= mesh.num_vertices) {
+      continue;
+    }
+    const glm::vec3 normal =
+        glm::cross(mesh.vertex_data[b] - mesh.vertex_data[a], mesh.vertex_data[c] - mesh.vertex_data[a]);
+    mesh.normals[a] += normal;
+    mesh.normals[b] += normal;
+    mesh.normals[c] += normal;
+  }
+  for (auto &normal : mesh.normals) {
+    const float length = glm::length(normal);
+    normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+  }
+  mesh.normal_data = mesh.normals.data();
+}
+
+// False for what the fast path does not handle, the asset then goes through Assimp
+static bool ImportGLTFPrimitive(const std::string &path, const GLTFAsset &asset, const GLTFAsset::Primitive &primitive,
+                                ImportedMesh &mesh, std::vector<ImportedImage> &images, TextureStaging &staging) {
+  GLTFAsset::Accessor positions;
+  if (primitive.mode != GL_TRIANGLES || !asset.GetAccessor(primitive.position, positions)) {
+    return false;
+  }
+  mesh.num_vertices = positions.count;
+  mesh.vertex_data = GetAttributeStream(asset, primitive.position, mesh.num_vertices, mesh.vertices);
+  if (!mesh.vertex_data) {
+    return false;
+  }
+
+  mesh.num_indices = 0;
+  mesh.index_type = GL_UNSIGNED_INT;
+  mesh.index_data = nullptr;
+  if (primitive.indices >= 0) {
+    GLTFAsset::Accessor indices;
+    if (!asset.GetAccessor(primitive.indices, indices) || indices.component_count != 1 ||
+        (indices.component_type != GL_UNSIGNED_BYTE && indices.component_type != GL_UNSIGNED_SHORT &&
+         indices.component_type != GL_UNSIGNED_INT)) {
+      return false;
+    }
+    mesh.num_indices = indices.count;
+    mesh.index_type = indices.component_type;
+    mesh.index_data = indices.data;
+    if (indices.stride != GetGLTypeSize(indices.component_type)) {
+      // Strided, widened on the way
+      mesh.indices.resize(indices.count);
+      for (uint32_t i = 0; i < indices.count; ++i) {
+        mesh.indices[i] =
+            ReadIndex(indices.data + static_cast<uint64_t>(i) * indices.stride, indices.component_type, 0);
+      }
+      mesh.index_type = GL_UNSIGNED_INT;
+      mesh.index_data = mesh.indices.data();
+    }
+  }
+
+  mesh.normal_data =
+      primitive.normal >= 0 ? GetAttributeStream(asset, primitive.normal, mesh.num_vertices, mesh.normals) : nullptr;
+  if (!mesh.normal_data) {
+    GenerateNormals(mesh);
+  }
+  mesh.tex_coord_data = primitive.tex_coord >= 0
+                            ? GetAttributeStream(asset, primitive.tex_coord, mesh.num_vertices, mesh.tex_coords)
+                            : nullptr;
+  mesh.tangent_data = primitive.tangent >= 0
+                          ? GetAttributeStream(asset, primitive.tangent, mesh.num_vertices, mesh.tangents)
+                          : nullptr;
+
+  // Texture slots under the types Assimp reports them with, the material reads them the same way
+  if (primitive.material >= 0) {
+    const GLTFAsset::Material &material = asset.GetMaterials()[primitive.material];
+    const std::pair<int32_t, int32_t> slots[] = {{aiTextureType_DIFFUSE, material.base_color},
+                                                 {aiTextureType_UNKNOWN, material.metallic_roughness},
+                                                 {aiTextureType_NORMALS, material.normal},
+                                                 {aiTextureType_LIGHTMAP, material.occlusion},
+                                                 {aiTextureType_EMISSIVE, material.emissive}};
+    for (const auto &slot : slots) {
+      if (slot.second < 0) {
+        continue;
+      }
+      const GLTFAsset::Image &source = asset.GetImages()[slot.second];
+      ImportedImage image{};
+      image.embedded = source.path.empty();
+      image.embedded_index = -1;
+      image.key = image.embedded ? path + "*" + std::to_string(slot.second) : source.path;
+      auto existing = std::find_if(images.begin(), images.end(),
+                                   [&image](const ImportedImage &other) { return other.key == image.key; });
+      if (existing == images.end()) {
+        GetTextureFormat(slot.first, image.gl_internal_format);
+        const bool decoded = image.embedded
+                                 ? source.data && PrepareImage(source.data, source.size, 0, 0, image, staging)
+                                 : DecodeImage(image.key, image, staging);
+        if (!decoded) {
+          continue;
+        }
+        existing = images.insert(images.end(), std::move(image));
+      }
+      mesh.textures.push_back(ImportedTexture{slot.first, static_cast<size_t>(existing - images.begin())});
+    }
+  }
+  mesh.valid = true;
+  return true;
+}
+
+static void ImportGLTFNode(const GLTFAsset &asset, int32_t index,
+                           const std::vector<std::vector<uint32_t>> &mesh_primitives, ImportedNode &node) {
+  const GLTFAsset::Node &gltf_node = asset.GetNodes()[index];
+  node.translation = gltf_node.translation;
+  node.rotation = gltf_node.rotation;
+  node.scale = gltf_node.scale;
+  if (gltf_node.mesh >= 0) {
+    node.meshes = mesh_primitives[gltf_node.mesh];
+  }
+  node.children.resize(gltf_node.children.size());
+  for (size_t i = 0; i < gltf_node.children.size(); ++i) {
+    ImportGLTFNode(asset, gltf_node.children[i], mesh_primitives, node.children[i]);
+  }
+}
+
+// Any thread. Every primitive becomes a mesh, its streams used in place where the layout allows.
+static bool ImportGLTF(const std::string &path, const GLTFAsset &asset, ImportedNode &root,
+                       std::vector<ImportedMesh> &meshes, std::vector<ImportedImage> &images,
+                       TextureStaging &staging) {
+  std::vector<std::vector<uint32_t>> mesh_primitives;
+  for (const auto &primitives : asset.GetMeshes()) {
+    mesh_primitives.emplace_back();
+    for (const auto &primitive : primitives) {
+      mesh_primitives.back().push_back(meshes.size());
+      meshes.emplace_back();
+      if (!ImportGLTFPrimitive(path, asset, primitive, meshes.back(), images, staging)) {
+        return false;
+      }
+    }
+  }
+  if (meshes.empty()) {
+    return false;
+  }
+
+  root.translation = glm::vec3(0.0f);
+  root.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+  root.scale = glm::vec3(1.0f);
+  root.children.resize(asset.GetSceneNodes().size());
+  for (size_t i = 0; i < asset.GetSceneNodes().size(); ++i) {
+    ImportGLTFNode(asset, asset.GetSceneNodes()[i], mesh_primitives, root.children[i]);
+  }
+  return true;
+}
+
+// Stream gathered in the new order of the vertices, into the storage of the mesh
+template <typename T>
+static void RemapStream(const std::vector<uint32_t> &remap, uint32_t num_vertices, const T *&data,
+                        std::vector<T> &storage) {
+  if (!data) {
+    return;
+  }
+  std::vector<T> remapped(num_vertices);
+  for (size_t v = 0; v < remap.size(); ++v) {
+    if (remap[v] < num_vertices) {
+      remapped[remap[v]] = data[v];
+    }
+  }
+  storage.swap(remapped);
+  data = storage.data();
+}
+
+// Orders the triangles of an indexed mesh for the vertex cache then for overdraw, and its vertices in
+// the order they are fetched. Vertices no triangle uses are dropped, the indices are 16 bit when they fit.
+static bool OptimizeMesh(ImportedMesh &mesh, VertexCacheStats &before, VertexCacheStats &after) {
+  if (!mesh.valid || !mesh.index_data || mesh.num_indices < 3 || mesh.num_indices % 3 != 0) {
+    return false;
+  }
+  std::vector<uint32_t> indices(mesh.num_indices);
+  for (uint32_t i = 0; i < mesh.num_indices; ++i) {
+    indices[i] = ReadIndex(mesh.index_data, mesh.index_type, i);
+    if (indices[i] >= mesh.num_vertices) {
+      return false;
+    }
+  }
+  before = AnalyzeVertexCache(indices, mesh.num_vertices);
+
+  std::vector<uint32_t> optimized;
+  std::vector<uint32_t> clusters;
+  OptimizeVertexCache(indices, mesh.num_vertices, kVertexCacheSize, optimized, clusters);
+  OptimizeOverdraw(mesh.vertex_data, clusters, optimized);
+  std::vector<uint32_t> remap;
+  const uint32_t num_vertices = OptimizeVertexFetch(optimized, mesh.num_vertices, remap);
+  RemapStream(remap, num_vertices, mesh.vertex_data, mesh.vertices);
+  RemapStream(remap, num_vertices, mesh.normal_data, mesh.normals);
+  RemapStream(remap, num_vertices, mesh.tex_coord_data, mesh.tex_coords);
+  RemapStream(remap, num_vertices, mesh.tangent_data, mesh.tangents);
+  mesh.num_vertices = num_vertices;
+  after = AnalyzeVertexCache(optimized, num_vertices);
+
+  if (num_vertices <= 0x10000) {
+    mesh.short_indices.assign(optimized.begin(), optimized.end());
+    std::vector<uint32_t>().swap(mesh.indices);
+    mesh.index_type = GL_UNSIGNED_SHORT;
+    mesh.index_data = mesh.short_indices.data();
+  } else {
+    mesh.indices.swap(optimized);
+    mesh.index_type = GL_UNSIGNED_INT;
+    mesh.index_data = mesh.indices.data();
+  }
+  return true;
+}
+
+// Any thread, the vertex cache figures of the whole asset go to the load log
+static void OptimizeMeshes(const std::string &path, std::vector<ImportedMesh> &meshes) {
+  const auto start = std::chrono::steady_clock::now();
+  VertexCacheStats total_before{0, 0, 0};
+  VertexCacheStats total_after{0, 0, 0};
+  uint32_t num_optimized = 0;
+  uint32_t num_short = 0;
+  for (size_t mesh_index = 0; mesh_index < meshes.size(); ++mesh_index) {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    if (!OptimizeMesh(meshes[mesh_index], before, after)) {
+      continue;
+    }
+    ML_LOG(Debug, "Mesh %zu of %s ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", mesh_index, path.c_str(),
+           before.GetACMR(), after.GetACMR(), before.GetATVR(), after.GetATVR());
+    total_before.transformed += before.transformed;
+    total_before.num_triangles += before.num_triangles;
+    total_before.num_vertices += before.num_vertices;
+    total_after.transformed += after.transformed;
+    total_after.num_triangles += after.num_triangles;
+    total_after.num_vertices += after.num_vertices;
+    ++num_optimized;
+    num_short += meshes[mesh_index].index_type == GL_UNSIGNED_SHORT;
+  }
+  if (num_optimized == 0) {
+    return;
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  ML_LOG(Info, "Optimized %u meshes of %s in %.2f ms, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u with 16 bit indices",
+         num_optimized, path.c_str(), elapsed.count() * 1000.0, total_before.GetACMR(), total_after.GetACMR(),
+         total_before.GetATVR(), total_after.GetATVR(), num_short);
+}
+
+// Error each level of detail may reach, relative to the bounding radius of the mesh
+static const float kLodErrors[] = {0.01f, 0.03f, 0.08f};
+// Levels removing less than this fraction of the triangles of the previous one end the chain
+static const float kMinLodReduction = 0.25f;
+
+// Any thread. Each level is simplified from the previous one to half its triangles, within its error.
+static void GenerateLods(const std::string &path, std::vector<ImportedMesh> &meshes, bool optimize) {
+  const auto start = std::chrono::steady_clock::now();
+  uint64_t num_triangles = 0;
+  uint64_t num_lod_triangles = 0;
+  uint32_t num_lods = 0;
+  for (auto &mesh : meshes) {
+    mesh.lods.clear();
+    if (!mesh.valid || !mesh.index_data || mesh.num_indices < 3) {
+      continue;
+    }
+    std::vector<uint32_t> indices(mesh.num_indices);
+    for (uint32_t i = 0; i < mesh.num_indices; ++i) {
+      indices[i] = ReadIndex(mesh.index_data, mesh.index_type, i);
+      if (indices[i] >= mesh.num_vertices) {
+        indices.clear();
+        break;
+      }
+    }
+    if (indices.empty()) {
+      continue;
+    }
+
+    glm::vec3 min = mesh.vertex_data[0];
+    glm::vec3 max = mesh.vertex_data[0];
+    for (uint32_t v = 1; v < mesh.num_vertices; ++v) {
+      min = glm::min(min, mesh.vertex_data[v]);
+      max = glm::max(max, mesh.vertex_data[v]);
+    }
+    mesh.center = (min + max) * 0.5f;
+    mesh.radius = 0.0f;
+    for (uint32_t v = 0; v < mesh.num_vertices; ++v) {
+      mesh.radius = std::max(mesh.radius, glm::length(mesh.vertex_data[v] - mesh.center));
+    }
+    if (mesh.radius <= 0.0f) {
+      continue;
+    }
+
+    num_triangles += indices.size() / 3;
+    float error = 0.0f;
+    for (float target_error : kLodErrors) {
+      std::vector<uint32_t> simplified;
+      error += SimplifyMesh(mesh.vertex_data, mesh.num_vertices, indices, indices.size() / 6 * 3,
+                            (target_error - error) * mesh.radius, simplified) /
+               mesh.radius;
+      if (simplified.size() < 3 || simplified.size() > indices.size() * (1.0f - kMinLodReduction)) {
+        break;
+      }
+      indices.swap(simplified);
+      ImportedLod lod;
+      if (optimize) {
+        std::vector<uint32_t> clusters;
+        OptimizeVertexCache(indices, mesh.num_vertices, kVertexCacheSize, lod.indices, clusters);
+      } else {
+        lod.indices = indices;
+      }
+      lod.index_data = lod.indices.data();
+      lod.num_indices = lod.indices.size();
+      lod.error = error;
+      mesh.lods.push_back(std::move(lod));
+      num_lod_triangles += indices.size() / 3;
+      ++num_lods;
+    }
+  }
+  if (num_lods == 0) {
+    return;
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  ML_LOG(Info, "Generated %u levels of detail for %s in %.2f ms, %" PRIu64 " triangles in them for %" PRIu64
+               " at full detail",
+         num_lods, path.c_str(), elapsed.count() * 1000.0, num_lod_triangles, num_triangles);
+}
+
+// Indices narrowed to the type of the index buffer they go to
+static void PackIndices(const uint32_t *indices, uint32_t num_indices, GLenum type,
+                        std::vector<unsigned char> &packed) {
+  const uint64_t size = GetGLTypeSize(type);
+  packed.resize(num_indices * size);
+  for (uint32_t i = 0; i < num_indices; ++i) {
+    if (type == GL_UNSIGNED_BYTE) {
+      packed[i] = static_cast<uint8_t>(indices[i]);
+    } else if (type == GL_UNSIGNED_SHORT) {
+      const uint16_t index = static_cast<uint16_t>(indices[i]);
+      memcpy(&packed[i * size], &index, size);
+    } else {
+      memcpy(&packed[i * size], &indices[i], size);
+    }
+  }
+}
+
+// The asset cache payload holds the tables of the meshes, images and nodes followed by the streams
+// of the meshes and the embedded images. Streams are 16 byte aligned, referred to by their offset
+// from the start of the streams.
+static const uint64_t kNoStream = ~0ull;
+static const uint64_t kStreamAlignment = 16;
+
+template <typename T>
+static void WriteValue(std::vector<unsigned char> &out, const T &value) {
+  const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static void WriteString(std::vector<unsigned char> &out, const std::string &value) {
+  WriteValue(out, static_cast<uint32_t>(value.size()));
+  out.insert(out.end(), value.begin(), value.end());
+}
+
+static uint64_t WriteStream(std::vector<unsigned char> &streams, const void *data, uint64_t size) {
+  if (data == nullptr) {
+    return kNoStream;
+  }
+  const uint64_t offset = (streams.size() + kStreamAlignment - 1) / kStreamAlignment * kStreamAlignment;
+  streams.resize(offset + size);
+  memcpy(streams.data() + offset, data, size);
+  return offset;
+}
+
+static void WriteNode(std::vector<unsigned char> &out, const ImportedNode &node) {
+  WriteValue(out, node.translation);
+  WriteValue(out, node.rotation);
+  WriteValue(out, node.scale);
+  WriteValue(out, static_cast<uint32_t>(node.meshes.size()));
+  for (uint32_t mesh_index : node.meshes) {
+    WriteValue(out, mesh_index);
+  }
+  WriteValue(out, static_cast<uint32_t>(node.children.size()));
+  for (const auto &child : node.children) {
+    WriteNode(out, child);
+  }
+}
+
+static void WriteAsset(const aiScene *ai_scene, const ImportedNode &root, const std::vector<ImportedMesh> &meshes,
+                       const std::vector<ImportedImage> &images, std::vector<unsigned char> &payload) {
+  std::vector<unsigned char> tables;
+  std::vector<unsigned char> streams;
+  WriteValue(tables, static_cast<uint32_t>(meshes.size()));
+  for (const auto &mesh : meshes) {
+    WriteValue(tables, static_cast<uint32_t>(mesh.valid));
+    if (!mesh.valid) {
+      continue;
+    }
+    WriteValue(tables, mesh.num_vertices);
+    WriteValue(tables, mesh.num_indices);
+    WriteValue(tables, mesh.index_type);
+    WriteValue(tables, WriteStream(streams, mesh.vertex_data, mesh.num_vertices * sizeof(glm::vec3)));
+    WriteValue(tables, WriteStream(streams, mesh.normal_data, mesh.num_vertices * sizeof(glm::vec3)));
+    WriteValue(tables, WriteStream(streams, mesh.index_data, mesh.num_indices * GetGLTypeSize(mesh.index_type)));
+    WriteValue(tables, WriteStream(streams, mesh.tex_coord_data, mesh.num_vertices * sizeof(glm::vec2)));
+    WriteValue(tables, WriteStream(streams, mesh.tangent_data, mesh.num_vertices * sizeof(glm::vec4)));
+    WriteValue(tables, static_cast<uint32_t>(mesh.textures.size()));
+    for (const auto &texture : mesh.textures) {
+      WriteValue(tables, texture.type);
+      WriteValue(tables, static_cast<uint32_t>(texture.image_index));
+    }
+    WriteValue(tables, static_cast<uint32_t>(mesh.lods.size()));
+    if (mesh.lods.empty()) {
+      continue;
+    }
+    WriteValue(tables, mesh.center);
+    WriteValue(tables, mesh.radius);
+    for (const auto &lod : mesh.lods) {
+      WriteValue(tables, lod.error);
+      WriteValue(tables, lod.num_indices);
+      WriteValue(tables, WriteStream(streams, lod.index_data, lod.num_indices * sizeof(uint32_t)));
+    }
+  }
+
+  WriteValue(tables, static_cast<uint32_t>(images.size()));
+  for (const auto &image : images) {
+    WriteString(tables, image.key);
+    WriteValue(tables, image.gl_internal_format);
+    WriteValue(tables, static_cast<uint32_t>(image.embedded));
+    if (!image.embedded) {
+      continue;
+    }
+    // Kept as found in the file, decoded again on load
+    const aiTexture *ai_tex = ai_scene->mTextures[image.embedded_index];
+    const int32_t raw_width = ai_tex->mHeight != 0 ? ai_tex->mWidth : 0;
+    const uint64_t size = ai_tex->mHeight != 0 ? static_cast<uint64_t>(ai_tex->mWidth) * ai_tex->mHeight * 4
+                                               : ai_tex->mWidth;
+    WriteValue(tables, raw_width);
+    WriteValue(tables, static_cast<int32_t>(ai_tex->mHeight));
+    WriteValue(tables, size);
+    WriteValue(tables, WriteStream(streams, ai_tex->pcData, size));
+  }
+  WriteNode(tables, root);
+
+  payload.clear();
+  WriteValue(payload, static_cast<uint64_t>(tables.size()));
+  payload.insert(payload.end(), tables.begin(), tables.end());
+  payload.resize((payload.size() + kStreamAlignment - 1) / kStreamAlignment * kStreamAlignment);
+  payload.insert(payload.end(), streams.begin(), streams.end());
+}
+
+// Reads fail once past the end of the tables, the caller checks IsValid at the end
+class AssetReader {
+public:
+  AssetReader(const unsigned char *data, uint64_t size)
+      : data_(data), size_(size), position_(0), streams_(nullptr), streams_size_(0), valid_(true) {
+    const uint64_t tables_size = Read<uint64_t>();
+    const uint64_t streams_offset = (sizeof(uint64_t) + tables_size + kStreamAlignment - 1) / kStreamAlignment *
+                                    kStreamAlignment;
+    if (valid_ && tables_size <= size_ - position_ && streams_offset <= size_) {
+      streams_ = data_ + streams_offset;
+      streams_size_ = size_ - streams_offset;
+      size_ = position_ + tables_size;
+    } else {
+      valid_ = false;
+    }
+  }
+
+  template <typename T>
+  T Read() {
+    T value{};
+    if (!Has(sizeof(T))) {
+      return value;
+    }
+    memcpy(&value, data_ + position_, sizeof(T));
+    position_ += sizeof(T);
+    return value;
+  }
+
+  std::string ReadString() {
+    const uint32_t size = Read<uint32_t>();
+    if (!Has(size)) {
+      return std::string();
+    }
+    std::string value(reinterpret_cast<const char *>(data_) + position_, size);
+    position_ += size;
+    return value;
+  }
+
+  // Points into the mapped file, null for a missing stream
+  template <typename T>
+  const T *ReadStream(uint64_t count) {
+    const uint64_t offset = Read<uint64_t>();
+    if (offset == kNoStream) {
+      return nullptr;
+    }
+    valid_ = valid_ && offset <= streams_size_ && count * sizeof(T) <= streams_size_ - offset;
+    return valid_ ? reinterpret_cast<const T *>(streams_ + offset) : nullptr;
+  }
+
+  // Counts are checked against the remaining bytes before anything is added
+  bool Has(uint64_t size) {
+    valid_ = valid_ && size <= size_ - position_;
+    return valid_;
+  }
+
+  bool IsValid() const {
+    return valid_ && position_ == size_;
+  }
+
+private:
+  const unsigned char *data_;
+  uint64_t size_;
+  uint64_t position_;
+  const unsigned char *streams_;
+  uint64_t streams_size_;
+  bool valid_;
+};
+
+static void ReadNode(AssetReader &reader, ImportedNode &node) {
+  node.translation = reader.Read<glm::vec3>();
+  node.rotation = reader.Read<glm::quat>();
+  node.scale = reader.Read<glm::vec3>();
+  const uint32_t mesh_count = reader.Read<uint32_t>();
+  for (uint32_t i = 0; i < mesh_count && reader.Has(1); ++i) {
+    node.meshes.push_back(reader.Read<uint32_t>());
+  }
+  const uint32_t child_count = reader.Read<uint32_t>();
+  for (uint32_t i = 0; i < child_count && reader.Has(1); ++i) {
+    node.children.emplace_back();
+    ReadNode(reader, node.children.back());
+  }
+}
+
+// Any thread. The streams of the meshes point into the mapped file of the entry, the images are
+// decoded again. False when the file is corrupted or one of the images is gone.
+static bool ReadAsset(const AssetCache::Entry &entry, ImportedNode &root, std::vector<ImportedMesh> &meshes,
+                      std::vector<ImportedImage> &images, TextureStaging &staging) {
+  AssetReader reader(entry.payload, entry.payload_size);
+  const uint32_t mesh_count = reader.Read<uint32_t>();
+  for (uint32_t i = 0; i < mesh_count && reader.Has(1); ++i) {
+    meshes.emplace_back();
+    ImportedMesh &mesh = meshes.back();
+    mesh.valid = reader.Read<uint32_t>() != 0;
+    if (!mesh.valid) {
+      continue;
+    }
+    mesh.num_vertices = reader.Read<uint32_t>();
+    mesh.num_indices = reader.Read<uint32_t>();
+    mesh.index_type = reader.Read<GLenum>();
+    if (mesh.index_type != GL_UNSIGNED_BYTE && mesh.index_type != GL_UNSIGNED_SHORT &&
+        mesh.index_type != GL_UNSIGNED_INT) {
+      return false;
+    }
+    mesh.vertex_data = reader.ReadStream<glm::vec3>(mesh.num_vertices);
+    mesh.normal_data = reader.ReadStream<glm::vec3>(mesh.num_vertices);
+    mesh.index_data = reader.ReadStream<unsigned char>(mesh.num_indices * GetGLTypeSize(mesh.index_type));
+    mesh.tex_coord_data = reader.ReadStream<glm::vec2>(mesh.num_vertices);
+    mesh.tangent_data = reader.ReadStream<glm::vec4>(mesh.num_vertices);
+    const uint32_t texture_count = reader.Read<uint32_t>();
+    for (uint32_t j = 0; j < texture_count && reader.Has(1); ++j) {
+      ImportedTexture texture;
+      texture.type = reader.Read<int32_t>();
+      texture.image_index = reader.Read<uint32_t>();
+      mesh.textures.push_back(texture);
+    }
+    const uint32_t lod_count = reader.Read<uint32_t>();
+    if (lod_count > 0) {
+      mesh.center = reader.Read<glm::vec3>();
+      mesh.radius = reader.Read<float>();
+    }
+    for (uint32_t j = 0; j < lod_count && reader.Has(1); ++j) {
+      ImportedLod lod;
+      lod.error = reader.Read<float>();
+      lod.num_indices = reader.Read<uint32_t>();
+      lod.index_data = reader.ReadStream<uint32_t>(lod.num_indices);
+      mesh.lods.push_back(lod);
+    }
+  }
+
+  struct EmbeddedSource {
+    const unsigned char *data;
+    uint64_t size;
+    int32_t raw_width;
+    int32_t raw_height;
+  };
+  std::vector<EmbeddedSource> sources;
+  const uint32_t image_count = reader.Read<uint32_t>();
+  for (uint32_t i = 0; i < image_count && reader.Has(1); ++i) {
+    ImportedImage image{};
+    image.key = reader.ReadString();
+    image.gl_internal_format = reader.Read<GLint>();
+    image.embedded = reader.Read<uint32_t>() != 0;
+    image.embedded_index = -1;
+    EmbeddedSource source{};
+    if (image.embedded) {
+      source.raw_width = reader.Read<int32_t>();
+      source.raw_height = reader.Read<int32_t>();
+      source.size = reader.Read<uint64_t>();
+      source.data = reader.ReadStream<unsigned char>(source.size);
+    }
+    images.push_back(image);
+    sources.push_back(source);
+  }
+  ReadNode(reader, root);
+  if (!reader.IsValid()) {
+    return false;
+  }
+  for (const auto &mesh : meshes) {
+    if (mesh.valid && !mesh.vertex_data) {
+      return false;
+    }
+    for (const auto &texture : mesh.textures) {
+      if (texture.image_index >= images.size()) {
+        return false;
       }
+    }
+    for (const auto &lod : mesh.lods) {
+      if (!lod.index_data ||
+          std::any_of(lod.index_data, lod.index_data + lod.num_indices,
+                      [&mesh](uint32_t index) { return index >= mesh.num_vertices; })) {
+        return false;
+      }
+    }
+  }
 
-      switch (i) {
-        case aiTextureType_DIFFUSE:
-          tex = embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_SRGB8_ALPHA8)
-                                 : LoadTexture(texture_full_name, GL_SRGB8_ALPHA8);
-          mat->SetAlbedo(tex);
-          mat->SetHasAlbedo(true);
-          ML_LOG(Debug, "Setting albedo...");
-          break;
-        case aiTextureType_SPECULAR:
-          tex =
-              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTexture(texture_full_name, GL_RGBA8);
-          mat->SetMetallicChannel(0);
-          mat->SetMetallic(tex);
-          mat->SetHasMetallic(true);
-          ML_LOG(Debug, "Setting metallic...");
-          break;
-        case aiTextureType_LIGHTMAP:
-        case aiTextureType_AMBIENT:
-          tex =
-              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTexture(texture_full_name, GL_RGBA8);
-          mat->SetAmbientOcclusion(tex);
-          mat->SetHasAmbientOcclusion(true);
-          ML_LOG(Debug, "Setting ao...");
-          break;
-        case aiTextureType_EMISSIVE:
-          tex = embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_SRGB8_ALPHA8)
-                                 : LoadTexture(texture_full_name, GL_SRGB8_ALPHA8);
-          mat->SetEmissive(tex);
-          mat->SetHasEmissive(true);
-          ML_LOG(Debug, "Setting emissive...");
-          break;
-        case aiTextureType_NORMALS:
-        case aiTextureType_HEIGHT:
-          tex =
-              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTexture(texture_full_name, GL_RGBA8);
-          mat->SetNormals(tex);
-          mat->SetHasNormalMap(true);
-          ML_LOG(Debug, "Setting normal map...");
-          break;
-        case aiTextureType_SHININESS:
-          tex =
-              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTexture(texture_full_name, GL_RGBA8);
-          mat->SetRoughnessChannel(0);
-          mat->SetRoughness(tex);
-          mat->SetHasRoughness(true);
-          ML_LOG(Debug, "Setting roughness...");
-          break;
-        case aiTextureType_UNKNOWN:
-          tex =
-              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTexture(texture_full_name, GL_RGBA8);
-          mat->SetMetallicChannel(2);
-          mat->SetRoughnessChannel(1);
-          mat->SetMetallic(tex);
-          mat->SetRoughness(tex);
-          mat->SetHasRoughness(true);
-          mat->SetHasMetallic(true);
-          ML_LOG(Debug, "Setting metallic and roughness...");
-        default: break;
+  for (size_t i = 0; i < images.size(); ++i) {
+    ImportedImage &image = images[i];
+    const EmbeddedSource &source = sources[i];
+    const bool decoded = image.embedded ? source.data && PrepareImage(source.data, source.size, source.raw_width,
+                                                                      source.raw_height, image, staging)
+                                        : DecodeImage(image.key, image, staging);
+    if (!decoded) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<ResourcePool::AssetImport> ResourcePool::ImportAsset(const std::string &path) {
+  const auto start = std::chrono::steady_clock::now();
+  if (GLTFAsset::IsGLTF(path)) {
+    // Read in place, Assimp only handles what the fast path does not
+    auto gltf_asset = std::make_shared<GLTFAsset>();
+    auto import = std::make_shared<AssetImport>();
+    import->path = path;
+    if (gltf_asset->Load(path) &&
+        ImportGLTF(path, *gltf_asset, import->root, import->meshes, import->images, *texture_staging_)) {
+      import->gltf_asset = gltf_asset;
+      if (mesh_optimization_) {
+        OptimizeMeshes(path, import->meshes);
+      }
+      if (lod_generation_) {
+        GenerateLods(path, import->meshes, mesh_optimization_);
+      }
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      ML_LOG(Info, "Loaded the glTF asset %s in %.2f ms", path.c_str(), elapsed.count() * 1000.0);
+      return import;
+    }
+    ML_LOG(Warning, "Importing %s with Assimp, the glTF fast path does not support it", path.c_str());
+  }
+
+  const auto &asset_cache = AssetCache::GetInstance();
+  AssetCache::Entry entry;
+  const uint32_t options =
+      (mesh_optimization_ ? kAssetOptimizedMeshes : 0) | (lod_generation_ ? kAssetGeneratedLods : 0);
+  if (asset_cache->Load(path, options, entry)) {
+    auto import = std::make_shared<AssetImport>();
+    import->path = path;
+    if (ReadAsset(entry, import->root, import->meshes, import->images, *texture_staging_)) {
+      import->cache_file = entry.file;
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      asset_cache->AddAsset(true, elapsed.count());
+      ML_LOG(Info, "Loaded %s from the asset cache in %.2f ms, importing it took %.2f ms", path.c_str(),
+             elapsed.count() * 1000.0, entry.import_seconds * 1000.0);
+      return import;
+    }
+    ML_LOG(Warning, "Ignoring the unusable asset cache file of %s", path.c_str());
+  }
+
+  Assimp::Importer importer;
+  const aiScene *ai_scene = importer.ReadFile(path.c_str(), aiProcess_Triangulate | aiProcess_GenSmoothNormals |
+                                                                aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices |
+                                                                aiProcess_CalcTangentSpace);
+  if (ai_scene == nullptr || ai_scene->mNumMeshes <= 0) {
+    ML_LOG(Error, "Unable to load model for file %s, %s", path.c_str(), importer.GetErrorString());
+    return nullptr;
+  }
+
+  auto import = std::make_shared<AssetImport>();
+  import->path = path;
+  ImportNode(ai_scene->mRootNode, import->root);
+  import->meshes.resize(ai_scene->mNumMeshes);
+  for (size_t mesh_index = 0; mesh_index < ai_scene->mNumMeshes; ++mesh_index) {
+    ImportMesh(path, ai_scene, ai_scene->mMeshes[mesh_index], import->meshes[mesh_index], import->images,
+               *texture_staging_);
+  }
+  // Before the asset is stored, the cache keeps the optimized meshes
+  if (mesh_optimization_) {
+    OptimizeMeshes(path, import->meshes);
+  }
+  if (lod_generation_) {
+    GenerateLods(path, import->meshes, mesh_optimization_);
+  }
+
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  asset_cache->AddAsset(false, elapsed.count());
+  ML_LOG(Info, "Imported %s in %.2f ms", path.c_str(), elapsed.count() * 1000.0);
+  if (asset_cache->IsEnabled()) {
+    std::vector<unsigned char> payload;
+    WriteAsset(ai_scene, import->root, import->meshes, import->images, payload);
+    asset_cache->Store(path, options, elapsed.count(), payload);
+  }
+  return import;
+}
+
+bool ResourcePool::UploadNext(AssetImport &import) {
+  if (import.textures.size() < import.images.size()) {
+    ImportedImage &image = import.images[import.textures.size()];
+    std::shared_ptr<Texture> texture =
+        image.embedded || image.baking ? nullptr : texture_cache_.Get(image.key, ++tick_);
+    if (texture) {
+      // Shared with an earlier load whose levels may still be staging, the asset waits for them as well
+      import.texture_ticket = std::max(import.texture_ticket, texture_staging_->GetPendingTicket(texture));
+    } else {
+      uint64_t gpu_bytes = 0;
+      uint64_t ticket = 0;
+      texture = CreateTexture(image, gpu_bytes, ticket);
+      if (!texture) {
+        // Levels left to compress, in the next steps
+        return false;
+      }
+      import.texture_ticket = std::max(import.texture_ticket, ticket);
+      if (!image.embedded) {
+        texture_cache_.Insert(image.key, texture, 0, gpu_bytes, ++tick_);
+      } else {
+        import.gpu_bytes += gpu_bytes;
       }
     }
+    image.staged.reset();
+    std::vector<unsigned char>().swap(image.data);
+    import.textures.push_back(texture);
+    return false;
+  }
+  if (import.models.size() < import.meshes.size()) {
+    import.models.push_back(CreateModel(import, import.models.size()));
+    const Model &model = import.models.back();
+    if (model.mesh) {
+      import.gpu_bytes += model.mesh->GetGPUByteSize();
+    }
+    if (model.lods) {
+      for (const auto &level : model.lods->levels) {
+        import.gpu_bytes += level.mesh->GetIndexBuffer()->GetCapacity();
+      }
+    }
+    return false;
+  }
+  // The streams are in the buffers now
+  import.cache_file.reset();
+  import.gltf_asset.reset();
+  return true;
+}
+
+Model ResourcePool::CreateModel(const AssetImport &import, size_t mesh_index) {
+  const ImportedMesh &data = import.meshes[mesh_index];
+  Model model;
+  if (!data.valid) {
+    return model;
+  }
+
+  std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(Buffer::Category::Static, data.index_type);
+  std::shared_ptr<PBRMaterial> mat = std::make_shared<PBRMaterial>();
+  mesh->UpdateMesh(data.vertex_data, data.normal_data, data.num_vertices, data.index_data, data.num_indices);
+  mat->SetHasNormals(data.normal_data != nullptr);
+  if (data.tex_coord_data) {
+    mesh->UpdateTexCoordsBuffer(data.tex_coord_data);
+  }
+  if (data.tangent_data) {
+    auto tangent_buffer = std::make_shared<VertexBuffer>(Buffer::Category::Static, GL_FLOAT, 4);
+    tangent_buffer->UpdateBuffer((const char *)data.tangent_data, data.num_vertices * sizeof(glm::vec4));
+    mesh->SetCustomBuffer(VertexAttributeName::kTangent, tangent_buffer);
+    mat->SetHasTangents(true);
   }
 
-  static_material_cache_.insert(std::make_pair(path, mat));
+  // Meshes and materials of a file are kept apart by their index in it
+  const std::string key = import.path + "#" + std::to_string(mesh_index);
+  mesh_cache_.Insert(key, mesh, 0, mesh->GetGPUByteSize(), ++tick_);
+  model.mesh = mesh;
+
+  // Levels of detail share the vertex buffers of the mesh, only their indices are counted
+  if (!data.lods.empty()) {
+    auto lods = std::make_shared<LodChain>();
+    lods->center = data.center;
+    lods->radius = data.radius;
+    std::vector<unsigned char> packed;
+    for (size_t level = 0; level < data.lods.size(); ++level) {
+      const ImportedLod &lod = data.lods[level];
+      PackIndices(lod.index_data, lod.num_indices, data.index_type, packed);
+      std::shared_ptr<Mesh> lod_mesh = mesh->CreateLod(packed.data(), lod.num_indices);
+      mesh_cache_.Insert(key + "#lod" + std::to_string(level + 1), lod_mesh, 0,
+                         lod_mesh->GetIndexBuffer()->GetCapacity(), ++tick_);
+      lods->levels.push_back(LodLevel{lod_mesh, lod.error});
+    }
+    model.lods = lods;
+  }
+
+  for (const auto &texture : data.textures) {
+    SetMaterialTexture(*mat, texture.type, import.textures[texture.image_index]);
+  }
+
+  // Compile the permutation of the features and create its pipelines now rather than in the first frame it is
+  // drawn in, the one without features was warmed with the renderer
+  if (mat->UpdatePrograms() && pipeline_warmer_) {
+    pipeline_warmer_(*mat);
+  }
+  const auto &param_arena = mat->GetParamArena();
+  static_material_cache_.Insert(key, mat, sizeof(PBRMaterial), param_arena ? param_arena->GetBlockSize() : 0, ++tick_);
   model.material = mat;
   return model;
 }
 
-std::shared_ptr<Texture> ResourcePool::LoadAssimpEmbeddedTexture(const aiTexture *ai_tex, GLint gl_internal_format) {
-  int32_t channels = 0;
-  GLuint gl_texture = 0;
-  int32_t width = 0;
-  int32_t height = 0;
-  void *buffer = nullptr;
-  glGenTextures(1, &gl_texture);
-  glBindTexture(GL_TEXTURE_2D, gl_texture);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+std::shared_ptr<ResourcePool::AssetPrototype> ResourcePool::CreatePrototype(AssetImport &import) {
+  auto prototype = std::make_shared<AssetPrototype>();
+  prototype->root = std::move(import.root);
+  prototype->models = std::move(import.models);
+  prototype->gpu_bytes = import.gpu_bytes;
+  prototype_cache_.Insert(import.path, prototype, sizeof(AssetPrototype), 0, ++tick_);
+  return prototype;
+}
 
-  std::shared_ptr<Texture> texture = std::make_shared<Texture>(GL_TEXTURE_2D, gl_texture, width, height, true);
+std::shared_ptr<ResourcePool::AssetPrototype> ResourcePool::FindPrototype(const std::string &path) {
+  std::shared_ptr<AssetPrototype> prototype = prototype_cache_.Get(path, ++tick_);
+  if (prototype) {
+    shared_bytes_ += prototype->gpu_bytes;
+  }
+  return prototype;
+}
 
-  if (ai_tex->mHeight == 0) {
-    ML_LOG(Debug, "Compressed texture %u %u, image format %s", ai_tex->mWidth, ai_tex->mHeight, ai_tex->achFormatHint);
-    buffer = stbi_load_from_memory((unsigned char *)ai_tex->pcData, ai_tex->mWidth, &width, &height, &channels,
-                                   STBI_rgb_alpha);
-  } else {
-    width = ai_tex->mWidth;
-    height = ai_tex->mHeight;
-    buffer = ai_tex->pcData;
+std::shared_ptr<Node> ResourcePool::ClonePrototype(const AssetPrototype &prototype,
+                                                   const ImportedNode &imported_node) {
+  auto node = std::make_shared<Node>();
+  node->SetLocalTranslation(imported_node.translation);
+  node->SetLocalRotation(imported_node.rotation);
+  node->SetLocalScale(imported_node.scale);
+
+  for (uint32_t mesh_index : imported_node.meshes) {
+    if (mesh_index >= prototype.models.size() || !prototype.models[mesh_index].mesh) {
+      continue;
+    }
+    const Model &model = prototype.models[mesh_index];
+    // A material instance of its own, the mesh and the textures stay shared
+    auto material = std::make_shared<PBRMaterial>(*std::static_pointer_cast<PBRMaterial>(model.material));
+    auto renderable_pbr = std::make_shared<RenderableComponent>(model.mesh, material);
+    renderable_pbr->options.fillmode = GL_FILL;
+    renderable_pbr->SetLodChain(model.lods);
+
+    auto model_node = std::make_shared<Node>();
+    model_node->AddComponent(renderable_pbr);
+    node->AddChild(model_node);
   }
 
-  glTexImage2D(GL_TEXTURE_2D, 0, gl_internal_format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
-  texture->SetWidth(width);
-  texture->SetHeight(height);
+  for (const auto &child : imported_node.children) {
+    node->AddChild(ClonePrototype(prototype, child));
+  }
 
-  if (ai_tex->mHeight == 0) {
-    stbi_image_free(buffer);
+  return node;
+}
+
+void ResourcePool::FinishLoads(const std::string &path, const std::shared_ptr<AssetPrototype> &prototype) {
+  auto pending = pending_loads_.find(path);
+  if (pending == pending_loads_.end()) {
+    return;
+  }
+  for (size_t i = 0; i < pending->second.size(); ++i) {
+    AssetLoad &load = *pending->second[i];
+    if (!prototype) {
+      load.state_ = AssetLoad::State::Failed;
+      continue;
+    }
+    load.GetNode()->AddChild(ClonePrototype(*prototype, prototype->root));
+    load.state_ = AssetLoad::State::Ready;
+    // The loads after the first share what the import created
+    if (i > 0) {
+      shared_bytes_ += prototype->gpu_bytes;
+    }
   }
+  pending_loads_.erase(pending);
+}
 
-  glBindTexture(GL_TEXTURE_2D, 0);
-  return texture;
+std::shared_ptr<Node> ResourcePool::LoadAsset(const std::string &path) {
+  std::shared_ptr<AssetPrototype> prototype = FindPrototype(path);
+  if (!prototype) {
+    std::shared_ptr<AssetImport> import = ImportAsset(path);
+    if (!import) {
+      return nullptr;
+    }
+    while (!UploadNext(*import)) {
+    }
+    prototype = CreatePrototype(*import);
+    Trim();
+  }
+  return ClonePrototype(*prototype, prototype->root);
+}
+
+std::shared_ptr<AssetLoad> ResourcePool::LoadAssetAsync(const std::string &path) {
+  auto load = std::make_shared<AssetLoad>(path);
+  std::shared_ptr<AssetPrototype> prototype = FindPrototype(path);
+  if (prototype) {
+    load->GetNode()->AddChild(ClonePrototype(*prototype, prototype->root));
+    load->state_ = AssetLoad::State::Ready;
+    return load;
+  }
+  // Loads of an asset already being imported wait for that import
+  std::vector<std::shared_ptr<AssetLoad>> &loads = pending_loads_[path];
+  loads.push_back(load);
+  if (loads.size() > 1) {
+    return load;
+  }
+
+  if (!thread_pool_) {
+    thread_pool_.reset(new ThreadPool());
+    ML_LOG(Debug, "Importing assets on %zu threads", thread_pool_->GetThreadCount());
+  }
+  thread_pool_->Submit([this, path]() {
+    std::shared_ptr<AssetImport> import = ImportAsset(path);
+    if (!import) {
+      import = std::make_shared<AssetImport>();
+      import->path = path;
+      import->failed = true;
+    }
+    std::lock_guard<std::mutex> lock(imported_mutex_);
+    imported_.push_back(import);
+  });
+  return load;
+}
+
+void ResourcePool::ProcessUploads(double budget_seconds) {
+  {
+    std::lock_guard<std::mutex> lock(imported_mutex_);
+    for (const auto &import : imported_) {
+      for (const auto &load : pending_loads_[import->path]) {
+        if (!import->failed) {
+          load->state_ = AssetLoad::State::Uploading;
+        }
+      }
+    }
+    uploading_.insert(uploading_.end(), imported_.begin(), imported_.end());
+    imported_.clear();
+  }
+  if (uploading_.empty()) {
+    return;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  bool loaded = false;
+  while (!uploading_.empty()) {
+    AssetImport &import = *uploading_.front();
+    if (import.failed) {
+      FinishLoads(import.path, nullptr);
+      uploading_.pop_front();
+      continue;
+    }
+    // Shown once the textures are complete, their uploads are committed separately
+    if (import.models.size() == import.meshes.size() && !texture_staging_->IsComplete(import.texture_ticket)) {
+      break;
+    }
+    if (UploadNext(import)) {
+      FinishLoads(import.path, CreatePrototype(import));
+      ML_LOG(Debug, "Loaded %s in the background", import.path.c_str());
+      uploading_.pop_front();
+      loaded = true;
+    }
+    // At least one upload per call, loading progresses whatever the budget
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (elapsed.count() >= budget_seconds) {
+      break;
+    }
+  }
+  if (loaded) {
+    Trim();
+  }
 }
 
 std::shared_ptr<Texture> ResourcePool::LoadTexture(const std::string &path, GLint gl_internal_format) {
-  auto texture = GetCacheElement<Texture>(texture_cache_, path);
+  auto texture = texture_cache_.Get(path, ++tick_);
   if (texture) {
     return texture;
   }
 
-  int32_t channels = 0;
-  GLuint gl_texture = 0;
-  int32_t width = 0;
-  int32_t height = 0;
-
-  unsigned char *buffer = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-  if (buffer == nullptr) {
-    ML_LOG(Error, "Unable to load texture %s", path.c_str());
+  ImportedImage image{};
+  image.key = path;
+  image.gl_internal_format = gl_internal_format;
+  if (!DecodeImage(path, image, *texture_staging_)) {
     return nullptr;
   }
-  ML_LOG(Debug, "Number of channels for image %s is %d", path.c_str(), channels);
-  glGenTextures(1, &gl_texture);
-  glBindTexture(GL_TEXTURE_2D, gl_texture);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexImage2D(GL_TEXTURE_2D, 0, gl_internal_format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  stbi_image_free(buffer);
-
-  texture = std::make_shared<Texture>(GL_TEXTURE_2D, gl_texture, width, height, true);
-  texture_cache_.insert(std::make_pair(path, texture));
+  // Returned right away, the levels stream in over the next frames. A texture to bake is compressed here at once.
+  uint64_t gpu_bytes = 0;
+  uint64_t ticket = 0;
+  while (!texture) {
+    texture = CreateTexture(image, gpu_bytes, ticket);
+  }
+  texture_cache_.Insert(path, texture, 0, gpu_bytes, ++tick_);
+  Trim();
   return texture;
 }
 
+void ResourcePool::SetMemoryBudget(uint64_t bytes) {
+  memory_budget_ = bytes;
+  over_budget_ = false;
+  Trim();
+}
+
+void ResourcePool::Trim() {
+  if (memory_budget_ == 0 || GetTotalBytes() <= memory_budget_) {
+    over_budget_ = false;
+    return;
+  }
+  EvictResources();
+}
+
+void ResourcePool::EvictResources() {
+  // Prototypes hold on to the meshes and materials of their asset until they are evicted
+  ResourceCacheBase *caches[] = {&program_cache_, &texture_cache_, &mesh_cache_, &static_material_cache_,
+                                 &prototype_cache_};
+  // Everything still in use counts as used now, the rest keeps the tick of its last use
+  const uint64_t tick = ++tick_;
+  for (ResourceCacheBase *cache : caches) {
+    cache->Touch(tick);
+  }
+
+  uint32_t num_evicted = 0;
+  while (GetTotalBytes() > memory_budget_) {
+    ResourceCacheBase *oldest_cache = nullptr;
+    const std::string *oldest_key = nullptr;
+    uint64_t oldest_used = 0;
+    for (ResourceCacheBase *cache : caches) {
+      uint64_t last_used = 0;
+      const std::string *key = cache->GetOldestUnreferenced(last_used);
+      if (key && (!oldest_key || last_used < oldest_used)) {
+        oldest_cache = cache;
+        oldest_key = key;
+        oldest_used = last_used;
+      }
+    }
+    // Releasing a material can leave its textures unreferenced, stop only once nothing is left
+    if (!oldest_key) {
+      ML_LOG_IF(Warning, !over_budget_,
+                "Resources in use hold %" PRIu64 " bytes, more than the budget of %" PRIu64 " bytes",
+                GetTotalBytes(), memory_budget_);
+      over_budget_ = true;
+      break;
+    }
+    ML_LOG(Verbose, "Evicting resource %s", oldest_key->c_str());
+    oldest_cache->Erase(std::string(*oldest_key));
+    ++num_evicted;
+  }
+  ML_LOG_IF(Debug, num_evicted > 0, "Evicted %u resources, %" PRIu64 " bytes remain", num_evicted,
+            GetTotalBytes());
+}
+
+ResourcePoolUsage ResourcePool::GetUsage() const {
+  ResourcePoolUsage usage;
+  usage.programs = program_cache_.GetUsage();
+  usage.textures = texture_cache_.GetUsage();
+  usage.meshes = mesh_cache_.GetUsage();
+  usage.materials = static_material_cache_.GetUsage();
+  usage.prototypes = prototype_cache_.GetUsage();
+  return usage;
+}
+
+uint64_t ResourcePool::GetTotalBytes() const {
+  const ResourcePoolUsage usage = GetUsage();
+  uint64_t total = 0;
+  for (const ResourceUsage &cache : {usage.programs, usage.textures, usage.meshes, usage.materials, usage.prototypes}) {
+    total += cache.cpu_bytes + cache.gpu_bytes;
+  }
+  return total;
+}
+
 }  // namespace app_framework
 }  // namespace ml
@@ -0,0 +1,54 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include <app_framework/thread_pool.h>
+
+#include <algorithm>
+
+namespace ml {
+namespace app_framework {
+
+ThreadPool::ThreadPool(uint32_t thread_count) : stopping_(false) {
+  if (thread_count == 0) {
+    // The render thread keeps a core to itself
+    thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+  }
+  for (uint32_t i = 0; i < thread_count; ++i) {
+    threads_.emplace_back(&ThreadPool::Run, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    std::queue<std::function<void()>>().swap(tasks_);
+  }
+  condition_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Run() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+      if (stopping_) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
+}
+}
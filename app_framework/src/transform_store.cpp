@@ -0,0 +1,406 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include <app_framework/transform_store.h>
+
+#include <algorithm>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ML_TRANSFORM_STORE_NEON 1
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define ML_TRANSFORM_STORE_SSE 1
+#endif
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+// out = a * b for column major 4x4 matrices, out must not alias b
+inline void MultiplyMatrix(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out) {
+  const float *pa = &a[0][0];
+  const float *pb = &b[0][0];
+  float *pout = &out[0][0];
+#if defined(ML_TRANSFORM_STORE_NEON)
+  const float32x4_t a0 = vld1q_f32(pa);
+  const float32x4_t a1 = vld1q_f32(pa + 4);
+  const float32x4_t a2 = vld1q_f32(pa + 8);
+  const float32x4_t a3 = vld1q_f32(pa + 12);
+  for (int column = 0; column < 4; ++column) {
+    const float *pbc = pb + column * 4;
+    float32x4_t result = vmulq_n_f32(a0, pbc[0]);
+    result = vmlaq_n_f32(result, a1, pbc[1]);
+    result = vmlaq_n_f32(result, a2, pbc[2]);
+    result = vmlaq_n_f32(result, a3, pbc[3]);
+    vst1q_f32(pout + column * 4, result);
+  }
+#elif defined(ML_TRANSFORM_STORE_SSE)
+  const __m128 a0 = _mm_loadu_ps(pa);
+  const __m128 a1 = _mm_loadu_ps(pa + 4);
+  const __m128 a2 = _mm_loadu_ps(pa + 8);
+  const __m128 a3 = _mm_loadu_ps(pa + 12);
+  for (int column = 0; column < 4; ++column) {
+    const float *pbc = pb + column * 4;
+    __m128 result = _mm_mul_ps(a0, _mm_set1_ps(pbc[0]));
+    result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(pbc[1])));
+    result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(pbc[2])));
+    result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(pbc[3])));
+    _mm_storeu_ps(pout + column * 4, result);
+  }
+#else
+  for (int column = 0; column < 4; ++column) {
+    const float *pbc = pb + column * 4;
+    for (int row = 0; row < 4; ++row) {
+      pout[column * 4 + row] = pa[row] * pbc[0] + pa[4 + row] * pbc[1] + pa[8 + row] * pbc[2] + pa[12 + row] * pbc[3];
+    }
+  }
+#endif
+}
+
+template <typename T>
+void Permute(std::vector<T> &values, const std::vector<uint32_t> &order) {
+  std::vector<T> permuted;
+  permuted.reserve(values.size());
+  for (uint32_t index : order) {
+    permuted.push_back(values[index]);
+  }
+  values.swap(permuted);
+}
+
+}  // namespace
+
+const TransformStore::Handle TransformStore::kInvalidHandle;
+const uint32_t TransformStore::kInvalidIndex;
+const uint64_t TransformStore::kInvalidTick;
+
+TransformStore::TransformStore() : tick_(1), updated_tick_(1), order_dirty_(false), updated_count_(0) {}
+
+const std::unique_ptr<TransformStore> &TransformStore::GetInstance() {
+  static std::unique_ptr<TransformStore> instance(new TransformStore());
+  return instance;
+}
+
+TransformStore::Handle TransformStore::Allocate(const glm::vec3 &translation) {
+  Handle handle;
+  if (free_handles_.empty()) {
+    handle = static_cast<Handle>(handle_to_index_.size());
+    handle_to_index_.push_back(kInvalidIndex);
+  } else {
+    handle = free_handles_.back();
+    free_handles_.pop_back();
+  }
+
+  uint32_t index;
+  if (free_indices_.empty()) {
+    // A slot without parent can go anywhere in the order, append it
+    index = static_cast<uint32_t>(index_to_handle_.size());
+    translations_.emplace_back();
+    rotations_.emplace_back();
+    scales_.emplace_back();
+    local_transforms_.emplace_back();
+    world_transforms_.emplace_back();
+    parents_.emplace_back();
+    local_ticks_.emplace_back();
+    world_ticks_.emplace_back();
+    local_dirty_.emplace_back();
+    inverse_world_transforms_.emplace_back();
+    inverse_ticks_.emplace_back();
+    world_translations_.emplace_back();
+    world_rotations_.emplace_back();
+    world_scales_.emplace_back();
+    decomposed_ticks_.emplace_back();
+    index_to_handle_.emplace_back();
+  } else {
+    index = free_indices_.back();
+    free_indices_.pop_back();
+  }
+
+  handle_to_index_[handle] = index;
+  index_to_handle_[index] = handle;
+  translations_[index] = translation;
+  rotations_[index] = glm::quat(glm::mat4(1));
+  scales_[index] = glm::vec3(1, 1, 1);
+  local_transforms_[index] = glm::mat4(1);
+  world_transforms_[index] = glm::mat4(1);
+  parents_[index] = kInvalidIndex;
+  world_ticks_[index] = 0;
+  local_dirty_[index] = 1;
+  inverse_ticks_[index] = kInvalidTick;
+  decomposed_ticks_[index] = kInvalidTick;
+  Touch(index);
+  return handle;
+}
+
+void TransformStore::Release(Handle handle) {
+  // The children of the released slot are expected to be detached by the caller
+  const uint32_t index = handle_to_index_[handle];
+  parents_[index] = kInvalidIndex;
+  local_ticks_[index] = 0;
+  world_ticks_[index] = 0;
+  local_dirty_[index] = 0;
+  index_to_handle_[index] = kInvalidHandle;
+  handle_to_index_[handle] = kInvalidIndex;
+  free_indices_.push_back(index);
+  free_handles_.push_back(handle);
+}
+
+void TransformStore::SetParent(Handle handle, Handle parent) {
+  const uint32_t index = handle_to_index_[handle];
+  const uint32_t parent_index = parent == kInvalidHandle ? kInvalidIndex : handle_to_index_[parent];
+  parents_[index] = parent_index;
+  if (parent_index != kInvalidIndex && parent_index > index) {
+    order_dirty_ = true;
+  }
+  Touch(index);
+}
+
+void TransformStore::SetLocalTranslation(Handle handle, const glm::vec3 &translation) {
+  const uint32_t index = handle_to_index_[handle];
+  translations_[index] = translation;
+  local_dirty_[index] = 1;
+  Touch(index);
+}
+
+void TransformStore::SetLocalRotation(Handle handle, const glm::quat &rotation) {
+  const uint32_t index = handle_to_index_[handle];
+  rotations_[index] = rotation;
+  local_dirty_[index] = 1;
+  Touch(index);
+}
+
+void TransformStore::SetLocalScale(Handle handle, const glm::vec3 &scale) {
+  const uint32_t index = handle_to_index_[handle];
+  scales_[index] = scale;
+  local_dirty_[index] = 1;
+  Touch(index);
+}
+
+void TransformStore::Invalidate(Handle handle) {
+  const uint32_t index = handle_to_index_[handle];
+  local_dirty_[index] = 1;
+  Touch(index);
+}
+
+const glm::mat4 &TransformStore::GetLocalTransform(Handle handle) const {
+  const uint32_t index = handle_to_index_[handle];
+  if (local_dirty_[index]) {
+    UpdateLocal(index);
+  }
+  return local_transforms_[index];
+}
+
+const glm::mat4 &TransformStore::GetInverseWorldTransform(Handle handle) const {
+  const glm::mat4 &world = GetWorldTransform(handle);
+  const uint32_t index = handle_to_index_[handle];
+  if (inverse_ticks_[index] != world_ticks_[index]) {
+    // World matrices are built from translate/rotate/scale, they are always affine
+    inverse_world_transforms_[index] = glm::affineInverse(world);
+    inverse_ticks_[index] = world_ticks_[index];
+  }
+  return inverse_world_transforms_[index];
+}
+
+const glm::vec3 &TransformStore::GetWorldTranslation(Handle handle) const {
+  return world_translations_[UpdateDecomposedWorld(handle)];
+}
+
+const glm::quat &TransformStore::GetWorldRotation(Handle handle) const {
+  return world_rotations_[UpdateDecomposedWorld(handle)];
+}
+
+const glm::vec3 &TransformStore::GetWorldScale(Handle handle) const {
+  return world_scales_[UpdateDecomposedWorld(handle)];
+}
+
+bool TransformStore::IsWorldStale(Handle handle) const {
+  if (updated_tick_ == tick_) {
+    return false;
+  }
+  for (uint32_t index = handle_to_index_[handle]; index != kInvalidIndex; index = parents_[index]) {
+    if (IsStale(index)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const glm::mat4 &TransformStore::GetWorldTransform(Handle handle) const {
+  const uint32_t index = handle_to_index_[handle];
+  if (updated_tick_ == tick_) {
+    // Nothing changed since the last Update
+    return world_transforms_[index];
+  }
+
+  // Evaluate the chain of ancestors top down, only the stale links are recomputed
+  path_.clear();
+  for (uint32_t current = index; current != kInvalidIndex; current = parents_[current]) {
+    path_.push_back(current);
+  }
+  for (auto it = path_.rbegin(); it != path_.rend(); ++it) {
+    if (IsStale(*it)) {
+      UpdateWorld(*it);
+    }
+  }
+  return world_transforms_[index];
+}
+
+void TransformStore::Update() {
+  updated_count_ = 0;
+  if (updated_tick_ == tick_) {
+    return;
+  }
+  if (order_dirty_) {
+    SortByDepth();
+  }
+
+  // Parents come first, so their ticks are final when the children are tested
+  const uint32_t count = static_cast<uint32_t>(parents_.size());
+  for (uint32_t index = 0; index < count; ++index) {
+    if (IsStale(index)) {
+      UpdateWorld(index);
+      ++updated_count_;
+    }
+  }
+  updated_tick_ = tick_;
+}
+
+bool TransformStore::IsStale(uint32_t index) const {
+  if (local_ticks_[index] > world_ticks_[index]) {
+    return true;
+  }
+  const uint32_t parent_index = parents_[index];
+  return parent_index != kInvalidIndex && world_ticks_[parent_index] > world_ticks_[index];
+}
+
+void TransformStore::UpdateLocal(uint32_t index) const {
+  // translate * rotate * scale without the two full matrix products
+  const glm::vec3 &scale = scales_[index];
+  glm::mat4 &local = local_transforms_[index];
+  local = glm::mat4_cast(rotations_[index]);
+  local[0] *= scale.x;
+  local[1] *= scale.y;
+  local[2] *= scale.z;
+  local[3] = glm::vec4(translations_[index], 1.0f);
+  local_dirty_[index] = 0;
+}
+
+void TransformStore::UpdateWorld(uint32_t index) const {
+  if (local_dirty_[index]) {
+    UpdateLocal(index);
+  }
+  const uint32_t parent_index = parents_[index];
+  if (parent_index == kInvalidIndex) {
+    world_transforms_[index] = local_transforms_[index];
+  } else {
+    MultiplyMatrix(world_transforms_[parent_index], local_transforms_[index], world_transforms_[index]);
+  }
+  world_ticks_[index] = tick_;
+}
+
+uint32_t TransformStore::UpdateDecomposedWorld(Handle handle) const {
+  const glm::mat4 &world = GetWorldTransform(handle);
+  const uint32_t index = handle_to_index_[handle];
+  if (decomposed_ticks_[index] == world_ticks_[index]) {
+    return index;
+  }
+
+  glm::mat3 basis(world);
+  glm::vec3 scale(glm::length(basis[0]), glm::length(basis[1]), glm::length(basis[2]));
+  if (glm::determinant(basis) < 0.0f) {
+    scale.x = -scale.x;
+  }
+  basis[0] /= scale.x;
+  basis[1] /= scale.y;
+  basis[2] /= scale.z;
+
+  world_translations_[index] = glm::vec3(world[3]);
+  world_rotations_[index] = glm::quat_cast(basis);
+  world_scales_[index] = scale;
+  decomposed_ticks_[index] = world_ticks_[index];
+  return index;
+}
+
+void TransformStore::Touch(uint32_t index) {
+  local_ticks_[index] = ++tick_;
+}
+
+void TransformStore::SortByDepth() {
+  const uint32_t count = static_cast<uint32_t>(parents_.size());
+
+  // Depth of every slot, memoized while walking up the ancestors
+  std::vector<uint32_t> depths(count, kInvalidIndex);
+  uint32_t max_depth = 0;
+  for (uint32_t index = 0; index < count; ++index) {
+    path_.clear();
+    uint32_t current = index;
+    while (current != kInvalidIndex && depths[current] == kInvalidIndex) {
+      path_.push_back(current);
+      current = parents_[current];
+    }
+    uint32_t depth = current == kInvalidIndex ? 0 : depths[current] + 1;
+    for (auto it = path_.rbegin(); it != path_.rend(); ++it, ++depth) {
+      depths[*it] = depth;
+    }
+    max_depth = std::max(max_depth, depths[index]);
+  }
+
+  // Stable counting sort by depth
+  std::vector<uint32_t> offsets(max_depth + 2, 0);
+  for (uint32_t index = 0; index < count; ++index) {
+    ++offsets[depths[index] + 1];
+  }
+  for (uint32_t depth = 1; depth < offsets.size(); ++depth) {
+    offsets[depth] += offsets[depth - 1];
+  }
+  std::vector<uint32_t> order(count);
+  std::vector<uint32_t> new_indices(count);
+  for (uint32_t index = 0; index < count; ++index) {
+    const uint32_t new_index = offsets[depths[index]]++;
+    order[new_index] = index;
+    new_indices[index] = new_index;
+  }
+
+  Permute(translations_, order);
+  Permute(rotations_, order);
+  Permute(scales_, order);
+  Permute(local_transforms_, order);
+  Permute(world_transforms_, order);
+  Permute(parents_, order);
+  Permute(local_ticks_, order);
+  Permute(world_ticks_, order);
+  Permute(local_dirty_, order);
+  Permute(inverse_world_transforms_, order);
+  Permute(inverse_ticks_, order);
+  Permute(world_translations_, order);
+  Permute(world_rotations_, order);
+  Permute(world_scales_, order);
+  Permute(decomposed_ticks_, order);
+  Permute(index_to_handle_, order);
+
+  for (auto &parent_index : parents_) {
+    if (parent_index != kInvalidIndex) {
+      parent_index = new_indices[parent_index];
+    }
+  }
+  for (auto &index : free_indices_) {
+    index = new_indices[index];
+  }
+  for (uint32_t index = 0; index < count; ++index) {
+    if (index_to_handle_[index] != kInvalidHandle) {
+      handle_to_index_[index_to_handle_[index]] = index;
+    }
+  }
+  order_dirty_ = false;
+}
+
+}  // namespace app_framework
+}  // namespace ml
@@ -54,7 +54,8 @@ public:
       node.controller = std::make_shared<ml::app_framework::Node>();
       GetRoot()->AddChild(node.controller);
 
-      auto model = Registry::GetInstance()->GetResourcePool()->LoadAsset("data/Controller.fbx");
+      // Placeholders filled in once the models are loaded in the background
+      auto model = Registry::GetInstance()->GetResourcePool()->LoadAssetAsync("data/Controller.fbx")->GetNode();
       model->SetLocalRotation(glm::quat{glm::vec3{0.f, glm::pi<float>(), 0.f}});
       model->SetLocalScale(glm::vec3(0.01f));
       node.controller->AddChild(model);
@@ -62,7 +63,7 @@ public:
       auto touchpad_offset = std::make_shared<ml::app_framework::Node>();
       touchpad_offset->SetLocalRotation(glm::quat{glm::vec3{glm::radians(-90.f + 18.f), 0.f, 0.f}});
       node.controller->AddChild(touchpad_offset);
-      node.touch = Registry::GetInstance()->GetResourcePool()->LoadAsset("data/Touchpad_arrow.fbx");
+      node.touch = Registry::GetInstance()->GetResourcePool()->LoadAssetAsync("data/Touchpad_arrow.fbx")->GetNode();
       node.touch->SetLocalScale(glm::vec3(0.02f));
       node.touch->SetLocalRotation(glm::quat{glm::vec3{0.f, glm::pi<float>(), 0.f}});
       touchpad_offset->AddChild(node.touch);
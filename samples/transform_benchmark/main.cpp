@@ -0,0 +1,154 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include <app_framework/node.h>
+#include <app_framework/transform_store.h>
+
+#include <glm/ext.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include <ml_logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+using namespace ml::app_framework;
+
+static const size_t kNumNodes = 10000;
+static const size_t kChildrenPerNode = 4;
+static const int kDefaultFrames = 100;
+
+// Breadth first tree, every node but the root has a parent to go through
+static std::vector<std::shared_ptr<Node>> BuildScene() {
+  std::vector<std::shared_ptr<Node>> nodes;
+  nodes.reserve(kNumNodes);
+  nodes.push_back(std::make_shared<Node>());
+  for (size_t i = 1; i < kNumNodes; ++i) {
+    auto node = std::make_shared<Node>(glm::vec3(1.0f, 0.0f, 0.0f));
+    node->SetLocalRotation(glm::angleAxis(0.1f * static_cast<float>(i % 7), glm::vec3(0.0f, 1.0f, 0.0f)));
+    node->SetLocalScale(glm::vec3(1.0f + 0.01f * static_cast<float>(i % 3)));
+    nodes[(i - 1) / kChildrenPerNode]->AddChild(node);
+    nodes.push_back(node);
+  }
+  TransformStore::GetInstance()->Update();
+  return nodes;
+}
+
+static glm::mat4 GetParentWorldTransform(const std::shared_ptr<Node> &node) {
+  if (auto parent = node->GetParent().lock()) {
+    return parent->GetWorldTransform();
+  }
+  return glm::mat4(1);
+}
+
+// The world setters and getters as they were before the store cached the inverse and decomposed world transforms
+static void SetWorldTranslationUncached(const std::shared_ptr<Node> &node, const glm::vec3 &translation) {
+  node->SetLocalTranslation(glm::vec3(glm::inverse(GetParentWorldTransform(node)) * glm::vec4(translation, 1)));
+}
+
+static void SetWorldRotationUncached(const std::shared_ptr<Node> &node, const glm::quat &rotation) {
+  node->SetLocalRotation(glm::quat_cast(glm::inverse(GetParentWorldTransform(node))) * rotation);
+}
+
+static glm::quat GetWorldRotationUncached(const std::shared_ptr<Node> &node) {
+  return glm::toQuat(node->GetWorldTransform());
+}
+
+static glm::mat4 GetInverseWorldTransformUncached(const std::shared_ptr<Node> &node) {
+  return glm::inverse(node->GetWorldTransform());
+}
+
+struct Timings {
+  double setters_ms;
+  // First read of the frame, after the leaves moved, and the same read again as a second consumer would
+  double first_getters_ms;
+  double repeat_getters_ms;
+};
+
+static float ReadWorldTransforms(const std::vector<std::shared_ptr<Node>> &nodes, bool cached) {
+  float sum = 0.0f;
+  for (const auto &node : nodes) {
+    if (cached) {
+      sum += node->GetWorldTranslation().x;
+      sum += node->GetWorldRotation().w;
+      sum += node->GetInverseWorldTransform()[3][0];
+    } else {
+      sum += glm::vec3(node->GetWorldTransform()[3]).x;
+      sum += GetWorldRotationUncached(node).w;
+      sum += GetInverseWorldTransformUncached(node)[3][0];
+    }
+  }
+  return sum;
+}
+
+// Each frame moves every leaf in world space, then reads the world transforms of every node twice, the way
+// the renderer and the picking code do, with the store updated in between.
+template <bool cached>
+static Timings RunFrames(const std::vector<std::shared_ptr<Node>> &nodes, int frames, float &sink) {
+  typedef std::chrono::steady_clock Clock;
+  Clock::duration setters(0), first_getters(0), repeat_getters(0);
+  const size_t first_leaf = (kNumNodes - 2) / kChildrenPerNode + 1;
+  for (int frame = 0; frame < frames; ++frame) {
+    const glm::vec3 translation(0.0f, 0.001f * static_cast<float>(frame), 0.0f);
+    const glm::quat rotation = glm::angleAxis(0.01f * static_cast<float>(frame), glm::vec3(0.0f, 0.0f, 1.0f));
+
+    const auto set_start = Clock::now();
+    for (size_t i = first_leaf; i < nodes.size(); ++i) {
+      if (cached) {
+        nodes[i]->SetWorldTranslation(translation);
+        nodes[i]->SetWorldRotation(rotation);
+      } else {
+        SetWorldTranslationUncached(nodes[i], translation);
+        SetWorldRotationUncached(nodes[i], rotation);
+      }
+    }
+    setters += Clock::now() - set_start;
+
+    TransformStore::GetInstance()->Update();
+
+    const auto first_start = Clock::now();
+    sink += ReadWorldTransforms(nodes, cached);
+    const auto repeat_start = Clock::now();
+    sink += ReadWorldTransforms(nodes, cached);
+    first_getters += repeat_start - first_start;
+    repeat_getters += Clock::now() - repeat_start;
+  }
+  typedef std::chrono::duration<double, std::milli> Milliseconds;
+  return Timings{std::chrono::duration_cast<Milliseconds>(setters).count() / frames,
+                 std::chrono::duration_cast<Milliseconds>(first_getters).count() / frames,
+                 std::chrono::duration_cast<Milliseconds>(repeat_getters).count() / frames};
+}
+
+int main(int argc, char **argv) {
+  const int frames = argc > 1 ? std::max(std::atoi(argv[1]), 1) : kDefaultFrames;
+  auto nodes = BuildScene();
+
+  // Warm up both paths once so the first timed run does not pay for the page faults
+  float sink = 0.0f;
+  RunFrames<false>(nodes, 1, sink);
+  RunFrames<true>(nodes, 1, sink);
+
+  const Timings uncached = RunFrames<false>(nodes, frames, sink);
+  const Timings cached = RunFrames<true>(nodes, frames, sink);
+
+  ML_LOG(Info, "%zu nodes, %d frames, average per frame:", nodes.size(), frames);
+  ML_LOG(Info, "  world setters: uncached %.3f ms, cached %.3f ms (%.2fx)", uncached.setters_ms, cached.setters_ms,
+         uncached.setters_ms / cached.setters_ms);
+  ML_LOG(Info, "  world getters, first read: uncached %.3f ms, cached %.3f ms (%.2fx)", uncached.first_getters_ms,
+         cached.first_getters_ms, uncached.first_getters_ms / cached.first_getters_ms);
+  ML_LOG(Info, "  world getters, repeat read: uncached %.3f ms, cached %.3f ms (%.2fx)", uncached.repeat_getters_ms,
+         cached.repeat_getters_ms, uncached.repeat_getters_ms / cached.repeat_getters_ms);
+  ML_LOG(Verbose, "checksum %f", sink);
+  return 0;
+}